@@ -69,6 +69,8 @@ protected:
     void refreshTitlesFull(void);
     std::string nameFromCell(size_t index) const;
     void startTransferSend(void);
+    // Sends the latest backup of every multi-selected title in one upload.
+    void startTransferSendSelected(void);
     // Starts the wireless receiver and opens its overlay (or an error overlay).
     void startTransferReceive(void);
     // Visual rows in directoryList: 0 = "New backup", 1 = "Receive" (only while
@@ -99,7 +101,8 @@ private:
     Hid<HidDirection::HORIZONTAL, HidDirection::VERTICAL> hid;
     std::unique_ptr<Clickable> buttonBackupAL, buttonRestoreAL; // narrower Backup/Restore of the three-button action rows
     std::unique_ptr<Clickable> buttonSend;      // middle of the Backup/Send/Restore trio (greyed unless a highlighted backup is sendable)
-    std::unique_ptr<Clickable> buttonBackupAll; // full-width batch Backup shown in multi-select, replacing the two action buttons
+    std::unique_ptr<Clickable> buttonBackupAll; // wide batch Backup shown in multi-select, replacing the three action buttons
+    std::unique_ptr<Clickable> buttonSendAll;   // batch Send beside it (transfer on only)
     std::unique_ptr<BackupList> directoryList;
     std::string ver;
 
@@ -94,7 +94,7 @@ private:
     // (and caching the per-backup totals), then store the grand total.
     void compute(u64 cacheKey, std::u16string rootPath);
     // Recursive, abort-aware size of a single directory subtree.
-    u64 walk(const std::string& path);
+    u64 walk(const std::u16string& path);
 
     std::mutex mMutex;
     std::map<u64, u64> mTotals;                 // (id,kind) key -> total bytes
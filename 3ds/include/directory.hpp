@@ -40,6 +40,8 @@ public:
     Result error(void);
     std::u16string entry(size_t index);
     bool folder(size_t index);
+    // Size of the file at `index`, as FSDIR_Read reported it with the listing.
+    u64 fileSize(size_t index);
     bool good(void);
     size_t size(void);
 
@@ -27,6 +27,7 @@
 #ifndef SERVER_HPP
 #define SERVER_HPP
 
+#include "transferprotocol.hpp"
 #include <cstdint>
 #include <functional>
 #include <string>
@@ -40,18 +41,22 @@ namespace Server {
 
     using HttpHandler = std::function<HttpResponse(const std::string& path, const std::string& requestData)>;
 
-    // A streamed upload: for a registered upload path the server writes the raw
-    // request body to a temp file (instead of buffering it in RAM), so an upload
-    // far larger than MAX_REQUEST_SIZE is handled without heap pressure. The
-    // handler is handed the header block plus the body temp-file path and its
-    // length; the server deletes the temp file once the handler returns.
+    // A streamed upload: for a registered upload path the handler reads the
+    // request body straight off the socket through `body`, so an upload far
+    // larger than MAX_REQUEST_SIZE is neither buffered in RAM nor staged on the
+    // SD card. `body` yields at most bodyLength bytes and returns 0 early if the
+    // sender stalls, drops, or the user cancels the receive; the server tracks
+    // transfer progress as it is read and discards whatever the handler leaves
+    // unread before sending the response. A chunked body arrives already
+    // decoded, with bodyLength UINT64_MAX; having no total, its progress is left
+    // to the handler.
     struct UploadRequest {
-        std::string headers;  // request line + header block, without the trailing CRLFCRLF
-        std::string bodyPath; // temp file holding the raw request body (SD-relative, e.g. /3ds/...)
-        uint64_t bodyLength;  // declared Content-Length (bytes streamed to bodyPath)
+        std::string headers;             // request line + header block, without the trailing CRLFCRLF
+        uint64_t bodyLength;             // declared Content-Length, UINT64_MAX for a chunked body
+        TransferProto::ByteReader& body; // the request body, read as it arrives
     };
 
-    using UploadHandler = std::function<HttpResponse(const UploadRequest&)>;
+    using UploadHandler = std::function<HttpResponse(UploadRequest&)>;
 
     void init(void);
     void exit(void);
@@ -65,10 +70,9 @@ namespace Server {
     void registerHandler(const std::string& path, HttpHandler handler);
     void unregisterHandler(const std::string& path);
 
-    // Registers a streaming upload handler for `path`; the body is written to
-    // `tmpPath` (SD-relative) before the handler runs. Unregistered via
+    // Registers a streaming upload handler for `path`. Unregistered via
     // unregisterHandler.
-    void registerUploadHandler(const std::string& path, const std::string& tmpPath, UploadHandler handler);
+    void registerUploadHandler(const std::string& path, UploadHandler handler);
 }
 
 #endif
\ No newline at end of file
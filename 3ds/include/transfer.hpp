@@ -30,6 +30,7 @@
 #include "title.hpp"
 #include <optional>
 #include <string>
+#include <vector>
 
 namespace Transfer {
     // A parsed send destination. The screen only prompts for the raw "ip:port"
@@ -87,6 +88,20 @@ namespace Transfer {
     // TransferStatus (beginNetwork/addBytesDone) and is drawn by the main loop.
     SendOutcome sendBackup(const Title& title, const std::u16string& backupPath, const std::string& backupName, const std::string& dataType,
         const std::string& ip, u16 port, const std::string& token);
+
+    // One backup of a batch send: the same fields sendBackup takes.
+    struct BatchItem {
+        Title title;
+        std::u16string backupPath;
+        std::string backupName;
+        std::string dataType;
+    };
+
+    // Sends every item in one upload to a receiver that advertises "batch",
+    // for one connection and one PIN check however many titles there are; an
+    // older receiver gets them one sendBackup at a time instead. Items whose
+    // folder is empty are skipped; EmptyBackup only when all of them are.
+    SendOutcome sendBackups(const std::vector<BatchItem>& items, const std::string& ip, u16 port, const std::string& token);
 }
 
 #endif
@@ -34,6 +34,7 @@
 #include <mutex>
 #include <optional>
 #include <string>
+#include <vector>
 
 // The single owner of "a backup/restore is running on a worker thread". It keeps
 // io::backup / io::restore off the main loop so the UI keeps rendering during the
@@ -86,6 +87,10 @@ public:
     void enqueueSend(
         Title title, std::u16string backupPath, std::string backupName, std::string dataType, std::string ip, u16 port, std::string token);
 
+    // Batch send: every item travels in one upload to the same receiver
+    // (see Transfer::sendBackups).
+    void enqueueSend(std::vector<Transfer::BatchItem> items, std::string ip, u16 port, std::string token);
+
     // Drains the queue on a worker thread, if there is work and none is already
     // running. Idempotent and safe to call with an empty queue.
     void start(void);
@@ -120,6 +125,7 @@ private:
         std::string ip;
         u16 port = 0;
         std::string token;
+        std::vector<Transfer::BatchItem> batch; // a batch send when non-empty
     };
 
     enum class State { Idle, Running, Done };
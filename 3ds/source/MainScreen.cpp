@@ -114,11 +114,13 @@ MainScreen::MainScreen(void) : hid(rowlen * collen, collen)
     // on a highlighted backup.
     buttonBackupAL  = std::make_unique<Clickable>(8, 182, 96, 30, COLOR_ACCENT, COLOR_WHITE, i18n::t("main.backup_short"), true);
     buttonRestoreAL = std::make_unique<Clickable>(216, 182, 96, 30, COLOR_RAISED, COLOR_TEXT, i18n::t("main.restore_short"), true);
-    // Full-width batch-backup button shown only while multi-selecting.
-    buttonBackupAll = std::make_unique<Clickable>(8, 182, 304, 30, COLOR_ACCENT, COLOR_WHITE, i18n::t("main.backup_selected"), true);
+    // Batch Backup / Send pair shown only while multi-selecting.
+    buttonBackupAll = std::make_unique<Clickable>(8, 182, 200, 30, COLOR_ACCENT, COLOR_WHITE, i18n::t("main.backup_selected"), true);
+    buttonSendAll   = std::make_unique<Clickable>(216, 182, 96, 30, COLOR_RAISED, COLOR_TEXT, i18n::t("transfer.send"), true);
     buttonSend      = std::make_unique<Clickable>(112, 182, 96, 30, COLOR_RAISED, COLOR_TEXT, i18n::t("transfer.send"), true);
     directoryList   = std::make_unique<BackupList>(12, 70, 296, 106, 5);
     buttonBackupAll->canChangeColorWhenSelected(true);
+    buttonSendAll->canChangeColorWhenSelected(true);
     buttonBackupAL->canChangeColorWhenSelected(true);
     buttonRestoreAL->canChangeColorWhenSelected(true);
     buttonSend->canChangeColorWhenSelected(true);
@@ -350,11 +352,15 @@ void MainScreen::drawBottom(void) const
         }
         directoryList->draw(g_bottomScrollEnabled);
 
-        // Actions. While multi-selecting, one full-width Backup button replaces the
-        // per-title Backup/Restore pair and drives the whole tagged batch.
+        // Actions. While multi-selecting, a wide Backup button (and Send, with
+        // transfer on) replaces the per-title trio and drives the whole tagged batch.
         if (MS::multipleSelectionEnabled()) {
             buttonBackupAll->text(i18n::t("main.backup_n_selected", {std::to_string(MS::selectedEntries().size())}) + " ");
             buttonBackupAll->draw(0.6f, COLOR_RING);
+            if (transferEnabled) {
+                buttonSendAll->text(i18n::t("transfer.send"));
+                buttonSendAll->draw(0.6f, COLOR_ACCENT);
+            }
         }
         // Backup / Send / Restore. Send keeps its slot at all times (greyed until
         // a highlighted existing backup can actually be sent) so it never swaps
@@ -863,6 +869,11 @@ void MainScreen::handleEvents(const InputState& input)
     }
 
     if (MS::multipleSelectionEnabled()) {
+        // Send ships the latest backup of every tagged title in one upload.
+        if (transferEnabled && buttonSendAll->released()) {
+            startTransferSendSelected();
+            return;
+        }
         // One large Backup button (touch or A) backs up the whole tagged batch;
         // it replaces the per-title Backup/Restore pair while multi-selecting.
         if (buttonBackupAll->released() || (kDown & KEY_A) || (kDown & KEY_L)) {
@@ -1005,3 +1016,63 @@ void MainScreen::startTransferSend(void)
         std::move(title), std::move(backupPath), std::move(backupName), std::move(dataType), std::move(dst->ip), dst->port, std::move(pin));
     TransferJob::get().start();
 }
+
+void MainScreen::startTransferSendSelected(void)
+{
+    // The newest backup of each tagged title, by name among those in its own
+    // folder: saves list newest first, extdata oldest first, and the
+    // additional folders trail both unsorted.
+    std::vector<Transfer::BatchItem> items;
+    for (size_t fullIndex : MS::selectedEntries()) {
+        Title title;
+        TitleCatalog::get().getTitle(title, fullIndex, backupKind);
+        BackupTarget target               = title.backup(backupKind);
+        std::vector<std::u16string> names = target.backups();
+        std::u16string base               = target.rootPath() + StringUtils::UTF8toUTF16("/");
+        size_t newest                     = 0;
+        for (size_t cell = 1; cell < names.size(); cell++) {
+            if (target.fullPath(cell).rfind(base, 0) == 0 && (newest == 0 || names[cell] > names[newest])) {
+                newest = cell;
+            }
+        }
+        if (newest == 0) {
+            continue;
+        }
+        Transfer::BatchItem item;
+        item.backupPath = target.fullPath(newest);
+        item.backupName = StringUtils::UTF16toUTF8(names[newest]);
+        item.dataType   = target.dataTypeName();
+        item.title      = std::move(title);
+        items.push_back(std::move(item));
+    }
+    if (items.empty()) {
+        currentOverlay = std::make_shared<InfoOverlay>(*this, i18n::t("main.no_backups_to_send"));
+        return;
+    }
+
+    // One address and PIN for the whole batch.
+    std::string ipPort = KeyboardManager::get().text(Configuration::getInstance().lastTransferAddress(), i18n::t("main.receiver_ip_port"), 32);
+    if (ipPort.empty()) {
+        return;
+    }
+    auto dst = Transfer::parseTarget(ipPort);
+    if (!dst) {
+        currentOverlay = std::make_shared<ErrorOverlay>(*this, -1, i18n::t("main.invalid_ip_port"));
+        return;
+    }
+    Configuration::getInstance().setLastTransferAddress(ipPort);
+
+    std::string pin = KeyboardManager::get().text("1234", i18n::t("main.pin_prompt"), 5);
+    if (pin.empty()) {
+        return;
+    }
+    if (!Transfer::validPin(pin)) {
+        currentOverlay = std::make_shared<ErrorOverlay>(*this, -1, i18n::t("main.pin_invalid"));
+        return;
+    }
+
+    TransferJob::get().enqueueSend(std::move(items), std::move(dst->ip), dst->port, std::move(pin));
+    TransferJob::get().start();
+    MS::clearSelectedEntries();
+    updateButtons();
+}
@@ -25,11 +25,9 @@
  */
 
 #include "backupsize.hpp"
+#include "directory.hpp"
 #include "thread.hpp"
 #include "util.hpp"
-#include <cstring>
-#include <dirent.h>
-#include <sys/stat.h>
 #include <utility>
 #include <vector>
 
@@ -96,64 +94,47 @@ void BackupSizeCache::shutdown(void)
     mAbort.store(true);
 }
 
-u64 BackupSizeCache::walk(const std::string& path)
+u64 BackupSizeCache::walk(const std::u16string& path)
 {
     if (mAbort.load()) {
         return 0;
     }
-    DIR* dir = opendir(path.c_str());
-    if (!dir) {
+    // Directory reads each entry's size along with its name, so the walk costs
+    // one FS round-trip per batch of entries rather than an extra stat() per file.
+    Directory items(Archive::sdmc(), path);
+    if (!items.good()) {
         return 0;
     }
     u64 total = 0;
-    struct dirent* ent;
-    while (!mAbort.load() && (ent = readdir(dir)) != nullptr) {
-        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
-            continue;
+    for (size_t i = 0, sz = items.size(); i < sz && !mAbort.load(); i++) {
+        if (items.folder(i)) {
+            total += walk(path + u"/" + items.entry(i));
         }
-        std::string full = path + "/" + ent->d_name;
-        struct stat st;
-        if (stat(full.c_str(), &st) == 0) {
-            if (S_ISDIR(st.st_mode)) {
-                total += walk(full);
-            }
-            else {
-                total += (u64)st.st_size;
-            }
+        else {
+            total += items.fileSize(i);
         }
     }
-    closedir(dir);
     return total;
 }
 
 void BackupSizeCache::compute(u64 cacheKey, std::u16string rootPath)
 {
-    const std::string root = StringUtils::UTF16toUTF8(rootPath);
-    u64 total              = 0;
+    u64 total = 0;
     std::vector<std::pair<std::u16string, u64>> perBackup;
 
-    DIR* dir = opendir(root.c_str());
-    if (dir) {
-        struct dirent* ent;
-        while (!mAbort.load() && (ent = readdir(dir)) != nullptr) {
-            if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
-                continue;
-            }
-            std::string full = root + "/" + ent->d_name;
-            struct stat st;
-            if (stat(full.c_str(), &st) != 0) {
-                continue;
-            }
-            if (S_ISDIR(st.st_mode)) {
-                u64 sz = walk(full);
-                total += sz;
-                perBackup.emplace_back(rootPath + u"/" + StringUtils::UTF8toUTF16(ent->d_name), sz);
+    Directory items(Archive::sdmc(), rootPath);
+    if (items.good()) {
+        for (size_t i = 0, sz = items.size(); i < sz && !mAbort.load(); i++) {
+            const std::u16string full = rootPath + u"/" + items.entry(i);
+            if (items.folder(i)) {
+                const u64 bytes = walk(full);
+                total += bytes;
+                perBackup.emplace_back(full, bytes);
             }
             else {
-                total += (u64)st.st_size;
+                total += items.fileSize(i);
             }
         }
-        closedir(dir);
     }
 
     std::lock_guard<std::mutex> lock(mMutex);
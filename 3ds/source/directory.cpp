@@ -90,6 +90,11 @@ bool Directory::folder(size_t index)
     return index < mList.size() ? (mList.at(index).attributes & FS_ATTRIBUTE_DIRECTORY) != 0 : false;
 }
 
+u64 Directory::fileSize(size_t index)
+{
+    return index < mList.size() ? mList.at(index).fileSize : 0;
+}
+
 size_t Directory::size(void)
 {
     return mList.size();
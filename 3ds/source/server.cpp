@@ -25,9 +25,7 @@
  */
 
 #include "server.hpp"
-#include "archive.hpp"
 #include "common.hpp"
-#include "fsstream.hpp"
 #include "i18n.hpp"
 #include "logging.hpp"
 #include "main.hpp"
@@ -36,10 +34,13 @@
 #include "transferstatus.hpp"
 #include "util.hpp"
 #include <3ds.h>
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -63,14 +64,14 @@ namespace {
     std::atomic<bool> serverIsRunning{false};
     std::string serverAddress;
 
-    // Cap on the header block alone (the upload body is streamed to SD, so it is
-    // not bounded by this). Guards against a client that never sends a header
+    // Cap on the header block alone (the upload body is streamed to its handler,
+    // so it is not bounded by this). Guards against a client that never sends a header
     // terminator and grows us unbounded.
     static const size_t MAX_HEADER_SIZE = 128 * 1024;
 
     std::map<std::string, Server::HttpHandler> handlers;
-    // Streaming upload handlers keyed by path: {temp body file path, handler}.
-    std::map<std::string, std::pair<std::string, Server::UploadHandler>> uploadHandlers;
+    // Streaming upload handlers keyed by path.
+    std::map<std::string, Server::UploadHandler> uploadHandlers;
     // handlers/uploadHandlers are mutated from the main thread (register/unregister
     // on receiver start/stop) while the network thread looks them up, so guard both.
     std::mutex handlersMutex;
@@ -88,7 +89,7 @@ namespace {
         return "";
     }
 
-    static size_t parseContentLength(const std::string& headers)
+    static u64 parseContentLength(const std::string& headers)
     {
         // headerValue is case-insensitive, so every spelling a client may send is
         // covered without listing them here.
@@ -96,7 +97,16 @@ namespace {
         if (value.empty()) {
             return 0;
         }
-        return (size_t)strtoul(value.c_str(), nullptr, 10);
+        return strtoull(value.c_str(), nullptr, 10);
+    }
+
+    // A sender that compresses on the fly cannot know the body length upfront
+    // and sends it "Transfer-Encoding: chunked" instead of with a Content-Length.
+    static bool isChunked(const std::string& headers)
+    {
+        std::string value = TransferProto::headerValue(headers, "Transfer-Encoding");
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return value.find("chunked") != std::string::npos;
     }
 
     // Per-recv idle timeout. The server is single-threaded, so without a bound a
@@ -147,53 +157,65 @@ namespace {
         send(clientSocket, response.body.c_str(), response.body.length(), 0);
     }
 
-    // Streams the body of an upload request to `tmpPath`, tracking progress and
-    // honouring a receive cancel. `leftover` is the body already read while
-    // parsing the header. Returns true when the full body was written.
-    static bool streamBodyToFile(s32 clientSocket, const std::u16string& tmpPath, size_t contentLength, const char* leftover, size_t leftoverLen)
-    {
-        FSStream out(Archive::sdmc(), tmpPath, FS_OPEN_WRITE, (u32)contentLength);
-        if (!out.good()) {
-            Logging::error("Failed to open upload temp file (0x{:08X}).", (u32)out.result());
-            return false;
-        }
-
-        TransferStatus::beginNetwork(i18n::t("transfer.downloading"), contentLength);
-
-        size_t written = 0;
-        if (leftoverLen > 0) {
-            size_t toWrite = leftoverLen > contentLength ? contentLength : leftoverLen;
-            out.write(leftover, (u32)toWrite);
-            written += toWrite;
-            TransferStatus::setBytesDone(written);
+    // Upload body still on the socket, handed to an upload handler as a
+    // ByteReader: first the bytes that arrived along with the header block, then
+    // recv() up to Content-Length (or until the connection closes, under a
+    // chunked body that marks its own end). Progress and receive-cancel are
+    // tracked here, so the handler only has to consume it.
+    struct SocketBodyReader : TransferProto::ByteReader {
+        s32 sock;
+        const char* leftover;
+        size_t leftoverLen;
+        u64 remaining;
+        u64 received = 0;
+        int idleMs   = 0;
+        // Cancelled, stalled, or dropped before Content-Length bytes arrived.
+        bool failed = false;
+        // Off for a chunked body: it has no total to measure against, so the
+        // handler reports progress in payload bytes instead.
+        bool trackProgress = true;
+
+        SocketBodyReader(s32 s, const char* left, size_t leftLen, u64 contentLength)
+            : sock(s), leftover(left), leftoverLen(leftLen), remaining(contentLength)
+        {
         }
 
-        constexpr size_t RECV_CHUNK = 32 * 1024;
-        std::unique_ptr<char[]> buffer(new char[RECV_CHUNK]);
-        int idleMs = 0;
-        bool ok    = true;
-        while (written < contentLength) {
-            ssize_t received = pollRecv(clientSocket, buffer.get(), RECV_CHUNK, idleMs, true);
-            if (received <= 0) {
-                ok = false; // clean close, idle timeout, or cancel: incomplete body
-                break;
+        size_t read(void* dst, size_t n) override
+        {
+            if (remaining == 0 || failed) {
+                return 0;
+            }
+            if (n > remaining) {
+                n = (size_t)remaining;
+            }
+            size_t got = 0;
+            if (leftoverLen > 0) {
+                got = n < leftoverLen ? n : leftoverLen;
+                memcpy(dst, leftover, got);
+                leftover += got;
+                leftoverLen -= got;
+            }
+            else {
+                ssize_t rc = pollRecv(sock, static_cast<char*>(dst), n, idleMs, true);
+                if (rc <= 0) {
+                    failed = true; // clean close, idle timeout, or cancel: incomplete body
+                    return 0;
+                }
+                got = (size_t)rc;
             }
-            size_t toWrite = (size_t)received;
-            if (written + toWrite > contentLength) {
-                toWrite = contentLength - written;
+            remaining -= got;
+            received += got;
+            if (trackProgress) {
+                TransferStatus::setBytesDone(received);
             }
-            out.write(buffer.get(), (u32)toWrite);
-            written += toWrite;
-            TransferStatus::setBytesDone(written);
+            return got;
         }
-        out.close();
-        return ok && written == contentLength;
-    }
+    };
 
     static void handleHttpRequest(s32 clientSocket)
     {
         // Read only up to and including the header terminator; the body is either
-        // streamed to disk (upload paths) or read into RAM afterwards (others).
+        // handed to an upload handler off the socket or read into RAM afterwards.
         std::string data;
         data.reserve(4096);
         constexpr size_t RECV_CHUNK = 32 * 1024;
@@ -219,40 +241,49 @@ namespace {
             return;
         }
 
-        std::string headers  = data.substr(0, headerEnd);
-        std::string path     = extractPath(headers);
-        size_t contentLength = parseContentLength(headers);
-        size_t bodyStart     = headerEnd + 4;
+        std::string headers = data.substr(0, headerEnd);
+        std::string path    = extractPath(headers);
+        u64 contentLength   = parseContentLength(headers);
+        size_t bodyStart    = headerEnd + 4;
 
         // Streaming upload path.
-        std::string tmpPath;
         Server::UploadHandler uploadHandler;
         bool isUpload = false;
         {
             std::lock_guard<std::mutex> lock(handlersMutex);
             auto it = uploadHandlers.find(path);
             if (it != uploadHandlers.end()) {
-                tmpPath       = it->second.first;
-                uploadHandler = it->second.second;
+                uploadHandler = it->second;
                 isUpload      = true;
             }
         }
         if (isUpload) {
-            std::u16string tmpU16 = StringUtils::UTF8toUTF16(tmpPath.c_str());
-            const char* leftover  = data.data() + bodyStart;
-            size_t leftoverLen    = data.size() - bodyStart;
-            bool complete         = streamBodyToFile(clientSocket, tmpU16, contentLength, leftover, leftoverLen);
-            if (!complete) {
-                // Cancelled, stalled, or dropped mid-upload: drop the request and
-                // clear the transfer UI; the handler never runs on a partial body.
-                FSUSER_DeleteFile(Archive::sdmc(), fsMakePath(PATH_UTF16, tmpU16.data()));
+            bool chunked   = isChunked(headers);
+            u64 wireLength = chunked ? UINT64_MAX : contentLength;
+            TransferStatus::beginNetwork(i18n::t("transfer.downloading"), chunked ? 0 : contentLength);
+            size_t leftoverLen = (size_t)std::min<u64>(data.size() - bodyStart, wireLength);
+            SocketBodyReader socketBody(clientSocket, data.data() + bodyStart, leftoverLen, wireLength);
+            socketBody.trackProgress = !chunked;
+            std::optional<TransferProto::ChunkedReader> chunkedBody;
+            if (chunked) {
+                chunkedBody.emplace(socketBody);
+            }
+            TransferProto::ByteReader& body = chunked ? static_cast<TransferProto::ByteReader&>(*chunkedBody) : socketBody;
+            Server::UploadRequest req{headers, chunked ? UINT64_MAX : contentLength, body};
+            Server::HttpResponse response = uploadHandler(req);
+
+            // The sender writes its whole body before it reads the reply, so
+            // whatever the handler did not consume (a rejected PIN, say) is
+            // drained before answering.
+            while (body.read(buffer.get(), RECV_CHUNK) > 0) {
+            }
+            if (socketBody.failed || (chunkedBody && !chunkedBody->finished())) {
+                // Cancelled, stalled, or dropped mid-upload: nobody is left to
+                // read a response, so just clear the transfer UI.
                 TransferStatus::end();
                 Logging::info("Upload abandoned before the full body arrived.");
                 return;
             }
-            Server::UploadRequest req{headers, tmpPath, (uint64_t)contentLength};
-            Server::HttpResponse response = uploadHandler(req);
-            FSUSER_DeleteFile(Archive::sdmc(), fsMakePath(PATH_UTF16, tmpU16.data()));
             sendResponse(clientSocket, response);
             return;
         }
@@ -365,11 +396,11 @@ void Server::unregisterHandler(const std::string& path)
     Logging::info("Unregistered HTTP handler for path {}", path);
 }
 
-void Server::registerUploadHandler(const std::string& path, const std::string& tmpPath, Server::UploadHandler handler)
+void Server::registerUploadHandler(const std::string& path, Server::UploadHandler handler)
 {
     {
         std::lock_guard<std::mutex> lock(handlersMutex);
-        uploadHandlers[path] = {tmpPath, handler};
+        uploadHandlers[path] = handler;
     }
     Logging::info("Registered upload handler for path {}", path);
 }
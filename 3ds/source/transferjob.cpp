@@ -79,6 +79,20 @@ void TransferJob::enqueueSend(
     mQueue.push_back(std::move(item));
 }
 
+void TransferJob::enqueueSend(std::vector<Transfer::BatchItem> items, std::string ip, u16 port, std::string token)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    WorkItem item;
+    item.op         = Kind::Send;
+    item.dataType   = items.empty() ? "save" : items.front().dataType;
+    item.successMsg = i18n::t("transfer.completed");
+    item.ip         = std::move(ip);
+    item.port       = port;
+    item.token      = std::move(token);
+    item.batch      = std::move(items);
+    mQueue.push_back(std::move(item));
+}
+
 void TransferJob::start(void)
 {
     if (mState.load() == State::Running) {
@@ -144,14 +158,20 @@ void TransferJob::run(void)
 
         JobResult current;
         if (item.op == Kind::Send) {
-            Transfer::SendOutcome out = Transfer::sendBackup(item.title, item.path, item.backupName, item.dataType, item.ip, item.port, item.token);
-            current                   = JobResult{.isRestore = false,
-                                  .ok                        = out.ok,
-                                  .res                       = 0,
-                                  .stage                     = io::BackupStage::Copy,
-                                  .successMsg                = item.successMsg,
-                                  .dataType                  = item.dataType,
-                                  .send                      = out};
+            Transfer::SendOutcome out;
+            if (item.batch.empty()) {
+                out = Transfer::sendBackup(item.title, item.path, item.backupName, item.dataType, item.ip, item.port, item.token);
+            }
+            else {
+                out = Transfer::sendBackups(item.batch, item.ip, item.port, item.token);
+            }
+            current = JobResult{.isRestore = false,
+                .ok                        = out.ok,
+                .res                       = 0,
+                .stage                     = io::BackupStage::Copy,
+                .successMsg                = item.successMsg,
+                .dataType                  = item.dataType,
+                .send                      = out};
         }
         else {
             TransferStatus::setSaveCount(done);
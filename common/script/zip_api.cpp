@@ -39,7 +39,6 @@
 #include <cstdint>
 #include <cstdio>
 #include <dirent.h>
-#include <optional>
 #include <string>
 #include <sys/stat.h>
 #include <vector>
@@ -127,7 +126,7 @@ namespace {
             mkdir(full.c_str(), 0777);
             return true;
         }
-        bool beginFile(const std::string& relPath, uint32_t) override
+        bool beginFile(const std::string& relPath, uint64_t) override
         {
             ensureParents(relPath);
             out = fopen((root + relPath).c_str(), "wb");
@@ -144,9 +143,9 @@ namespace {
     };
 
     // Recursively gather files (with '/'-separated relative paths) and the dir
-    // list sendZipStream needs. Returns false if any regular file exceeds the
-    // store-only entry limit or carries an unsafe relative path — the whole zip
-    // must refuse rather than emit a truncated/traversing entry.
+    // list sendZipStream needs. Returns false if any regular file carries an
+    // unsafe relative path — the whole zip must refuse rather than emit a
+    // traversing entry.
     bool collect(const std::string& root, const std::string& sub, std::vector<TransferProto::SendFile>& files, std::vector<std::string>& dirs)
     {
         std::string current = root;
@@ -177,14 +176,10 @@ namespace {
                 }
             }
             else {
-                if ((uint64_t)st.st_size > TransferProto::kZipMaxSize) {
-                    ok = false;
-                    continue;
-                }
                 TransferProto::SendFile entry;
                 entry.absPath = full;
                 entry.relPath = sub + name;
-                entry.size    = (uint32_t)st.st_size;
+                entry.size    = (uint64_t)st.st_size;
                 if (!TransferProto::isSafeZipRelativePath(entry.relPath)) {
                     ok = false;
                     continue;
@@ -203,10 +198,7 @@ namespace {
         if (!collect(srcDir, "", files, dirs)) {
             return -1;
         }
-        const std::optional<uint64_t> totalBytes = TransferProto::zipStreamSize(files, dirs);
-        if (!totalBytes) {
-            return -1; // exceeds the 4 GB store-only ceiling (no save comes close)
-        }
+        const uint64_t totalBytes = TransferProto::zipStreamSize(files, dirs);
 
         FILE* f = fopen(outZipPath, "wb");
         if (f == nullptr) {
@@ -218,9 +210,10 @@ namespace {
         // Drives the reserved innermost bar so a script gets a byte-level bar
         // under whatever item-level bar it drives itself, without writing any
         // progress code around the call.
-        ScriptConsole::get().beginIo("zip", (long long)*totalBytes);
+        ScriptConsole::get().beginIo("zip", (long long)totalBytes);
         const bool ok = TransferProto::sendZipStream(
-            sink, files, dirs, reader, scriptCancelled, [](size_t n) { ScriptConsole::get().addIo((long long)n); }, wasCancelled);
+            sink, files, dirs, reader, TransferProto::ZipMethod::Store, scriptCancelled, [](size_t n) { ScriptConsole::get().addIo((long long)n); },
+            wasCancelled);
         ScriptConsole::get().endIo();
         fclose(f);
         if (!ok) {
@@ -27,9 +27,11 @@
 #include "transferprotocol.hpp"
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <zlib.h>
 
 #if defined(__aarch64__)
 #include <arm_acle.h>
@@ -120,6 +122,12 @@ namespace TransferProto {
         out.push_back((char)((v >> 24) & 0xFF));
     }
 
+    void appendLe64(std::string& out, uint64_t v)
+    {
+        appendLe32(out, (uint32_t)(v & 0xFFFFFFFFu));
+        appendLe32(out, (uint32_t)(v >> 32));
+    }
+
     bool isSafeZipRelativePath(const std::string& relPath)
     {
         if (relPath.empty()) {
@@ -252,107 +260,762 @@ namespace TransferProto {
         return pin.size() == 4 && std::all_of(pin.begin(), pin.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
     }
 
-    std::optional<uint64_t> zipStreamSize(const std::vector<SendFile>& files, const std::vector<std::string>& dirs)
+    namespace {
+        constexpr uint16_t kZip64ExtraId = 0x0001;
+        // Version needed to extract: 2.0 for the classic records, 4.5 once an
+        // entry or the end of the archive uses zip64 ones.
+        constexpr uint16_t kZipVersion   = 20;
+        constexpr uint16_t kZip64Version = 45;
+        // Zip64 end of central directory record + its locator.
+        constexpr uint64_t kZip64EndSize = 56 + 20;
+
+        // Whether a file entry gets a zip64 local header (sentinel sizes plus a
+        // zip64 extra) and a 64-bit data descriptor. The choice is made before
+        // the data is sent, so a deflated entry whose output could outgrow the
+        // 32-bit fields — deflate may expand incompressible input slightly —
+        // is framed as zip64 up front.
+        bool zip64Entry(uint64_t size, ZipMethod method)
+        {
+            uint64_t worst = method == ZipMethod::Deflate ? size + (size >> 11) + 1024 : size;
+            return worst >= kZip32Max;
+        }
+
+        // Bytes of the zip64 extra a central directory record needs: one 8-byte
+        // field for each of uncompressed size, compressed size and local header
+        // offset (in that order) that does not fit its 32-bit field.
+        size_t centralZip64ExtraSize(uint64_t size, uint64_t compSize, uint64_t offset)
+        {
+            size_t fields = (size >= kZip32Max ? 1 : 0) + (compSize >= kZip32Max ? 1 : 0) + (offset >= kZip32Max ? 1 : 0);
+            return fields == 0 ? 0 : 4 + 8 * fields;
+        }
+
+        bool zip64End(size_t entries, uint64_t centralSize, uint64_t centralOffset)
+        {
+            return entries >= 0xFFFF || centralSize >= kZip32Max || centralOffset >= kZip32Max;
+        }
+    }
+
+    uint64_t zipStreamSize(const std::vector<SendFile>& files, const std::vector<std::string>& dirs)
     {
-        uint64_t total = 22; // end of central directory
+        // Mirrors sendZipStream record by record: whether an entry's central
+        // record needs a zip64 offset depends on where its local header landed.
+        uint64_t offset  = 0;
+        uint64_t central = 0;
         for (const auto& dir : dirs) {
-            total += 30 + dir.size(); // local header
-            total += 46 + dir.size(); // central directory
+            central += 46 + dir.size() + centralZip64ExtraSize(0, 0, offset);
+            offset += 30 + dir.size();
         }
         for (const auto& entry : files) {
-            total += 30 + entry.relPath.size() + (uint64_t)entry.size + 16; // local header + data + data descriptor
-            total += 46 + entry.relPath.size();                             // central directory
+            bool zip64 = zip64Entry(entry.size, ZipMethod::Store);
+            central += 46 + entry.relPath.size() + centralZip64ExtraSize(entry.size, entry.size, offset);
+            // local header (+ zip64 extra) + data + data descriptor
+            offset += 30 + entry.relPath.size() + (zip64 ? 20 : 0) + entry.size + (zip64 ? 24 : 16);
         }
-        if (total > kZipMaxSize) {
-            return std::nullopt;
+        uint64_t total = offset + central + 22;
+        if (zip64End(dirs.size() + files.size(), central, offset)) {
+            total += kZip64EndSize;
         }
         return total;
     }
 
-    bool parseMultipart(const std::string& head, uint64_t bodyLen, const std::string& boundary, std::string& outMeta, uint64_t& outFileOffset,
-        uint64_t& outFileLen, std::string& outError)
+    std::string partFieldName(const std::string& partHeaders)
     {
-        outMeta.clear();
-        outFileOffset = 0;
-        outFileLen    = 0;
+        // Walk the ';'-separated parameters so "filename=" is never mistaken for
+        // "name=".
+        std::string disposition = headerValue(partHeaders, "Content-Disposition");
+        size_t start            = 0;
+        while (start < disposition.size()) {
+            size_t end = disposition.find(';', start);
+            if (end == std::string::npos) {
+                end = disposition.size();
+            }
+            size_t first = start;
+            while (first < end && (disposition[first] == ' ' || disposition[first] == '\t')) {
+                first++;
+            }
+            if (disposition.compare(first, 5, "name=") == 0) {
+                std::string value = disposition.substr(first + 5, end - first - 5);
+                if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+                    value = value.substr(1, value.size() - 2);
+                }
+                return value;
+            }
+            start = end + 1;
+        }
+        return "";
+    }
+
+    namespace {
+        // Window the multipart reader pulls `in` through.
+        constexpr size_t kMultipartWindow = 64 * 1024;
+        // A part's header block is a couple of short lines; bound it so a body
+        // that never sends the blank line cannot grow it without limit.
+        constexpr size_t kMaxPartHeaderBlock = 16 * 1024;
+        // RFC 2046 caps a boundary at 70 characters; anything far past that is
+        // not a sender we talk to.
+        constexpr size_t kMaxBoundary = 200;
+        // Window the chunked decoder pulls `in` through.
+        constexpr size_t kChunkWindow = 64 * 1024;
+        // A chunk-size or trailer line is a hex number plus optional extensions;
+        // bound it like the part header block.
+        constexpr size_t kMaxChunkLine = 1024;
+    }
+
+    MultipartParser::MultipartParser(const std::string& boundary, Callbacks callbacks)
+        : mCallbacks(std::move(callbacks)), mDelimiter("\r\n--" + boundary)
+    {
+        if (boundary.empty() || boundary.size() > kMaxBoundary) {
+            fail("Missing boundary.");
+            return;
+        }
+        // RFC 2046 boundaries never contain a line break; the delimiter search
+        // relies on its leading CR being the only one.
+        if (boundary.find_first_of("\r\n") != std::string::npos) {
+            fail("Invalid boundary.");
+            return;
+        }
+        // The body opens with "--boundary" and no preceding line break. Counting
+        // the CRLF as already matched makes the first delimiter look like every
+        // other one; if a preamble comes first instead, the CRLF is replayed
+        // into it and dropped with the rest of it.
+        mMatched = 2;
+    }
+
+    void MultipartParser::fail(const char* message)
+    {
+        mState = State::Failed;
+        mError = message;
+    }
+
+    // A full delimiter was consumed: close the current part, if any. Returns the
+    // callback's verdict, false meaning pause.
+    bool MultipartParser::delimiterFound()
+    {
+        bool inPart = mState == State::Body;
+        mState      = State::AfterDelimiter;
+        mAfterLen   = 0;
+        if (inPart && mCallbacks.onPartEnd) {
+            return mCallbacks.onPartEnd();
+        }
+        return true;
+    }
 
-        std::string boundaryMarker     = "--" + boundary;
-        std::string nextBoundaryMarker = "\r\n" + boundaryMarker;
+    size_t MultipartParser::feed(const uint8_t* data, size_t len)
+    {
+        const char* delim = mDelimiter.data();
+        const size_t dlen = mDelimiter.size();
+        size_t i          = 0;
+
+        while (i < len) {
+            switch (mState) {
+                case State::Preamble:
+                case State::Body: {
+                    bool inPart = mState == State::Body;
+                    auto emit   = [&](const uint8_t* p, size_t n) { return !inPart || !mCallbacks.onPartData || mCallbacks.onPartData(p, n); };
+
+                    // Settle the delimiter prefix the previous chunk ended on.
+                    if (mMatched > 0) {
+                        size_t cmp = std::min(dlen - mMatched, len - i);
+                        if (std::memcmp(data + i, delim + mMatched, cmp) == 0) {
+                            mMatched += cmp;
+                            i += cmp;
+                            if (mMatched < dlen) {
+                                return i; // chunk exhausted, still undecided
+                            }
+                            mMatched = 0;
+                            if (!delimiterFound()) {
+                                return i;
+                            }
+                            break;
+                        }
+                        // Not a delimiter after all: the held bytes were data.
+                        // The delimiter starts with the only CR in it, so no
+                        // later delimiter can begin inside them.
+                        size_t held = mMatched;
+                        mMatched    = 0;
+                        if (!emit((const uint8_t*)delim, held)) {
+                            return i;
+                        }
+                        break;
+                    }
+
+                    const uint8_t* start = data + i;
+                    size_t avail         = len - i;
+                    size_t off           = 0;
+                    bool stop            = false;
+                    while (off < avail) {
+                        const void* cr = std::memchr(start + off, '\r', avail - off);
+                        if (cr == nullptr) {
+                            off = avail;
+                            break;
+                        }
+                        size_t at  = (size_t)((const uint8_t*)cr - start);
+                        size_t cmp = std::min(dlen, avail - at);
+                        if (std::memcmp(start + at, delim, cmp) != 0) {
+                            off = at + 1;
+                            continue;
+                        }
+                        // Data up to the (possible) delimiter.
+                        if (at > 0 && !emit(start, at)) {
+                            return i + at;
+                        }
+                        i += at + cmp;
+                        if (cmp < dlen) {
+                            mMatched = cmp; // hold the prefix until the next chunk
+                            return i;
+                        }
+                        if (!delimiterFound()) {
+                            return i;
+                        }
+                        stop = true;
+                        break;
+                    }
+                    if (stop) {
+                        break;
+                    }
+                    if (!emit(start, avail)) {
+                        return len;
+                    }
+                    i = len;
+                    break;
+                }
+
+                case State::AfterDelimiter: {
+                    mAfter[mAfterLen++] = (char)data[i++];
+                    if (mAfterLen < 2) {
+                        break;
+                    }
+                    if (mAfter[0] == '-' && mAfter[1] == '-') {
+                        mState = State::Done;
+                    }
+                    else if (mAfter[0] == '\r' && mAfter[1] == '\n') {
+                        mState = State::Headers;
+                        mHeaders.clear();
+                    }
+                    else {
+                        fail("Malformed multipart delimiter.");
+                        return i;
+                    }
+                    break;
+                }
+
+                case State::Headers: {
+                    // Header blocks are tiny; collect them (bounded) and look for
+                    // the blank line, which may straddle chunks. A part with no
+                    // headers at all starts with the blank line straight away.
+                    size_t prev = mHeaders.size();
+                    size_t take = std::min(len - i, kMaxPartHeaderBlock + 4 - prev);
+                    mHeaders.append((const char*)data + i, take);
+                    size_t end  = std::string::npos;
+                    size_t skip = 4;
+                    if (mHeaders.compare(0, 2, "\r\n") == 0) {
+                        end  = 0;
+                        skip = 2;
+                    }
+                    else {
+                        end = mHeaders.find("\r\n\r\n", prev >= 3 ? prev - 3 : 0);
+                    }
+                    if (end == std::string::npos) {
+                        if (mHeaders.size() > kMaxPartHeaderBlock) {
+                            fail("Multipart header block too large.");
+                            return i;
+                        }
+                        i += take;
+                        break;
+                    }
+                    i += end + skip - prev;
+                    mHeaders.resize(end);
+                    mState = State::Body;
+                    if (mCallbacks.onPartBegin && !mCallbacks.onPartBegin(mHeaders)) {
+                        return i;
+                    }
+                    break;
+                }
+
+                case State::Done:
+                    return len;
 
-        // Meta part.
-        size_t metaPos = head.find(boundaryMarker);
-        if (metaPos == std::string::npos) {
-            outError = "Missing boundary.";
+                case State::Failed:
+                    return i;
+            }
+        }
+        return i;
+    }
+
+    MultipartReader::MultipartReader(ByteReader& in, const std::string& boundary)
+        : mIn(in), mParser(boundary,
+                       {
+                           [this](const std::string& headers) {
+                               mHeaders   = headers;
+                               mPartBegun = true;
+                               mInPart    = true;
+                               return false;
+                           },
+                           [this](const uint8_t* data, size_t len) {
+                               mSpan    = data;
+                               mSpanLen = len;
+                               return false;
+                           },
+                           [this]() {
+                               mInPart = false;
+                               return false;
+                           },
+                       }),
+          mBuf(new uint8_t[kMultipartWindow])
+    {
+        if (mParser.failed()) {
+            mError = mParser.error();
+        }
+    }
+
+    // Feeds the parser until one callback fired (it pauses on every event),
+    // pulling more of `in` into the window when it runs dry. False once there
+    // is nothing more to parse: closing delimiter, malformed body, or a source
+    // that ended early.
+    bool MultipartReader::pump()
+    {
+        if (mParser.done() || mParser.failed()) {
             return false;
         }
-        // File part header.
-        size_t filePos = head.find("name=\"file\"");
-        if (filePos == std::string::npos) {
-            outError = "Incomplete form data.";
+        if (mPos == mLen) {
+            mPos      = 0;
+            mLen      = 0;
+            size_t rd = mIn.read(mBuf.get(), kMultipartWindow);
+            if (rd == 0) {
+                mError = "Incomplete form data.";
+                return false;
+            }
+            mLen = rd;
+        }
+        mPos += mParser.feed(mBuf.get() + mPos, mLen - mPos);
+        if (mParser.failed()) {
+            mError = mParser.error();
             return false;
         }
-        // Meta content: between the meta part's header terminator and the boundary
-        // that precedes the file part.
-        size_t metaHeaderEnd = head.find("\r\n\r\n", metaPos);
-        if (metaHeaderEnd == std::string::npos) {
-            outError = "Incomplete form data.";
+        return true;
+    }
+
+    size_t MultipartReader::read(void* dst, size_t n)
+    {
+        uint8_t* out = static_cast<uint8_t*>(dst);
+        size_t got   = 0;
+        while (got < n) {
+            if (mSpanLen == 0) {
+                if (!mInPart || !pump()) {
+                    break;
+                }
+                continue;
+            }
+            size_t take = std::min(n - got, mSpanLen);
+            std::memcpy(out + got, mSpan, take);
+            mSpan += take;
+            mSpanLen -= take;
+            got += take;
+        }
+        return got;
+    }
+
+    bool MultipartReader::nextPart(std::string& outHeaders)
+    {
+        outHeaders.clear();
+        // Drop what the caller left of the current part (the preamble, first).
+        mSpanLen = 0;
+        while (!mPartBegun) {
+            if (!pump()) {
+                return false;
+            }
+            mSpanLen = 0;
+        }
+        mPartBegun = false;
+        outHeaders = std::move(mHeaders);
+        return true;
+    }
+
+    bool beginUpload(MultipartReader& parts, std::string& outMeta, std::string& outError)
+    {
+        // The meta JSON is a few hundred bytes; anything near this cap is not
+        // one of ours.
+        static const size_t kMaxMeta = 64 * 1024;
+
+        outMeta.clear();
+        std::string headers;
+        do {
+            if (!parts.nextPart(headers)) {
+                outError = parts.error().empty() ? "Incomplete form data." : parts.error();
+                return false;
+            }
+        } while (partFieldName(headers) != "meta");
+        char buf[4096];
+        size_t rd;
+        while ((rd = parts.read(buf, sizeof(buf))) > 0) {
+            if (outMeta.size() + rd > kMaxMeta) {
+                outError = "Upload meta too large.";
+                return false;
+            }
+            outMeta.append(buf, rd);
+        }
+        do {
+            if (!parts.nextPart(headers)) {
+                outError = parts.error().empty() ? "Incomplete form data." : parts.error();
+                return false;
+            }
+        } while (partFieldName(headers) != "file");
+        return true;
+    }
+
+    bool endUpload(MultipartReader& parts, std::string& outError)
+    {
+        std::string headers;
+        if (parts.nextPart(headers) || !parts.finished()) {
+            outError = parts.error().empty() ? "Unexpected form data after the file part." : parts.error();
             return false;
         }
-        size_t metaDataStart = metaHeaderEnd + 4;
-        size_t metaDataEnd   = head.find(nextBoundaryMarker, metaDataStart);
-        if (metaDataEnd == std::string::npos || metaDataEnd > filePos) {
-            outError = "Incomplete form data.";
+        return true;
+    }
+
+    ChunkedReader::ChunkedReader(ByteReader& in) : mIn(in), mBuf(new uint8_t[kChunkWindow]) {}
+
+    bool ChunkedReader::fill()
+    {
+        mPos = 0;
+        mLen = mIn.read(mBuf.get(), kChunkWindow);
+        if (mLen == 0) {
+            mError = "Incomplete chunked body.";
             return false;
         }
-        outMeta = head.substr(metaDataStart, metaDataEnd - metaDataStart);
+        return true;
+    }
+
+    bool ChunkedReader::readLine(std::string& outLine)
+    {
+        outLine.clear();
+        while (true) {
+            if (mPos == mLen && !fill()) {
+                return false;
+            }
+            const uint8_t* start = mBuf.get() + mPos;
+            const uint8_t* lf    = static_cast<const uint8_t*>(std::memchr(start, '\n', mLen - mPos));
+            size_t take          = lf != nullptr ? (size_t)(lf - start) : mLen - mPos;
+            if (outLine.size() + take > kMaxChunkLine) {
+                mError = "Malformed chunked body.";
+                return false;
+            }
+            outLine.append(reinterpret_cast<const char*>(start), take);
+            mPos += take;
+            if (lf != nullptr) {
+                mPos++;
+                if (!outLine.empty() && outLine.back() == '\r') {
+                    outLine.pop_back();
+                }
+                return true;
+            }
+        }
+    }
 
-        // File data begins right after the file part's header terminator.
-        size_t fileHeaderEnd = head.find("\r\n\r\n", filePos);
-        if (fileHeaderEnd == std::string::npos) {
-            outError = "Incomplete form data.";
+    // Consumes the CRLF closing the previous chunk and the next chunk-size line.
+    // A zero size ends the body: its trailer lines are skipped up to the blank
+    // line, and false is returned with mFinished set.
+    bool ChunkedReader::nextChunk()
+    {
+        std::string line;
+        if (!mFirstChunk) {
+            if (!readLine(line)) {
+                return false;
+            }
+            if (!line.empty()) {
+                mError = "Malformed chunked body.";
+                return false;
+            }
+        }
+        mFirstChunk = false;
+        if (!readLine(line)) {
+            return false;
+        }
+        // Chunk extensions (";name=value") carry nothing we use.
+        std::string digits = line.substr(0, line.find(';'));
+        while (!digits.empty() && (digits.back() == ' ' || digits.back() == '\t')) {
+            digits.pop_back();
+        }
+        bool hex = !digits.empty() && digits.size() <= 15 &&
+                   std::all_of(digits.begin(), digits.end(), [](unsigned char c) { return std::isxdigit(c) != 0; });
+        if (!hex) {
+            mError = "Malformed chunked body.";
             return false;
         }
-        uint64_t fileDataStart = (uint64_t)fileHeaderEnd + 4;
+        mChunkLeft = std::strtoull(digits.c_str(), nullptr, 16);
+        if (mChunkLeft > 0) {
+            return true;
+        }
+        while (true) {
+            if (!readLine(line)) {
+                return false;
+            }
+            if (line.empty()) {
+                mFinished = true;
+                return false;
+            }
+        }
+    }
+
+    size_t ChunkedReader::read(void* dst, size_t n)
+    {
+        if (mChunkLeft == 0 && (mFinished || failed() || !nextChunk())) {
+            return 0;
+        }
+        if (mPos == mLen && !fill()) {
+            return 0;
+        }
+        size_t take = std::min(n, mLen - mPos);
+        if (take > mChunkLeft) {
+            take = (size_t)mChunkLeft;
+        }
+        std::memcpy(dst, mBuf.get() + mPos, take);
+        mPos += take;
+        mChunkLeft -= take;
+        return take;
+    }
+
+    bool ChunkedSink::sendAll(const void* data, size_t len)
+    {
+        // A zero-size chunk would end the body early; there is nothing to send.
+        if (len == 0) {
+            return true;
+        }
+        char sizeLine[24];
+        int sizeLen = snprintf(sizeLine, sizeof(sizeLine), "%zx\r\n", len);
+        return mOut.sendAll(sizeLine, (size_t)sizeLen) && mOut.sendAll(data, len) && mOut.sendAll("\r\n", 2);
+    }
+
+    bool ChunkedSink::finish()
+    {
+        return mOut.sendAll("0\r\n\r\n", 5);
+    }
+
+    CoalescingSink::CoalescingSink(ByteSink& out, size_t capacity)
+        : mOut(out), mBuf(new uint8_t[std::max(capacity, kDirect)]), mCapacity(std::max(capacity, kDirect))
+    {
+    }
+
+    bool CoalescingSink::sendAll(const void* data, size_t len)
+    {
+        const uint8_t* src = static_cast<const uint8_t*>(data);
+        if (len > mCapacity - mLen && len >= kDirect) {
+            return flush() && mOut.sendAll(src, len);
+        }
+        while (len > 0) {
+            size_t take = std::min(len, mCapacity - mLen);
+            std::memcpy(mBuf.get() + mLen, src, take);
+            mLen += take;
+            src += take;
+            len -= take;
+            if (mLen == mCapacity && !flush()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool CoalescingSink::flush()
+    {
+        if (mLen == 0) {
+            return true;
+        }
+        size_t len = mLen;
+        mLen       = 0;
+        return mOut.sendAll(mBuf.get(), len);
+    }
+
+    ReadAheadReader::ReadAheadReader(FileReader& src, const std::vector<SendFile>& files, size_t depth)
+        : mSrc(src), mFiles(files), mSlots(std::max<size_t>(depth, 2))
+    {
+        for (auto& slot : mSlots) {
+            slot.data.reset(new uint8_t[kChunk]);
+        }
+    }
+
+    void ReadAheadReader::produce()
+    {
+        for (size_t i = 0; i < mFiles.size(); i++) {
+            bool opened        = mSrc.open(mFiles[i].absPath);
+            uint64_t remaining = opened ? mFiles[i].size : 0;
+            bool ended         = false;
+            while (!ended) {
+                Slot* slot = nullptr;
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCv.wait(lock, [this]() { return mStop || mCount < mSlots.size(); });
+                    if (!mStop) {
+                        slot = &mSlots[(mHead + mCount) % mSlots.size()];
+                    }
+                }
+                if (slot == nullptr) {
+                    if (opened) {
+                        mSrc.close();
+                    }
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mDone = true;
+                    mCv.notify_all();
+                    return;
+                }
+                // The slot is the producer's until it is counted in, so the read
+                // itself runs unlocked.
+                slot->file   = i;
+                slot->failed = !opened;
+                slot->len    = 0;
+                if (opened && remaining > 0) {
+                    slot->len = mSrc.read(slot->data.get(), (size_t)std::min<uint64_t>(remaining, kChunk));
+                    remaining = slot->len == 0 ? 0 : remaining - slot->len;
+                }
+                ended = slot->len == 0;
+                std::lock_guard<std::mutex> lock(mMutex);
+                mCount++;
+                mCv.notify_all();
+            }
+            if (opened) {
+                mSrc.close();
+            }
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDone = true;
+        mCv.notify_all();
+    }
+
+    void ReadAheadReader::stop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mStop = true;
+        mCv.notify_all();
+        mCv.wait(lock, [this]() { return mDone; });
+    }
+
+    ReadAheadReader::Slot* ReadAheadReader::front()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCv.wait(lock, [this]() { return mCount > 0 || mDone; });
+        return mCount > 0 ? &mSlots[mHead] : nullptr;
+    }
 
-        // The body ends with "\r\n--boundary--\r\n"; the file data is everything
-        // between fileDataStart and that trailing delimiter.
-        std::string trailer = "\r\n" + boundaryMarker + "--\r\n";
-        if (bodyLen < fileDataStart + trailer.size()) {
-            outError = "Incomplete form data.";
+    void ReadAheadReader::pop()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mHead = (mHead + 1) % mSlots.size();
+        mCount--;
+        mPos = 0;
+        mCv.notify_all();
+    }
+
+    bool ReadAheadReader::open(const std::string& absPath)
+    {
+        // Files come in the order produce() reads them; whatever is left of
+        // earlier ones (a file abandoned part way) is dropped.
+        size_t index = mNext;
+        while (index < mFiles.size() && mFiles[index].absPath != absPath) {
+            index++;
+        }
+        if (index == mFiles.size()) {
+            return false;
+        }
+        mNext = index + 1;
+        mFile = index;
+        Slot* slot;
+        while ((slot = front()) != nullptr && slot->file < index) {
+            pop();
+        }
+        if (slot == nullptr || slot->failed) {
+            if (slot != nullptr) {
+                pop();
+            }
             return false;
         }
-        outFileOffset = fileDataStart;
-        outFileLen    = bodyLen - fileDataStart - trailer.size();
         return true;
     }
 
+    size_t ReadAheadReader::read(void* dst, size_t n)
+    {
+        Slot* slot = front();
+        // The empty slot that ends the file stays put for the next open().
+        if (slot == nullptr || slot->file != mFile || slot->len == 0) {
+            return 0;
+        }
+        size_t take = std::min(n, slot->len - mPos);
+        std::memcpy(dst, slot->data.get() + mPos, take);
+        mPos += take;
+        if (mPos == slot->len) {
+            pop();
+        }
+        return take;
+    }
+
     bool extractZip(ByteReader& in, uint64_t limit, ExtractSink& sink, const CancelFn& cancelled, const ProgressFn& onBytes, std::string& outError)
     {
         uint64_t consumed = 0;
+        // Input the inflater read past the end of a deflate stream: the start of
+        // whatever follows it. Served before the source, and already counted in
+        // `consumed`.
+        const uint8_t* pending = nullptr;
+        size_t pendingLen      = 0;
         // Reads through the raw source but never past the file part's limit; the
         // adapter's ByteReader knows nothing about framing, so the bound lives here.
+        // A socket-backed source hands back whatever has arrived, so keep reading
+        // until `n` bytes are in or the source is exhausted.
         auto readInto = [&](void* dst, size_t n) -> size_t {
+            size_t got = 0;
+            if (pendingLen > 0) {
+                got = std::min(n, pendingLen);
+                std::memcpy(dst, pending, got);
+                pending += got;
+                pendingLen -= got;
+            }
+            if (consumed + (n - got) > limit) {
+                n = got + (size_t)(limit - consumed);
+            }
+            while (got < n) {
+                size_t rd = in.read((uint8_t*)dst + got, n - got);
+                if (rd == 0) {
+                    break;
+                }
+                consumed += rd;
+                got += rd;
+            }
+            return got;
+        };
+        // One read, for the inflater's input: it takes whatever has arrived.
+        auto readSome = [&](void* dst, size_t n) -> size_t {
             if (consumed + n > limit) {
                 n = (size_t)(limit - consumed);
             }
-            if (n == 0) {
-                return 0;
-            }
-            size_t rd = in.read(dst, n);
+            size_t rd = n > 0 ? in.read(dst, n) : 0;
             consumed += rd;
             return rd;
         };
+        auto le16 = [](const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); };
+        auto le32 = [](const uint8_t* p) { return (uint32_t)(p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24)); };
+        auto le64 = [&](const uint8_t* p) { return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32); };
 
         static const size_t kBuf = 0x40000;
         std::unique_ptr<uint8_t[]> buf(new uint8_t[kBuf]);
+        // Compressed input and the inflater, set up by the first deflated entry.
+        std::unique_ptr<uint8_t[]> inBuf;
+        z_stream strm;
+        bool inflating = false;
+        struct InflateGuard {
+            z_stream& strm;
+            bool& active;
+            ~InflateGuard()
+            {
+                if (active) {
+                    inflateEnd(&strm);
+                }
+            }
+        } inflateGuard{strm, inflating};
 
         bool ok = true;
-        while (consumed + 4 <= limit) {
+        while (pendingLen > 0 || consumed + 4 <= limit) {
             uint8_t sigBuf[4];
             if (readInto(sigBuf, 4) != 4) {
                 break;
             }
-            uint32_t sig = (uint32_t)(sigBuf[0] | (sigBuf[1] << 8) | (sigBuf[2] << 16) | ((uint32_t)sigBuf[3] << 24));
+            uint32_t sig = le32(sigBuf);
             if (sig != 0x04034b50) {
                 break;
             }
@@ -362,13 +1025,13 @@ namespace TransferProto {
                 ok       = false;
                 break;
             }
-            uint16_t flags       = (uint16_t)(hdr[2] | (hdr[3] << 8));
-            uint16_t compression = (uint16_t)(hdr[4] | (hdr[5] << 8));
-            uint32_t crc         = (uint32_t)(hdr[10] | (hdr[11] << 8) | (hdr[12] << 16) | ((uint32_t)hdr[13] << 24));
-            uint32_t compSize    = (uint32_t)(hdr[14] | (hdr[15] << 8) | (hdr[16] << 16) | ((uint32_t)hdr[17] << 24));
-            uint32_t uncompSize  = (uint32_t)(hdr[18] | (hdr[19] << 8) | (hdr[20] << 16) | ((uint32_t)hdr[21] << 24));
-            uint16_t nameLen     = (uint16_t)(hdr[22] | (hdr[23] << 8));
-            uint16_t extraLen    = (uint16_t)(hdr[24] | (hdr[25] << 8));
+            uint16_t flags       = le16(hdr + 2);
+            uint16_t compression = le16(hdr + 4);
+            uint32_t crc         = le32(hdr + 10);
+            uint64_t compSize    = le32(hdr + 14);
+            uint64_t uncompSize  = le32(hdr + 18);
+            uint16_t nameLen     = le16(hdr + 22);
+            uint16_t extraLen    = le16(hdr + 24);
 
             std::string name;
             name.resize(nameLen);
@@ -377,6 +1040,10 @@ namespace TransferProto {
                 ok       = false;
                 break;
             }
+            // A zip64 extra carries the sizes whose 32-bit fields hold the
+            // sentinel (uncompressed first), and marks the entry's data
+            // descriptor as the 64-bit kind.
+            bool zip64 = false;
             if (extraLen > 0) {
                 std::unique_ptr<uint8_t[]> extra(new uint8_t[extraLen]);
                 if (readInto(extra.get(), extraLen) != extraLen) {
@@ -384,12 +1051,31 @@ namespace TransferProto {
                     ok       = false;
                     break;
                 }
+                for (size_t pos = 0; pos + 4 <= extraLen;) {
+                    uint16_t id      = le16(extra.get() + pos);
+                    size_t len       = le16(extra.get() + pos + 2);
+                    const uint8_t* p = extra.get() + pos + 4;
+                    const uint8_t* e = p + std::min(len, (size_t)extraLen - pos - 4);
+                    if (id == kZip64ExtraId) {
+                        zip64 = true;
+                        if (uncompSize == kZip32Max && p + 8 <= e) {
+                            uncompSize = le64(p);
+                            p += 8;
+                        }
+                        if (compSize == kZip32Max && p + 8 <= e) {
+                            compSize = le64(p);
+                        }
+                    }
+                    pos += 4 + len;
+                }
             }
 
-            // Data-descriptor entries (flag bit 3) are accepted as long as the
-            // local header still carries the real sizes, which is what the
-            // console senders emit when streaming a zip without staging it.
-            if (compression != 0) {
+            // Stored data-descriptor entries (flag bit 3) are accepted as long as
+            // the local header still carries the real sizes, which is what the
+            // console senders emit when streaming a zip without staging it. A
+            // deflated entry needs no sizes: the stream itself marks its end.
+            bool deflated = compression == (uint16_t)ZipMethod::Deflate;
+            if (compression != (uint16_t)ZipMethod::Store && !deflated) {
                 outError = "Unsupported ZIP compression.";
                 ok       = false;
                 break;
@@ -400,108 +1086,195 @@ namespace TransferProto {
                 break;
             }
 
-            if (!name.empty() && name.back() == '/') {
-                if (!sink.makeDir(name)) {
-                    outError = "Failed to write extracted file.";
-                    ok       = false;
-                    break;
-                }
-                continue;
-            }
-
-            if (!sink.beginFile(name, uncompSize)) {
+            // A directory entry normally carries no data, but some writers still
+            // frame one as an (empty) deflate stream or with a data descriptor;
+            // it runs through the data path below either way so the stream stays
+            // in sync, just without a file to write to.
+            bool isDirectory = !name.empty() && name.back() == '/';
+            if (!(isDirectory ? sink.makeDir(name) : sink.beginFile(name, uncompSize))) {
                 outError = "Failed to write extracted file.";
                 ok       = false;
                 break;
             }
 
             uint32_t computedCrc = 0xFFFFFFFFu;
-            uint32_t remaining   = compSize;
+            uint64_t written     = 0;
             bool fileOk          = true;
-            while (remaining > 0) {
-                if (cancelled && cancelled()) {
-                    outError = "Transfer cancelled.";
-                    fileOk   = false;
-                    break;
-                }
-                uint32_t chunk = remaining > kBuf ? (uint32_t)kBuf : remaining;
-                size_t rd      = readInto(buf.get(), chunk);
-                if (rd == 0) {
-                    outError = "Corrupted ZIP payload.";
-                    fileOk   = false;
-                    break;
+            // Every extracted byte, stored or inflated, goes out through here.
+            auto emit = [&](const uint8_t* data, size_t n) {
+                computedCrc = updateCrc(computedCrc, data, n);
+                if (!isDirectory) {
+                    sink.writeFile(data, n);
                 }
-                computedCrc = updateCrc(computedCrc, buf.get(), rd);
-                sink.writeFile(buf.get(), rd);
-                remaining -= (uint32_t)rd;
+                written += n;
                 if (onBytes) {
-                    onBytes(rd);
+                    onBytes(n);
+                }
+            };
+            if (!deflated) {
+                uint64_t remaining = compSize;
+                while (remaining > 0) {
+                    if (cancelled && cancelled()) {
+                        outError = "Transfer cancelled.";
+                        fileOk   = false;
+                        break;
+                    }
+                    size_t chunk = remaining > kBuf ? kBuf : (size_t)remaining;
+                    size_t rd    = readInto(buf.get(), chunk);
+                    if (rd == 0) {
+                        outError = "Corrupted ZIP payload.";
+                        fileOk   = false;
+                        break;
+                    }
+                    emit(buf.get(), rd);
+                    remaining -= rd;
+                }
+            }
+            else {
+                if (!inflating) {
+                    std::memset(&strm, 0, sizeof(strm));
+                    // Negative window bits: raw deflate, as zip stores it.
+                    if (inflateInit2(&strm, -MAX_WBITS) != Z_OK) {
+                        outError = "Failed to write extracted file.";
+                        if (!isDirectory) {
+                            sink.endFile();
+                        }
+                        ok = false;
+                        break;
+                    }
+                    inflating = true;
+                    inBuf.reset(new uint8_t[kBuf]);
+                }
+                else {
+                    inflateReset(&strm);
+                }
+                strm.avail_in = 0;
+                compSize      = 0;
+                while (true) {
+                    if (cancelled && cancelled()) {
+                        outError = "Transfer cancelled.";
+                        fileOk   = false;
+                        break;
+                    }
+                    if (strm.avail_in == 0) {
+                        if (pendingLen > 0) {
+                            strm.next_in  = const_cast<Bytef*>(pending);
+                            strm.avail_in = (uInt)pendingLen;
+                            compSize += pendingLen;
+                            pendingLen = 0;
+                        }
+                        else {
+                            size_t rd = readSome(inBuf.get(), kBuf);
+                            if (rd == 0) {
+                                outError = "Corrupted ZIP payload.";
+                                fileOk   = false;
+                                break;
+                            }
+                            strm.next_in  = inBuf.get();
+                            strm.avail_in = (uInt)rd;
+                            compSize += rd;
+                        }
+                    }
+                    strm.next_out  = buf.get();
+                    strm.avail_out = (uInt)kBuf;
+                    int zr         = inflate(&strm, Z_NO_FLUSH);
+                    if (zr != Z_OK && zr != Z_STREAM_END && !(zr == Z_BUF_ERROR && strm.avail_in == 0)) {
+                        outError = "Corrupted ZIP payload.";
+                        fileOk   = false;
+                        break;
+                    }
+                    size_t produced = kBuf - strm.avail_out;
+                    if (produced > 0) {
+                        emit(buf.get(), produced);
+                    }
+                    if (zr == Z_STREAM_END) {
+                        // The rest of the input belongs to the next record.
+                        pending    = strm.next_in;
+                        pendingLen = strm.avail_in;
+                        compSize -= pendingLen;
+                        break;
+                    }
                 }
             }
-            sink.endFile();
+            if (!isDirectory) {
+                sink.endFile();
+            }
             if (!fileOk) {
                 ok = false;
                 break;
             }
 
-            // With flag bit 3 the local-header CRC field is zero and the real
-            // CRC follows the data in a data descriptor (optionally prefixed
-            // with its own signature).
+            // With flag bit 3 the local-header CRC (and, for a deflated entry,
+            // the sizes) are zero and the real values follow the data in a data
+            // descriptor (optionally prefixed with its own signature), whose
+            // sizes are 8 bytes wide for a zip64 entry. Writers that only learn
+            // an entry needs zip64 once it is written (Go's archive/zip, for
+            // one) widen the descriptor without a zip64 extra, so sizes that no
+            // longer fit 32 bits mean the same.
             if (flags & 0x08) {
-                uint8_t desc[16];
+                uint8_t desc[24];
+                bool wide       = zip64 || (deflated && (written >= kZip32Max || compSize >= kZip32Max));
+                size_t sizesLen = wide ? 16 : 8;
                 if (readInto(desc, 4) != 4) {
                     outError = "Corrupted ZIP payload.";
                     ok       = false;
                     break;
                 }
-                uint32_t first = (uint32_t)(desc[0] | (desc[1] << 8) | (desc[2] << 16) | ((uint32_t)desc[3] << 24));
-                if (first == 0x08074b50) {
-                    if (readInto(desc + 4, 12) != 12) {
+                uint8_t* fields = desc;
+                if (le32(desc) == 0x08074b50) {
+                    if (readInto(desc + 4, 4) != 4) {
                         outError = "Corrupted ZIP payload.";
                         ok       = false;
                         break;
                     }
-                    crc = (uint32_t)(desc[4] | (desc[5] << 8) | (desc[6] << 16) | ((uint32_t)desc[7] << 24));
+                    fields = desc + 4;
                 }
-                else {
-                    if (readInto(desc + 4, 8) != 8) {
-                        outError = "Corrupted ZIP payload.";
-                        ok       = false;
-                        break;
-                    }
-                    crc = first;
+                if (readInto(fields + 4, sizesLen) != sizesLen) {
+                    outError = "Corrupted ZIP payload.";
+                    ok       = false;
+                    break;
                 }
+                crc        = le32(fields);
+                uncompSize = wide ? le64(fields + 12) : le32(fields + 8);
             }
 
-            // Verify the extracted data against the CRC stored in the ZIP entry,
-            // so a corrupted or truncated transfer is rejected instead of being
-            // written out as-is.
+            // Verify the extracted data against the CRC (and, for a deflated
+            // entry, the size) stored in the ZIP entry, so a corrupted or
+            // truncated transfer is rejected instead of being written out as-is.
             computedCrc ^= 0xFFFFFFFFu;
-            if (computedCrc != crc) {
+            if (computedCrc != crc || (deflated && written != uncompSize)) {
                 outError = "Checksum mismatch in received file.";
                 ok       = false;
                 break;
             }
+            if (!isDirectory) {
+                sink.fileVerified(ManifestEntry{name, written, crc});
+            }
         }
 
         return ok;
     }
 
     bool sendZipStream(ByteSink& out, const std::vector<SendFile>& files, const std::vector<std::string>& dirs, FileReader& src,
-        const CancelFn& cancelled, const ProgressFn& onBytes, bool& wasCancelled)
+        ZipMethod method, const CancelFn& cancelled, const ProgressFn& onBytes, bool& wasCancelled)
     {
         wasCancelled = false;
 
+        const bool deflated = method == ZipMethod::Deflate;
         std::vector<ZipEntry> central;
         central.reserve(dirs.size() + files.size());
-        uint32_t offset = 0;
+        uint64_t offset = 0;
 
+        // Every entry is a local header, its data and a data descriptor, so a
+        // save of many small files would otherwise go out as a flood of tiny
+        // sends; batched gathers them into full buffers.
+        CoalescingSink batched(out);
         auto sendChunk = [&](const void* data, size_t n) -> bool {
-            if (!out.sendAll(data, n)) {
+            if (!batched.sendAll(data, n)) {
                 return false;
             }
-            offset += (uint32_t)n;
-            if (onBytes) {
+            offset += n;
+            if (onBytes && !deflated) {
                 onBytes(n);
             }
             return true;
@@ -512,13 +1285,15 @@ namespace TransferProto {
             centralEntry.name        = dir;
             centralEntry.crc         = 0;
             centralEntry.size        = 0;
+            centralEntry.compSize    = 0;
             centralEntry.offset      = offset;
+            centralEntry.method      = ZipMethod::Store;
             centralEntry.isDirectory = true;
 
             std::string hdr;
             hdr.reserve(30 + dir.size());
             appendLe32(hdr, 0x04034b50);
-            appendLe16(hdr, 20);
+            appendLe16(hdr, kZipVersion);
             appendLe16(hdr, 0);
             appendLe16(hdr, 0);
             appendLe16(hdr, 0);
@@ -538,46 +1313,115 @@ namespace TransferProto {
 
         static const size_t kBuf = 0x40000;
         std::unique_ptr<uint8_t[]> buf(new uint8_t[kBuf]);
+        // Compressed output, flushed to `out` a full buffer at a time so each
+        // send (and, through a ChunkedSink, each chunk) stays large.
+        std::unique_ptr<uint8_t[]> zbuf;
+        z_stream strm;
+        bool deflating = false;
+        struct DeflateGuard {
+            z_stream& strm;
+            bool& active;
+            ~DeflateGuard()
+            {
+                if (active) {
+                    deflateEnd(&strm);
+                }
+            }
+        } deflateGuard{strm, deflating};
+        if (deflated && !files.empty()) {
+            std::memset(&strm, 0, sizeof(strm));
+            // Raw deflate (negative window bits), as zip stores it. Fastest
+            // level: the consoles' CPUs are slow and save data is mostly padding
+            // and zeroed slots, which even level 1 squeezes down.
+            if (deflateInit2(&strm, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                return false;
+            }
+            deflating = true;
+            zbuf.reset(new uint8_t[kBuf]);
+        }
 
         for (const auto& entry : files) {
             ZipEntry centralEntry;
             centralEntry.name        = entry.relPath;
             centralEntry.crc         = 0;
             centralEntry.size        = entry.size;
+            centralEntry.compSize    = entry.size;
             centralEntry.offset      = offset;
+            centralEntry.method      = method;
             centralEntry.isDirectory = false;
 
+            // A deflated entry's compressed size is unknown until it has been
+            // sent, so its local header carries zeros and the data descriptor
+            // the real values, as for the CRC. A zip64 entry puts the sentinel in
+            // both size fields and the sizes (or zeros) in its zip64 extra.
+            bool zip64       = zip64Entry(entry.size, method);
+            uint64_t hdrSize = deflated ? 0 : entry.size;
             std::string hdr;
-            hdr.reserve(30 + entry.relPath.size());
+            hdr.reserve(30 + entry.relPath.size() + 20);
             appendLe32(hdr, 0x04034b50);
-            appendLe16(hdr, 20);
+            appendLe16(hdr, zip64 ? kZip64Version : kZipVersion);
             appendLe16(hdr, 0x0008); // flag bit 3: CRC in the data descriptor
-            appendLe16(hdr, 0);
+            appendLe16(hdr, (uint16_t)method);
             appendLe16(hdr, 0);
             appendLe16(hdr, 0);
             appendLe32(hdr, 0); // CRC, carried by the data descriptor instead
-            appendLe32(hdr, entry.size);
-            appendLe32(hdr, entry.size);
+            appendLe32(hdr, zip64 ? (uint32_t)kZip32Max : (uint32_t)hdrSize);
+            appendLe32(hdr, zip64 ? (uint32_t)kZip32Max : (uint32_t)hdrSize);
             appendLe16(hdr, (uint16_t)entry.relPath.size());
-            appendLe16(hdr, 0);
+            appendLe16(hdr, zip64 ? 20 : 0);
             hdr.append(entry.relPath);
+            if (zip64) {
+                appendLe16(hdr, kZip64ExtraId);
+                appendLe16(hdr, 16);
+                appendLe64(hdr, hdrSize);
+                appendLe64(hdr, hdrSize);
+            }
             if (!sendChunk(hdr.data(), hdr.size())) {
                 return false;
             }
+            uint64_t dataStart = offset;
 
             if (!src.open(entry.absPath)) {
                 return false;
             }
+            if (deflated) {
+                deflateReset(&strm);
+                strm.next_out  = zbuf.get();
+                strm.avail_out = (uInt)kBuf;
+            }
+            // Runs the deflater over `in` (Z_FINISH at the end of the file),
+            // sending every full output buffer and, when finishing, the rest.
+            auto deflateChunk = [&](const uint8_t* in, size_t n, int flush) -> bool {
+                strm.next_in  = const_cast<Bytef*>(in);
+                strm.avail_in = (uInt)n;
+                while (true) {
+                    int zr = deflate(&strm, flush);
+                    if (zr == Z_STREAM_ERROR) {
+                        return false;
+                    }
+                    bool full = strm.avail_out == 0;
+                    if (full || (flush == Z_FINISH && zr == Z_STREAM_END)) {
+                        if (!sendChunk(zbuf.get(), kBuf - strm.avail_out)) {
+                            return false;
+                        }
+                        strm.next_out  = zbuf.get();
+                        strm.avail_out = (uInt)kBuf;
+                    }
+                    if (flush == Z_FINISH ? zr == Z_STREAM_END : (!full && strm.avail_in == 0)) {
+                        return true;
+                    }
+                }
+            };
             uint32_t crc       = 0xFFFFFFFFu;
-            uint32_t remaining = entry.size;
+            uint64_t remaining = entry.size;
             while (remaining > 0) {
                 if (cancelled && cancelled()) {
                     src.close();
                     wasCancelled = true;
                     return false;
                 }
-                uint32_t chunk = remaining > kBuf ? (uint32_t)kBuf : remaining;
-                size_t rd      = src.read(buf.get(), chunk);
+                size_t chunk = remaining > kBuf ? kBuf : (size_t)remaining;
+                size_t rd    = src.read(buf.get(), chunk);
                 if (rd == 0) {
                     // Short read: the promised sizes can no longer be met, so
                     // the transfer must fail rather than desync the stream.
@@ -585,21 +1429,42 @@ namespace TransferProto {
                     return false;
                 }
                 crc = updateCrc(crc, buf.get(), rd);
-                if (!sendChunk(buf.get(), rd)) {
+                if (!(deflated ? deflateChunk(buf.get(), rd, Z_NO_FLUSH) : sendChunk(buf.get(), rd))) {
                     src.close();
                     return false;
                 }
-                remaining -= (uint32_t)rd;
+                remaining -= rd;
+                if (onBytes && deflated) {
+                    onBytes(rd);
+                }
             }
             src.close();
             crc ^= 0xFFFFFFFFu;
+            if (deflated) {
+                if (!deflateChunk(nullptr, 0, Z_FINISH)) {
+                    return false;
+                }
+                centralEntry.compSize = offset - dataStart;
+                // zip64Entry leaves deflate more headroom than it can use, so
+                // this only trips on a broken deflater; the 32-bit descriptor
+                // must not be written with a wrapped size either way.
+                if (!zip64 && centralEntry.compSize >= kZip32Max) {
+                    return false;
+                }
+            }
 
             std::string desc;
-            desc.reserve(16);
+            desc.reserve(24);
             appendLe32(desc, 0x08074b50);
             appendLe32(desc, crc);
-            appendLe32(desc, entry.size);
-            appendLe32(desc, entry.size);
+            if (zip64) {
+                appendLe64(desc, centralEntry.compSize);
+                appendLe64(desc, entry.size);
+            }
+            else {
+                appendLe32(desc, (uint32_t)centralEntry.compSize);
+                appendLe32(desc, (uint32_t)entry.size);
+            }
             if (!sendChunk(desc.data(), desc.size())) {
                 return false;
             }
@@ -608,39 +1473,105 @@ namespace TransferProto {
             central.push_back(centralEntry);
         }
 
-        uint32_t centralOffset = offset;
+        uint64_t centralOffset = offset;
         std::string tail;
         for (const auto& entry : central) {
+            size_t extraSize = centralZip64ExtraSize(entry.size, entry.compSize, entry.offset);
             appendLe32(tail, 0x02014b50);
-            appendLe16(tail, 20);
-            appendLe16(tail, 20);
+            appendLe16(tail, extraSize > 0 ? kZip64Version : kZipVersion);
+            appendLe16(tail, extraSize > 0 ? kZip64Version : kZipVersion);
             appendLe16(tail, entry.isDirectory ? 0 : 0x0008);
-            appendLe16(tail, 0);
+            appendLe16(tail, (uint16_t)entry.method);
             appendLe16(tail, 0);
             appendLe16(tail, 0);
             appendLe32(tail, entry.crc);
-            appendLe32(tail, entry.size);
-            appendLe32(tail, entry.size);
+            appendLe32(tail, (uint32_t)std::min(entry.compSize, kZip32Max));
+            appendLe32(tail, (uint32_t)std::min(entry.size, kZip32Max));
             appendLe16(tail, (uint16_t)entry.name.size());
-            appendLe16(tail, 0);
+            appendLe16(tail, (uint16_t)extraSize);
             appendLe16(tail, 0);
             appendLe16(tail, 0);
             appendLe16(tail, 0);
             appendLe32(tail, entry.isDirectory ? 0x10 : 0); // MS-DOS directory attribute (matches chlink)
-            appendLe32(tail, entry.offset);
+            appendLe32(tail, (uint32_t)std::min(entry.offset, kZip32Max));
             tail.append(entry.name);
+            if (extraSize > 0) {
+                appendLe16(tail, kZip64ExtraId);
+                appendLe16(tail, (uint16_t)(extraSize - 4));
+                if (entry.size >= kZip32Max) {
+                    appendLe64(tail, entry.size);
+                }
+                if (entry.compSize >= kZip32Max) {
+                    appendLe64(tail, entry.compSize);
+                }
+                if (entry.offset >= kZip32Max) {
+                    appendLe64(tail, entry.offset);
+                }
+            }
         }
 
-        uint32_t centralSize = (uint32_t)tail.size();
+        uint64_t centralSize = tail.size();
+        if (zip64End(central.size(), centralSize, centralOffset)) {
+            // Zip64 end of central directory record, then the locator pointing
+            // at it; the classic end record below then holds sentinels.
+            uint64_t zip64EndOffset = centralOffset + centralSize;
+            appendLe32(tail, 0x06064b50);
+            appendLe64(tail, 44); // size of the rest of this record
+            appendLe16(tail, kZip64Version);
+            appendLe16(tail, kZip64Version);
+            appendLe32(tail, 0);
+            appendLe32(tail, 0);
+            appendLe64(tail, central.size());
+            appendLe64(tail, central.size());
+            appendLe64(tail, centralSize);
+            appendLe64(tail, centralOffset);
+
+            appendLe32(tail, 0x07064b50);
+            appendLe32(tail, 0);
+            appendLe64(tail, zip64EndOffset);
+            appendLe32(tail, 1);
+        }
+        uint16_t entryCount = (uint16_t)std::min<size_t>(central.size(), 0xFFFF);
         appendLe32(tail, 0x06054b50);
         appendLe16(tail, 0);
         appendLe16(tail, 0);
-        appendLe16(tail, (uint16_t)central.size());
-        appendLe16(tail, (uint16_t)central.size());
-        appendLe32(tail, centralSize);
-        appendLe32(tail, centralOffset);
+        appendLe16(tail, entryCount);
+        appendLe16(tail, entryCount);
+        appendLe32(tail, (uint32_t)std::min(centralSize, kZip32Max));
+        appendLe32(tail, (uint32_t)std::min(centralOffset, kZip32Max));
         appendLe16(tail, 0);
 
-        return sendChunk(tail.data(), tail.size());
+        return sendChunk(tail.data(), tail.size()) && batched.flush();
+    }
+
+    bool fileCrc(FileReader& src, const std::string& absPath, const CancelFn& cancelled, const ProgressFn& onBytes, uint32_t& outCrc,
+        uint64_t& outSize)
+    {
+        if (!src.open(absPath)) {
+            return false;
+        }
+        static const size_t kBuf = 0x40000;
+        std::unique_ptr<uint8_t[]> buf(new uint8_t[kBuf]);
+        uint32_t crc  = 0xFFFFFFFFu;
+        uint64_t size = 0;
+        while (true) {
+            if (cancelled && cancelled()) {
+                src.close();
+                return false;
+            }
+            size_t rd = src.read(buf.get(), kBuf);
+            if (rd == 0) {
+                break;
+            }
+            crc = updateCrc(crc, buf.get(), rd);
+            size += rd;
+            if (onBytes) {
+                onBytes(rd);
+            }
+        }
+        src.close();
+        outCrc  = crc ^ 0xFFFFFFFFu;
+        outSize = size;
+        return true;
     }
 }
@@ -27,8 +27,11 @@
 #ifndef TRANSFERPROTOCOL_HPP
 #define TRANSFERPROTOCOL_HPP
 
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <vector>
@@ -39,13 +42,22 @@
 // auth rules lands once and applies to both consoles. The per-target
 // transfer.cpp files own the file+socket IO and call into these.
 namespace TransferProto {
-    // Zip central-directory record accumulated while a store-only archive is
-    // streamed out; consumed when the central directory is written.
+    // Compression method of a zip entry, as stored in its local header. Store is
+    // what every receiver understands; Deflate only goes to a receiver that
+    // advertises it in GET /transfer/info ("zipMethods").
+    enum class ZipMethod : uint16_t { Store = 0, Deflate = 8 };
+
+    // Zip central-directory record accumulated while an archive is streamed out;
+    // consumed when the central directory is written. Sizes and offsets are
+    // 64-bit: whichever of them does not fit the 32-bit field goes to a zip64
+    // extra instead.
     struct ZipEntry {
         std::string name;
         uint32_t crc;
-        uint32_t size;
-        uint32_t offset;
+        uint64_t size;
+        uint64_t compSize;
+        uint64_t offset;
+        ZipMethod method;
         bool isDirectory;
     };
 
@@ -58,6 +70,7 @@ namespace TransferProto {
     // Append a little-endian integer to a byte buffer (zip fields are LE).
     void appendLe16(std::string& out, uint16_t v);
     void appendLe32(std::string& out, uint32_t v);
+    void appendLe64(std::string& out, uint64_t v);
 
     // One file queued for the send path. Paths are UTF-8; the 3DS adapter
     // converts `absPath` to UTF-16 when it opens the file, so the shared code
@@ -65,22 +78,54 @@ namespace TransferProto {
     struct SendFile {
         std::string absPath;
         std::string relPath;
-        uint32_t size;
+        uint64_t size;
+    };
+
+    // One file of a delta-transfer manifest. Before a zip upload, a sender whose
+    // receiver lists "delta" in /transfer/info posts every file's relative path,
+    // size and CRC32 to /transfer/manifest, along with the meta fields that name
+    // the target backup. The receiver answers with the paths it already holds
+    // byte-identical in that backup folder; the upload then zips only the rest
+    // and lists the held ones under the meta's "reuse" key, and the receiver
+    // copies those out of the backup it is replacing.
+    struct ManifestEntry {
+        std::string relPath;
+        uint64_t size;
+        uint32_t crc;
     };
 
-    // Largest size a store-only zip can frame. There are no zip64 records in the
-    // store-only archives the console senders emit, so a single entry or the
-    // whole stream exceeding 0xFFFFFFFF cannot be represented — the send path
-    // must refuse rather than let the size wrap to u32 and desync framing.
-    static constexpr uint64_t kZipMaxSize = 0xFFFFFFFFull;
+    // Resuming a zip upload that broke off. Every zip upload's meta carries an
+    // "uploadId". A receiver that loses the connection mid-body keeps the files
+    // it had already extracted and CRC-verified, and GET /transfer/resume (with
+    // the id in an X-CP-Upload-Id header) lists them as manifest entries, with
+    // their byte total. The sender re-checks each against its own copy and posts
+    // a continuation: the same upload id, the confirmed entries under the meta's
+    // "resume" key, and a zip of everything else. A receiver that no longer has
+    // every confirmed entry staged answers 409 without touching anything, and
+    // the sender posts the whole upload again.
+
+    // Sending many backups in one upload. A receiver that lists "batch" in
+    // /transfer/info takes a zip whose meta, instead of naming one backup, has
+    // a "backups" array of {titleId, titleName, dataType, backupName} objects.
+    // Each backup's entries sit under its decimal index in that array ("0/",
+    // "1/main", ...), and the receiver moves every one into the title folder
+    // its own object resolves to, once the whole zip checked out. A batch is a
+    // single request with a single PIN check; it does not take part in delta
+    // transfer or resuming.
+
+    // Zip fields that are 32 bits wide (sizes, offsets) hold this sentinel when
+    // the real value lives in the entry's zip64 extra; the 16-bit entry counts
+    // of the end record likewise hold 0xFFFF. The writer switches an entry, or
+    // the end of the archive, to zip64 records exactly when a value reaches the
+    // sentinel, so archives small enough for classic records stay classic and
+    // every reader can still open them.
+    static constexpr uint64_t kZip32Max = 0xFFFFFFFFull;
 
     // Exact byte size of the store-only zip that sendZipStream emits, used as the
-    // streamed HTTP Content-Length. Store-only entries make this deterministic.
-    // Computed in u64 and returns nullopt when the total exceeds kZipMaxSize, so
-    // an oversized backup fails cleanly instead of wrapping (mirrors the refusal
-    // in tools/chlink/zipwriter.go). Each SendFile.size must already be within
-    // kZipMaxSize — the adapter's file collector enforces the per-entry bound.
-    std::optional<uint64_t> zipStreamSize(const std::vector<SendFile>& files, const std::vector<std::string>& dirs);
+    // streamed HTTP Content-Length. Store-only entries make this deterministic,
+    // zip64 records included; a deflated stream has no size until it has been
+    // written, so it travels as a chunked body instead.
+    uint64_t zipStreamSize(const std::vector<SendFile>& files, const std::vector<std::string>& dirs);
 
     // Rejects a zip entry name that is absolute, contains a backslash or colon,
     // or traverses out of the destination via a ".." component. Applied to every
@@ -119,9 +164,9 @@ namespace TransferProto {
     // target (FSStream/u16string on 3DS, FILE*/string on Switch) and — for
     // tests — against in-memory buffers.
 
-    // Sequential byte source over the received multipart body. The adapter has
-    // already positioned it at the file part's start; extractZip owns the
-    // length accounting, so read() may return fewer bytes at EOF/error.
+    // Sequential byte source: the request body on the socket, or one part of it
+    // through MultipartReader. read() may return fewer bytes than asked and
+    // returns 0 at the end of the source or on error.
     struct ByteReader {
         virtual ~ByteReader()                    = default;
         virtual size_t read(void* dst, size_t n) = 0;
@@ -130,12 +175,17 @@ namespace TransferProto {
     // Destination for extracted zip entries, addressed by UTF-8 relative path
     // under a destination root the adapter already holds. beginFile opens the
     // next file (creating parent directories); writeFile/endFile stream it.
+    // sizeHint is the entry's uncompressed size, or 0 when the local header does
+    // not carry it (a deflated entry streamed with a data descriptor).
+    // fileVerified follows endFile once the entry's CRC checked out; a receiver
+    // that keeps an interrupted upload for resuming records what it was told.
     struct ExtractSink {
         virtual ~ExtractSink()                                                = default;
         virtual bool makeDir(const std::string& relPath)                      = 0;
-        virtual bool beginFile(const std::string& relPath, uint32_t sizeHint) = 0;
+        virtual bool beginFile(const std::string& relPath, uint64_t sizeHint) = 0;
         virtual bool writeFile(const void* data, size_t n)                    = 0;
         virtual void endFile()                                                = 0;
+        virtual void fileVerified(const ManifestEntry&) {}
     };
 
     // Source of a backup's files while streaming the send zip, addressed by the
@@ -160,25 +210,246 @@ namespace TransferProto {
 
     // ---- protocol algorithms over the seam --------------------------------
 
-    // Locate the meta part (returned in outMeta) and the file part's byte range
-    // within a multipart body, given a head window the adapter already read.
-    // Assumes the layout the console senders emit: meta part first, then a
-    // single file part that is the last part before the closing delimiter.
-    bool parseMultipart(const std::string& head, uint64_t bodyLen, const std::string& boundary, std::string& outMeta, uint64_t& outFileOffset,
-        uint64_t& outFileLen, std::string& outError);
+    // Returns the form field name from a part's Content-Disposition header
+    // ("meta", "file", ...), or "" when the part carries none.
+    std::string partFieldName(const std::string& partHeaders);
+
+    // Push-style multipart/form-data parser. feed() takes the body in chunks of
+    // any size, as they come off the wire, and the callbacks fire as parts begin,
+    // carry data and end — any number of parts, in any order. Part data is handed
+    // out as pointers into the fed chunk, never copied: the only bytes held back
+    // between feeds are a tail that may be the start of a delimiter split across
+    // two chunks, and since those always equal a prefix of the delimiter they are
+    // replayed from it if they turn out to be data after all.
+    class MultipartParser {
+    public:
+        // Each callback returns false to pause: feed() then returns early with
+        // the bytes consumed so far, and feeding the rest resumes the parse.
+        struct Callbacks {
+            std::function<bool(const std::string& headers)> onPartBegin;
+            std::function<bool(const uint8_t* data, size_t len)> onPartData;
+            std::function<bool()> onPartEnd;
+        };
+
+        MultipartParser(const std::string& boundary, Callbacks callbacks);
+
+        // Returns how many of the `len` bytes were consumed: all of them unless
+        // a callback paused the parse or the body is malformed (failed()).
+        size_t feed(const uint8_t* data, size_t len);
+
+        // The closing delimiter has been seen; anything fed afterwards is the
+        // epilogue and ignored.
+        bool done() const { return mState == State::Done; }
+        bool failed() const { return mState == State::Failed; }
+        const std::string& error() const { return mError; }
+
+    private:
+        enum class State { Preamble, AfterDelimiter, Headers, Body, Done, Failed };
+
+        bool delimiterFound();
+        void fail(const char* message);
+
+        Callbacks mCallbacks;
+        std::string mDelimiter;
+        size_t mMatched = 0; // bytes of mDelimiter matched at the end of the last feed
+        char mAfter[2];      // the two bytes after a delimiter: "--" or CRLF
+        size_t mAfterLen = 0;
+        std::string mHeaders;
+        State mState = State::Preamble;
+        std::string mError;
+    };
+
+    // Pull-style reader over a multipart/form-data body arriving through `in`,
+    // which on the receive path is the socket itself: the parts are parsed as
+    // the bytes come in, so the payload never has to be staged on the SD card
+    // before it can be located. nextPart() skips whatever is left of the current
+    // part and returns the next part's header block; read() then yields that
+    // part's data and returns 0 at its closing delimiter. A thin adapter over
+    // MultipartParser, so any chunking of `in` works.
+    class MultipartReader : public ByteReader {
+    public:
+        MultipartReader(ByteReader& in, const std::string& boundary);
+
+        // False once the closing delimiter has been consumed (finished()) or on
+        // a malformed or truncated body (error() says which).
+        bool nextPart(std::string& outHeaders);
+        size_t read(void* dst, size_t n) override;
+
+        bool finished() const { return mParser.done(); }
+        const std::string& error() const { return mError; }
+
+    private:
+        bool pump();
+
+        ByteReader& mIn;
+        MultipartParser mParser;
+        std::unique_ptr<uint8_t[]> mBuf;
+        size_t mPos = 0;
+        size_t mLen = 0;
+        // Set by the parser callbacks: the data span not yet copied out (it
+        // points into mBuf or the parser's delimiter), and the part boundaries.
+        const uint8_t* mSpan = nullptr;
+        size_t mSpanLen      = 0;
+        bool mInPart         = false;
+        bool mPartBegun      = false;
+        std::string mHeaders;
+        std::string mError;
+    };
+
+    // Decodes an HTTP/1.1 "Transfer-Encoding: chunked" body arriving through
+    // `in`, yielding the payload bytes with the chunk framing stripped. read()
+    // returns 0 once the terminating zero-size chunk and its trailer are consumed
+    // (finished()) or on a malformed or truncated body (failed()).
+    class ChunkedReader : public ByteReader {
+    public:
+        explicit ChunkedReader(ByteReader& in);
+
+        size_t read(void* dst, size_t n) override;
+
+        bool finished() const { return mFinished; }
+        bool failed() const { return !mError.empty(); }
+        const std::string& error() const { return mError; }
 
-    // Extract a store-only zip streamed through `in`, bounded to `limit` bytes.
+    private:
+        bool fill();
+        bool readLine(std::string& outLine);
+        bool nextChunk();
+
+        ByteReader& mIn;
+        std::unique_ptr<uint8_t[]> mBuf;
+        size_t mPos         = 0;
+        size_t mLen         = 0;
+        uint64_t mChunkLeft = 0;
+        bool mFirstChunk    = true;
+        bool mFinished      = false;
+        std::string mError;
+    };
+
+    // Encodes everything sent through it as "Transfer-Encoding: chunked", one
+    // chunk per sendAll() call; finish() writes the terminating zero-size chunk.
+    class ChunkedSink : public ByteSink {
+    public:
+        explicit ChunkedSink(ByteSink& out) : mOut(out) {}
+
+        bool sendAll(const void* data, size_t len) override;
+        bool finish();
+
+    private:
+        ByteSink& mOut;
+    };
+
+    // Packs small writes into large ones for a sink where every call has a
+    // fixed cost: a poll plus a syscall on the send socket, or a chunk header
+    // through a ChunkedSink. Writes are copied into a buffer of `capacity`
+    // bytes that goes out whenever it fills; a write of kDirect bytes or more
+    // that does not fit is sent as is, right behind what was buffered, so bulk
+    // file data is not copied. flush() sends the rest and must end the stream.
+    class CoalescingSink : public ByteSink {
+    public:
+        static constexpr size_t kDirect = 0x10000;
+
+        explicit CoalescingSink(ByteSink& out, size_t capacity = 0x40000);
+
+        bool sendAll(const void* data, size_t len) override;
+        bool flush();
+
+    private:
+        ByteSink& mOut;
+        std::unique_ptr<uint8_t[]> mBuf;
+        size_t mCapacity;
+        size_t mLen = 0;
+    };
+
+    // FileReader that reads ahead of sendZipStream, so the SD card and the
+    // socket work at the same time instead of taking turns. produce() runs on a
+    // thread of the adapter's own and fills a small ring of buffers from `src`,
+    // file after file in the order of `files`; the sending thread drains them
+    // through open()/read()/close() as sendZipStream CRCs, deflates and sends
+    // the previous ones. Memory stays at `depth` buffers of kChunk bytes. A file
+    // that cannot be opened or comes up short fails open()/read() as `src`
+    // itself would, and cancelling is still up to sendZipStream's own check.
+    // Once produce() has been started, stop() must be called before the reader
+    // goes away; it returns only after produce() has.
+    class ReadAheadReader : public FileReader {
+    public:
+        static constexpr size_t kChunk = 0x40000;
+
+        ReadAheadReader(FileReader& src, const std::vector<SendFile>& files, size_t depth = 3);
+
+        void produce();
+        void stop();
+
+        bool open(const std::string& absPath) override;
+        size_t read(void* dst, size_t n) override;
+        void close() override {}
+
+    private:
+        // A slot holds up to kChunk bytes of file `file`. An empty one ends the
+        // file, and a `failed` one stands for a file that would not open.
+        struct Slot {
+            std::unique_ptr<uint8_t[]> data;
+            size_t len  = 0;
+            size_t file = 0;
+            bool failed = false;
+        };
+
+        Slot* front();
+        void pop();
+
+        FileReader& mSrc;
+        const std::vector<SendFile>& mFiles;
+        std::vector<Slot> mSlots;
+        size_t mHead  = 0; // oldest filled slot; the consumer's
+        size_t mCount = 0; // filled slots, from mHead on
+        size_t mPos   = 0; // bytes of the head slot already read
+        size_t mNext  = 0; // index of the file open() expects next
+        size_t mFile  = 0; // index of the file being read
+        bool mStop    = false;
+        bool mDone    = false;
+        std::mutex mMutex;
+        std::condition_variable mCv;
+    };
+
+    // Opens a streamed upload: reads the meta part (returned in outMeta) and
+    // leaves `parts` at the start of the file part's data. Fields other than
+    // "meta" and "file" are skipped, so a sender may add its own.
+    bool beginUpload(MultipartReader& parts, std::string& outMeta, std::string& outError);
+
+    // Skips whatever the caller left of the file part and requires the closing
+    // delimiter behind it, so a body cut short — even right after a complete
+    // zip entry — is rejected instead of kept.
+    bool endUpload(MultipartReader& parts, std::string& outError);
+
+    // Extract a zip streamed through `in`, bounded to `limit` bytes (UINT64_MAX
+    // when `in` is a MultipartReader part, which ends by itself). Entries may be
+    // stored or deflated; a deflated entry is inflated as it arrives and needs no
+    // sizes in its local header, since the deflate stream marks its own end.
+    // Zip64 entries are read from their local zip64 extra and 64-bit data
+    // descriptor; the central directory is never needed.
     // Verifies each entry's CRC against the stored value (data descriptor or
     // local header). Returns false + outError on corruption, IO failure, or when
     // `cancelled()` fires. `onBytes` reports progress per data chunk.
     bool extractZip(ByteReader& in, uint64_t limit, ExtractSink& sink, const CancelFn& cancelled, const ProgressFn& onBytes, std::string& outError);
 
-    // Stream the store-only zip for `files` + `dirs` into `out`, reading file
-    // data through `src`. Total byte count matches zipStreamSize exactly, so the
-    // caller's Content-Length holds. Sets `wasCancelled` and returns false if
-    // `cancelled()` fired mid-stream; returns false without it on IO/send error.
+    // Stream the zip for `files` + `dirs` into `out`, reading file data through
+    // `src`. Zip64 records are emitted wherever a size, an offset or the entry
+    // count outgrows the classic fields, so there is no size or count ceiling.
+    // With ZipMethod::Store the total byte count matches zipStreamSize exactly,
+    // so the caller's Content-Length holds, and `onBytes` reports every byte
+    // sent. With ZipMethod::Deflate the file entries are compressed on the
+    // fly (sizes in the data descriptor), the length is unknown until the end —
+    // send it through a ChunkedSink — and `onBytes` reports file bytes read, so
+    // progress runs against the backup's own size. Sets `wasCancelled` and
+    // returns false if `cancelled()` fired mid-stream; returns false without it
+    // on IO/send error.
     bool sendZipStream(ByteSink& out, const std::vector<SendFile>& files, const std::vector<std::string>& dirs, FileReader& src,
-        const CancelFn& cancelled, const ProgressFn& onBytes, bool& wasCancelled);
+        ZipMethod method, const CancelFn& cancelled, const ProgressFn& onBytes, bool& wasCancelled);
+
+    // CRC32 (as a zip entry records it) and length of the file at `absPath`, read
+    // through `src`, for a delta-transfer manifest. Returns false if the file
+    // cannot be opened or `cancelled()` fires; `onBytes` reports progress.
+    bool fileCrc(FileReader& src, const std::string& absPath, const CancelFn& cancelled, const ProgressFn& onBytes, uint32_t& outCrc,
+        uint64_t& outSize);
 }
 
 #endif
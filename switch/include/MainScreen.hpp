@@ -68,6 +68,10 @@ protected:
     // for when the tiles underneath change wholesale (save-type filter, account),
     // where sliding between two unrelated lists means nothing.
     void snapGridAnimation(void);
+    // Queues the backup sizes of the titles next to the cursor, which are where
+    // it goes next, behind the focused title's. Does nothing until the cursor
+    // moves again.
+    void prefetchNeighbourSizes(size_t count);
     void updateSelector(const InputState& input);
     void handleEvents(const InputState& input);
     std::string nameFromCell(size_t index) const;
@@ -85,6 +89,8 @@ protected:
     // Wireless transfer entry points (gated behind the transfer setting). Send is
     // contextual (an existing backup must be selected); Receive is global.
     void startTransferSend(void);
+    // Sends the latest backup of every multi-selected title in one upload.
+    void startTransferSendSelected(void);
     void startTransferReceive(void);
     // Scans the script folders and raises the picker (Scripts action, R3).
     void startScriptPicker(void);
@@ -107,6 +113,11 @@ private:
     size_t mCursor    = 0;
     int mScrollRow    = 0;
     u64 mLastMoveTick = 0; // held-D-pad repeat timing
+
+    // Where the cursor was when prefetchNeighbourSizes last ran.
+    size_t mPrefetchCursor           = SIZE_MAX;
+    saveTypeFilter_t mPrefetchFilter = FILTER_SAVES;
+    u32 mPrefetchGeneration          = 0;
     // Animated mirrors of the grid geometry, stepped while drawing (hence
     // mutable): the vertical scroll in content-space pixels (row r sits at
     // r * TILE_PITCH), and the focus ring's own position, which slides tile to
@@ -29,6 +29,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <ctime>
 #include <deque>
 #include <map>
 #include <mutex>
@@ -46,8 +47,23 @@
 //
 // The walk visits every individual backup subfolder anyway, so it caches each
 // one's size on the way (keyed by full path) for the per-row size labels.
+//
+// Sizes also persist across launches in a small index file under the
+// Checkpoint root. A relaunch shows them straight from the index while the
+// worker revalidates each title as it is requested, walking only the backups
+// the index cannot vouch for (see Stamp).
+//
+// Requests are served by priority: the focused title first, then titles the
+// cursor is likely to land on next, prefetched while nothing else is waiting.
+// A walk is pre-empted between directory entries as soon as a request of a
+// higher priority arrives, and queued again behind it.
 class BackupSizeCache {
 public:
+    enum class Priority {
+        Prefetch, // next to the cursor; computed only when nothing else waits
+        Focused,  // on screen now; only one title holds this at a time
+    };
+
     static BackupSizeCache& get(void)
     {
         static BackupSizeCache instance;
@@ -55,20 +71,32 @@ public:
     }
 
     // Queues an off-thread compute of the total for `id` rooted at `rootPath`.
-    // Cheap and idempotent: no-ops if already cached or in flight, so it is safe
-    // to call every frame.
-    void request(u64 id, const std::string& rootPath);
-
-    // Cached total bytes for `id`, or nullopt while still computing.
+    // Cheap and idempotent: no-ops if already computed this session or in
+    // flight, so it is safe to call every frame. A Focused request demotes
+    // whichever title was focused before to Prefetch, and raises `id` if it was
+    // already queued lower.
+    void request(u64 id, const std::string& rootPath, Priority priority = Priority::Focused);
+
+    // Cached total bytes for `id`, or nullopt while still computing. A size read
+    // from the index is returned while its recompute is pending.
     std::optional<u64> total(u64 id);
 
     // Cached size of a single backup folder (by full path) under `id`, or nullopt.
     std::optional<u64> backupSize(u64 id, const std::string& fullPath);
 
     // Drop the cached sizes for `id` so the next request recomputes — call after
-    // a backup/restore/delete changes the title's folders.
+    // a backup/restore/delete changes the title's folders in a way the calls
+    // below cannot describe.
     void invalidate(u64 id);
 
+    // Take in a backup of `bytes` just written to `fullPath` (new or replacing
+    // one), or one just deleted, by updating the cached sizes in place instead
+    // of walking the title again. Falls back to invalidate(id) when the update
+    // cannot be exact: a compute for `id` is in flight, or `fullPath` is not in
+    // the folder the title was sized from.
+    void backupWritten(u64 id, const std::string& fullPath, u64 bytes);
+    void backupRemoved(u64 id, const std::string& fullPath);
+
     // Monotonic counter bumped whenever cached sizes change (a compute lands or an
     // invalidation drops entries). The UI compares it against the value it
     // snapshotted to know when its size labels went stale.
@@ -92,7 +120,8 @@ public:
     };
 
     // Stop the worker and join it. Called at application shutdown; any in-flight
-    // walk returns promptly (checked between top-level backup folders).
+    // walk returns promptly (checked between top-level backup folders). Sizes
+    // not yet written to the index are written then.
     void shutdown(void);
 
 private:
@@ -104,8 +133,30 @@ private:
     struct Entry {
         u64 total = 0;
         std::map<std::string, u64> perBackup; // backup full path -> bytes
+        std::map<std::string, u64> files;     // plain files beside the backups (manifests) -> bytes
+        std::string base;                     // the title folder it was computed from, with a trailing slash
+        bool fresh = false;                   // computed this session, not just loaded from the index
     };
 
+    // What the size of a backup without a manifest was last walked against: the
+    // folder's mtime and how many entries it lists. While both still match, the
+    // walked size stands. (A backup with a manifest is sized from it instead.)
+    struct Stamp {
+        time_t mtime   = 0;
+        size_t entries = 0;
+        u64 bytes      = 0;
+    };
+
+    struct Task {
+        u64 id;
+        std::string rootPath;
+        Priority priority;
+    };
+
+    // Prefetches still queued beyond this many are dropped, oldest first: a
+    // quick scroll through the grid must not leave a backlog of walks.
+    static constexpr size_t MAX_PREFETCH = 8;
+
     void ensureWorker(void);
     void workerLoop(void);
     void compute(u64 id, const std::string& rootPath);
@@ -114,15 +165,35 @@ private:
     u64 walkSize(const std::string& path);
     // Blocks while paused; returns immediately when running or stopping.
     void gate(void);
+    // True once the walk in progress should give up: at shutdown, or when a
+    // request has pre-empted it.
+    bool aborted(void) const { return mStop.load() || mPreempt.load(); }
+    // invalidate() with mMutex held.
+    void invalidateLocked(u64 id);
+    // backupWritten() when `bytes` is set, backupRemoved() otherwise.
+    void applyDelta(u64 id, const std::string& fullPath, std::optional<u64> bytes);
+    // Reads the index into mCache and mStamps once; caller holds mMutex.
+    void loadIndex(void);
+    // Rewrites the index from mCache and mStamps when either changed since it
+    // was last written. Takes mMutex itself, but writes the file outside it.
+    void saveIndex(void);
 
     std::mutex mMutex;
     std::condition_variable mCond;
     std::thread mWorker;
-    std::deque<std::pair<u64, std::string>> mQueue; // (id, rootPath) awaiting compute
+    std::deque<Task> mQueue; // awaiting compute; newest at the back
+    // The task being computed, valid while mBusy.
+    bool mBusy                = false;
+    u64 mCurrentId            = 0;
+    Priority mCurrentPriority = Priority::Prefetch;
     std::map<u64, Entry> mCache;
+    std::map<std::string, Stamp> mStamps; // backup full path -> stamp, walked backups only
+    bool mIndexLoaded = false;
+    bool mIndexDirty  = false;
     std::set<u64> mPending; // ids with a compute queued or in flight
     std::set<u64> mDirty;   // ids invalidated while a compute was in flight
     std::atomic<bool> mStop{false};
+    std::atomic<bool> mPreempt{false}; // the walk in progress must yield to a queued task
     std::atomic<int> mPauseCount{0};
     std::atomic<u32> mGeneration{1};
 };
@@ -69,6 +69,19 @@ public:
     // every file against the backup. Default true; can be disabled because it
     // roughly doubles restore time on backups with tens of thousands of files.
     bool isVerifyRestoreEnabled(void);
+    // Restore by comparing the backup against the save (size, then CRC32) and
+    // rewriting only what differs, instead of wiping the save and writing every
+    // file. Default false.
+    bool isDifferentialRestoreEnabled(void);
+    // Let a quick or multi-select backup skip the copy when the save still holds
+    // exactly what its newest backup does. Default true.
+    bool isSkipUnchangedBackupsEnabled(void);
+    // Keep new backups in the shared object store (see ObjectStore), each file
+    // once across all backups, instead of as full copies. Default false.
+    bool isDedupeBackupsEnabled(void);
+    // Write new backups as one pack file plus manifest instead of a folder of
+    // files. Dedupe takes precedence where it applies. Default false.
+    bool isPackBackupsEnabled(void);
     std::vector<std::string> additionalSaveFolders(u64 id);
     std::vector<std::string> additionalDeviceSaveFolders(u64 id);
     void save(void);
@@ -95,6 +108,10 @@ public:
     void setConfirmRestoreEnabled(bool enabled);
     void setQuickBackupEnabled(bool enabled);
     void setVerifyRestoreEnabled(bool enabled);
+    void setDifferentialRestoreEnabled(bool enabled);
+    void setSkipUnchangedBackupsEnabled(bool enabled);
+    void setDedupeBackupsEnabled(bool enabled);
+    void setPackBackupsEnabled(bool enabled);
     void addAdditionalSaveFolder(u64 id, const std::string& path);
     void removeAdditionalSaveFolder(u64 id, const std::string& path);
     void addAdditionalDeviceSaveFolder(u64 id, const std::string& path);
@@ -147,6 +164,10 @@ private:
     bool mConfirmRestore;
     bool mQuickBackup;
     bool mVerifyRestore;
+    bool mDifferentialRestore;
+    bool mSkipUnchangedBackups;
+    bool mDedupeBackups;
+    bool mPackBackups;
     std::unordered_set<u64> mFilterIds, mFavoriteIds;
     std::unordered_map<u64, std::vector<std::string>> mAdditionalSaveFolders, mAdditionalDeviceSaveFolders;
     std::string mTheme;
@@ -36,6 +36,7 @@
 struct DirectoryEntry {
     std::string name;
     bool directory;
+    u64 size; // of a file listed through the filesystem service; otherwise 0
 };
 
 class Directory {
@@ -46,6 +47,10 @@ public:
     Result error(void);
     std::string entry(size_t index);
     bool folder(size_t index);
+    // Size of the file at `index` as the listing reported it, so walks that sum
+    // a tree need no stat() per file. Only devices mounted through fsdev (sdmc:,
+    // save:) report sizes; entries of any other listing read 0.
+    u64 fileSize(size_t index);
     bool good(void);
     size_t size(void);
 
@@ -43,6 +43,8 @@ struct IconStore {
 
     // Decode and keep the application-control-data icon for title `id`.
     virtual void loadIcon(u64 id, NsApplicationControlData* nsacd, size_t iconSize) = 0;
+    // Decode and keep an icon for title `id` from its JPEG bytes (a TitleCache entry).
+    virtual void storeIcon(u64 id, const u8* jpeg, size_t size) = 0;
     // Keep a generated placeholder icon for title `id` (system saves have no SMDH icon).
     virtual void loadPlaceholderIcon(u64 id) = 0;
 };
@@ -53,6 +55,7 @@ struct IconStore {
 class TextureIconStore : public IconStore {
 public:
     void loadIcon(u64 id, NsApplicationControlData* nsacd, size_t iconSize) override;
+    void storeIcon(u64 id, const u8* jpeg, size_t size) override;
     void loadPlaceholderIcon(u64 id) override;
 
     // Texture for title `id`, or NULL when none was loaded.
@@ -72,6 +75,7 @@ struct RecordingIconStore : public IconStore {
     std::vector<u64> placeholders;
 
     void loadIcon(u64 id, NsApplicationControlData*, size_t) override { loaded.push_back(id); }
+    void storeIcon(u64 id, const u8*, size_t) override { loaded.push_back(id); }
     void loadPlaceholderIcon(u64 id) override { placeholders.push_back(id); }
 };
 
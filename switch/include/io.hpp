@@ -56,6 +56,11 @@ namespace io {
         Result res;
         BackupStage stage;      // meaningful only when !ok
         bool cancelled = false; // set only for a backup aborted via ProgressSink::cancelled(); ok is false, res is 0
+        // Set only when a backup asked to skip an unchanged save found it identical
+        // to this existing backup (its folder name); ok is true and nothing was written.
+        std::string unchangedFrom;
+        // Set for a backup that was written: the bytes of save data it holds.
+        u64 bytes = 0;
     };
 
     // What one recursive walk of a tree found. The same struct is filled by the
@@ -66,9 +71,10 @@ namespace io {
         size_t files = 0;
         size_t dirs  = 0;
         u64 bytes    = 0;
-        // Directories that failed to list and files that failed to stat. Non-zero
-        // means the walk itself is incomplete, so `files`/`bytes` are lower bounds
-        // and nothing derived from them can be trusted.
+        // Directories that failed to list. Non-zero means the walk itself is
+        // incomplete, so `files`/`bytes` are lower bounds and nothing derived
+        // from them can be trusted. File sizes come with the listing, so there
+        // is no separate per-file failure.
         size_t unreadable = 0;
     };
 
@@ -82,31 +88,127 @@ namespace io {
         u32 crc  = 0;
     };
 
+    // The save journal's budget over one copy. Commits are by far the slowest
+    // part of restoring many small files, so instead of one per file a copy
+    // accumulates writes and commits once they approach `limit`, still cutting
+    // a file that alone exceeds it into several commits.
+    struct CommitBudget {
+        // Journal bytes a copy may leave uncommitted; 0 (journal size unknown)
+        // falls back to committing after every file.
+        u64 limit      = 0;
+        u64 pending    = 0; // journal bytes used since the last commit
+        size_t entries = 0; // files and folders created since the last commit
+    };
+
+    // Where a file's bytes sit inside a larger file: a member of a packed backup.
+    struct FileSpan {
+        u64 offset = 0;
+        u64 length = 0;
+    };
+
+    // Every entry under a root, from a single walk, kept so that each phase of a
+    // backup or restore works off the same listing instead of walking the tree
+    // again. Paths live back to back in one arena string, so a tree of tens of
+    // thousands of files costs a couple of allocations rather than one per name.
+    struct TreeSnapshot {
+        struct Node {
+            u32 offset; // of the relative path in `paths`
+            u32 length;
+            bool folder;
+            u64 size; // 0 for folders
+        };
+        std::string paths;
+        // Pre-order, as listed: a folder precedes its contents.
+        std::vector<Node> nodes;
+        // The same figures scanTree reports for the root.
+        TreeStats stats;
+
+        // Per node, the file a copy reads it from, for a tree whose files do not
+        // live under its root (a stored backup, see ObjectStore). Empty for a
+        // listed tree.
+        std::vector<std::string> sources;
+        // For a packed backup, the pack every file is read from and, per node,
+        // where its bytes start in it. Empty otherwise.
+        std::string pack;
+        std::vector<u64> offsets;
+
+        // Relative to the root, without a leading or trailing slash.
+        std::string relPath(size_t i) const { return paths.substr(nodes[i].offset, nodes[i].length); }
+        // Where the file of node `i` is read from when the tree is rooted at `root`.
+        std::string sourcePath(size_t i, const std::string& root) const
+        {
+            return !pack.empty() ? pack : sources.empty() ? root + relPath(i) : sources[i];
+        }
+        // The bytes of node `i` within its pack; meaningful only when `pack` is set.
+        FileSpan span(size_t i) const { return FileSpan{offsets[i], nodes[i].size}; }
+    };
+
+    // What a differential restore has to change on a save that already holds
+    // part of the backup; everything else is left as it is.
+    struct RestorePlan {
+        // Save entries to delete, as indices into the save's snapshot in
+        // pre-order: ones the backup lacks, ones of the wrong kind, and files
+        // whose contents differ, which are rewritten from scratch.
+        std::vector<size_t> stale;
+        // Per node of the backup's snapshot: already on the save, byte for byte.
+        std::vector<bool> unchanged;
+        TreeStats unchangedStats;
+        // The unchanged files as the copy would have reported them, so the
+        // verification covers the whole backup.
+        std::vector<CopiedFile> unchangedFiles;
+    };
+
     // Backs up `title` into the already-resolved `dstPath` (the caller picks the
     // folder name and decides new-vs-overwrite). Reports progress through `sink`.
-    IoOutcome backup(Title& title, const std::string& dstPath, ProgressSink& sink);
+    // With `skipIfUnchanged`, a backup into a new folder first checks the save
+    // against the manifest of the title's newest backup and copies nothing when
+    // they match (see IoOutcome::unchangedFrom).
+    IoOutcome backup(Title& title, const std::string& dstPath, ProgressSink& sink, bool skipIfUnchanged = false);
     // Restores `title` from the already-resolved backup folder `srcPath`.
     IoOutcome restore(Title& title, const std::string& srcPath, ProgressSink& sink);
 
-    size_t countFiles(const std::string& path);
     // One walk of `path` collecting the file count, the directory count and the
     // total byte size, plus how much of the tree could not be read. Replaces
     // walking the same tree once per figure. Pass a `sink` when the walk is long
     // enough that the modal would otherwise look frozen; the caller owns
     // begin()/end() since only it knows the expected total.
     TreeStats scanTree(const std::string& path, ProgressSink* sink = nullptr);
-    // `commitWriteLimit` > 0 caps the bytes written to the save device between
-    // commits, so large writes never overflow the save's journal; 0 disables
-    // mid-file commits (writes to sdmc: are unaffected either way). When `copied`
-    // is given it accumulates what the copy actually moved, for the caller to
-    // check against its scan. `digests`, when given, collects one CopiedFile per
-    // file written, which is what the restore verification checks the save
-    // against.
-    Result copyDirectory(const std::string& srcPath, const std::string& dstPath, ProgressSink& sink, u64 commitWriteLimit = 0,
-        TreeStats* copied = nullptr, std::vector<CopiedFile>* digests = nullptr);
+    // Walks `path` (which ends in '/') once into a TreeSnapshot. Folders that fail
+    // to list are left out and counted in `stats.unreadable`; `sink` works as it
+    // does for scanTree.
+    TreeSnapshot snapshotTree(const std::string& path, ProgressSink* sink = nullptr);
+    // Copies the snapshot of `srcRoot` to `dstRoot`, both ending in '/', without
+    // listing either side again, and leaves alone the nodes marked in `skip`.
+    // `commitWriteLimit` > 0 caps the journal bytes used on the save device
+    // between commits, so commits are batched across files yet never overflow
+    // the save's journal; 0 commits after every file and never mid-file (writes
+    // to sdmc: are unaffected either way). Anything still pending is committed
+    // before it returns. When `copied` is given it accumulates what the copy
+    // actually moved, for the caller to check against the snapshot. `digests`,
+    // when given, collects one CopiedFile per file written, which is what the
+    // restore verification checks the save against.
+    Result copySnapshot(const TreeSnapshot& tree, const std::string& srcRoot, const std::string& dstRoot, ProgressSink& sink,
+        u64 commitWriteLimit = 0, TreeStats* copied = nullptr, std::vector<CopiedFile>* digests = nullptr, const std::vector<bool>* skip = nullptr);
+    // Deletes every entry of the snapshot of `root`, or only the nodes listed
+    // in `only` (ascending), contents before their folder; `root` itself stays.
+    // Reports removed files like deleteFolderRecursively.
+    Result deleteSnapshot(const TreeSnapshot& tree, const std::string& root, ProgressSink* sink = nullptr, const std::vector<size_t>* only = nullptr);
+    // Compares the backup's snapshot against the mounted save's, by size and,
+    // where sizes match, by the CRC32 of both copies, and works out the least a
+    // restore has to delete and rewrite. Reports each compared file to `sink`.
+    RestorePlan planRestore(
+        const TreeSnapshot& backup, const std::string& srcRoot, const TreeSnapshot& save, const std::string& dstRoot, ProgressSink& sink);
+    // Compares two snapshots path by path, regardless of listing order, and logs
+    // up to a handful of the differences: missing or extra entries, a file where a
+    // folder should be, or a size that differs. Returns how many there are.
+    size_t compareSnapshots(const TreeSnapshot& expected, const TreeSnapshot& actual);
     // `crcOut`, when given, receives the CRC32 of every byte read from the source.
-    Result copyFile(const std::string& srcPath, const std::string& dstPath, ProgressSink& sink, u64 commitWriteLimit = 0, u64* bytesCopied = nullptr,
-        u32* crcOut = nullptr);
+    // Files larger than BUFFER_SIZE are read ahead on a second thread, overlapping
+    // the SD reads with the writes and commits to the destination. A copy to the
+    // save device charges `budget` and commits only when it is spent, leaving the
+    // rest for the caller to commit; without one it commits the file itself.
+    Result copyFile(const std::string& srcPath, const std::string& dstPath, ProgressSink& sink, CommitBudget* budget = nullptr,
+        u64* bytesCopied = nullptr, u32* crcOut = nullptr);
     Result createDirectory(const std::string& path);
     // Deletes everything under `path`; with `removeRoot` also removes `path`
     // itself. Pass false when `path` is a mount root (e.g. "save:/"), which can
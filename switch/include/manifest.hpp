@@ -0,0 +1,123 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef MANIFEST_HPP
+#define MANIFEST_HPP
+
+#include <array>
+#include <string>
+#include <switch.h>
+#include <vector>
+
+// A record of what a backup held when io::backup wrote it: every path, kind,
+// size and CRC32, in one small binary file next to the backup folder
+// ("<folder>.manifest"). Next to it rather than inside, so a restore or a
+// transfer of the folder never carries it along; the title's backup list shows
+// folders only, so it stays out of sight there too.
+//
+// It describes the backup at the time it was taken. Backups are routinely edited
+// on the SD card with save editors, so a plain folder's manifest is trusted only
+// after checking it still fits: size labels use it as is (a stale one is
+// harmless), restore cross-checks the copy against it and only logs, and a new
+// backup skips reading the save when it matches the newest backup's manifest
+// (same commit id and timestamp, or same CRC32s) only once that backup's files
+// were found at their recorded sizes and none modified after the manifest was
+// written. An edit made on the SD card breaks that check, and the save is
+// copied. A stored or packed backup has no loose files to edit: its manifest is
+// the only map of its data, read by restore, transfers and garbage collection.
+//
+// Layout, little-endian: "CPMF", u16 version, u16 flags, u32 entry count, u32
+// file count, u64 total file bytes, u32 CRC32 of the entry block; then per
+// entry u8 kind (0 file, 1 folder), u16 path length, the relative path and, for
+// a file, u64 size and u32 CRC32 as io::CopiedFile records it. Flag bit 0
+// adds a SHA-256 after each file's CRC. Flag bit 1 puts the save's commit id
+// and timestamp (two u64) at the start of the entry block. Flag bits 2 and 3
+// give the backup's Layout when it is not a plain folder; the manifest of such
+// a backup is its only index and, unlike the others, not a shortcut.
+namespace Manifest {
+    // Where the data of a backup's files lives.
+    enum class Layout : u8 {
+        // In the backup folder, one file per file of the save.
+        Folder,
+        // In the ObjectStore, each file under its SHA-256; the folder is empty.
+        Stored,
+        // Back to back, in the manifest's order, in one "<folder>.pack" next to
+        // the folder, which is empty. Each file starts where the previous one
+        // ends.
+        Packed
+    };
+
+    // What the filesystem's extra data said about the save when it was backed
+    // up. The commit id moves on every commit, so an equal one means the save
+    // has not been written since.
+    struct SaveStamp {
+        u64 commitId  = 0;
+        u64 timestamp = 0;
+    };
+
+    struct Entry {
+        std::string relPath; // relative to the backup folder, no leading slash
+        bool folder;
+        u64 size = 0;
+        u32 crc  = 0;
+        std::array<u8, 32> sha256{}; // stored backups only
+    };
+
+    struct Contents {
+        std::vector<Entry> entries; // as io::backup copied them: a folder precedes its contents
+        size_t files   = 0;
+        u64 totalBytes = 0;
+        bool hasStamp  = false;
+        SaveStamp stamp;
+        Layout layout = Layout::Folder;
+    };
+
+    // `backupPath` with or without its trailing slash.
+    std::string pathFor(const std::string& backupPath);
+    // "<folder>.pack", the data of a Packed backup.
+    std::string packPathFor(const std::string& backupPath);
+    // True when `path` is named like the pack of a backup.
+    bool isPack(const std::string& path);
+    // A Stored manifest records each entry's sha256.
+    bool write(const std::string& backupPath, const std::vector<Entry>& entries, const SaveStamp* stamp = nullptr, Layout layout = Layout::Folder);
+    // False when there is no manifest or it does not check out; corrupt ones
+    // are logged.
+    bool read(const std::string& backupPath, Contents& out);
+    // Just the header's totals, without reading the entries.
+    bool readTotals(const std::string& backupPath, size_t& outFiles, u64& outBytes);
+    // The layout of `backupPath`, from the header alone; Folder when it has no
+    // manifest.
+    Layout layout(const std::string& backupPath);
+    // Like layout(), but false when there is no manifest or its header does
+    // not check out, for callers that must not mistake a damaged manifest for
+    // a Folder one.
+    bool readLayout(const std::string& backupPath, Layout& out);
+    // Removes the manifest of a backup that is being deleted or replaced, and
+    // the pack of a Packed one.
+    void discard(const std::string& backupPath);
+}
+
+#endif
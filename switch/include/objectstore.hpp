@@ -0,0 +1,73 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef OBJECTSTORE_HPP
+#define OBJECTSTORE_HPP
+
+#include "io.hpp"
+#include "manifest.hpp"
+#include <array>
+#include <string>
+#include <switch.h>
+
+// The shared store behind deduplicated backups: every file such a backup holds
+// is kept once, under the SHA-256 of its contents, in
+// "sdmc:/switch/Checkpoint/objects/<2 hex>/<64 hex>". The backup folder itself
+// stays empty so the title's backup list still shows it; its manifest (see
+// Manifest, flag bit 2) names the object of each file. Twenty backups of a save
+// that barely changes then cost one copy of each distinct file.
+//
+// Objects are written once and never changed. They are not reference counted:
+// collectGarbage() finds the ones no stored manifest names any more, so a
+// stored backup must live under a root it scans (see covers()).
+namespace ObjectStore {
+    using Digest = std::array<u8, SHA256_HASH_SIZE>;
+
+    std::string root(void);
+    std::string objectPath(const Digest& digest);
+    // Where an object is written before it is renamed into place, so a crash
+    // never leaves a truncated object under its final name.
+    std::string tempPath(const Digest& digest);
+    // True when the store already holds this content.
+    bool holds(const Digest& digest, u64 size);
+    // Creates the folder objectPath(digest) lives in.
+    Result prepare(const Digest& digest);
+    // Whether a backup at `backupPath` may be stored: it must sit directly in a
+    // title folder under one of the backup roots collectGarbage() scans.
+    bool covers(const std::string& backupPath);
+    // A stored backup as the snapshot a restore copies from, with each file read
+    // from its object. Objects that are missing or the wrong size are left out
+    // and counted in `stats.unreadable`, so the restore refuses before touching
+    // the save.
+    io::TreeSnapshot snapshot(const Manifest::Contents& manifest);
+    // Deletes every object no stored manifest references, and the leftovers of
+    // interrupted writes. Gives up without deleting anything if a stored
+    // manifest cannot be read, any manifest's header is damaged, or a folder
+    // that may hold one fails to list. Returns how many objects went.
+    size_t collectGarbage(void);
+}
+
+#endif
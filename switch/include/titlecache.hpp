@@ -0,0 +1,88 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#ifndef TITLECACHE_HPP
+#define TITLECACHE_HPP
+
+#include <cstddef>
+#include <string>
+#include <switch.h>
+#include <unordered_map>
+#include <vector>
+
+// Serialization of what TitleProbe learned about one save to/from the on-SD title
+// cache, so a launch only probes the saves the previous one had not seen. The
+// control data is the slow part of a probe; an entry keeps its name, author and
+// icon, the icon as the JPEG it came in (a fraction of the decoded pixels). The
+// fixed part of an entry is declared exactly once here; encode/decode are the
+// inverse of each other and are the only code that knows the byte format.
+// The 3DS TitleCache shares only this split (encode/decode over fixed field
+// offsets, clamped strings, FORMAT_VERSION); the file itself differs. Here
+// TitleCatalog writes a "CKTC" header with the version and system language,
+// and each entry is keyed by save id and followed by its variable-length icon.
+namespace TitleCache {
+    // Size of the fixed part of one serialized entry, in bytes. The entry's icon
+    // bytes follow it.
+    constexpr std::size_t ENTRY_SIZE = 808;
+
+    // Bump whenever the on-SD byte format changes; a cache written by another
+    // version is ignored and rebuilt.
+    constexpr u32 FORMAT_VERSION = 1;
+
+    struct Entry {
+        // The save the entry describes. It stands in for a probe only of an
+        // FsSaveDataInfo that matches every one of these.
+        u64 saveId     = 0;
+        u64 id         = 0;
+        AccountUid uid = {0};
+        u8 type        = 0;
+        u8 spaceId     = 0;
+        // False for a system save that failed to mount, so it is skipped
+        // without mounting it again.
+        bool usable = true;
+        std::string name;
+        std::string author;
+        std::vector<u8> icon; // JPEG; empty for a system save
+    };
+
+    // By save_data_id.
+    using Entries = std::unordered_map<u64, Entry>;
+
+    // An entry keyed to `info`, with nothing probed yet.
+    Entry keyOf(const FsSaveDataInfo& info);
+    // Whether `entry` was recorded for the save `info` describes.
+    bool matches(const Entry& entry, const FsSaveDataInfo& info);
+
+    // Writes the fixed part of `entry` (ENTRY_SIZE bytes) at dst. Zero-fills it first.
+    void encode(u8* dst, const Entry& entry);
+
+    // Reads the fixed part of an entry at src into `entry` and sizes its icon for
+    // the bytes that follow, which the caller reads in. Returns false when the
+    // entry cannot be one encode() wrote.
+    bool decode(const u8* src, Entry& entry);
+}
+
+#endif // TITLECACHE_HPP
@@ -30,6 +30,7 @@
 #include "iconstore.hpp"
 #include "savekind.hpp"
 #include "title.hpp"
+#include "titlecache.hpp"
 #include <array>
 #include <mutex>
 #include <string>
@@ -138,6 +139,13 @@ private:
     // apply the change.
     void rebuildFilterIndex(AccountUid uid);
 
+    // The title cache on the SD card (see TitleCache). loadTitles imports it
+    // before the scan, so only saves it holds no entry for are probed, and
+    // exports what the scan found when that differs. A cache written under
+    // another format version or system language imports as empty.
+    TitleCache::Entries importTitleListCache(void);
+    void exportTitleListCache(const TitleCache::Entries& entries);
+
     static constexpr size_t FILTER_COUNT = 4; // one row per SaveKind::all() entry
 
     // Almost every query and mutation runs on the main thread and needs no
@@ -29,6 +29,7 @@
 
 #include "iconstore.hpp"
 #include "title.hpp"
+#include "titlecache.hpp"
 #include <switch.h>
 
 // The live-IO producer of a Title value. From one FsSaveDataInfo it resolves the
@@ -45,7 +46,16 @@ namespace TitleProbe {
     // across the scan (the control-data struct is large; allocating it per entry
     // would be wasteful). Returns true when the entry yields a usable Title:
     // false when it is filtered out, has no control data, or (system) won't mount.
-    bool probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons, NsApplicationControlData* nsacd);
+    // `record`, when given, receives what the probe learned for the title cache:
+    // the name, author and icon of a usable title, or `usable` false for a
+    // system save that won't mount.
+    bool probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons, NsApplicationControlData* nsacd, TitleCache::Entry* record = nullptr);
+
+    // Populate `dst` from an entry the title cache recorded for `info`, the
+    // caller having checked TitleCache::matches. Neither asks ns nor mounts
+    // anything; the rest (the backup directory, play statistics) is as fresh as
+    // in probe(). Returns false where probe() would, from the recorded outcome.
+    bool restore(Title& dst, const FsSaveDataInfo& info, const TitleCache::Entry& entry, IconStore& icons);
 }
 
 #endif // TITLEPROBE_HPP
@@ -31,11 +31,13 @@
 #include <optional>
 #include <string>
 #include <switch.h>
+#include <vector>
 
 // Wireless save transfer, ported from the 3DS build. The wire protocol is
-// identical (HTTP/1.1 multipart upload, store-only ZIP, X-CP-Token PIN), so the
-// PC CLI and a 3DS on the same network interoperate with the Switch. Switch has
-// no extdata: everything travels as dataType "save".
+// identical (HTTP/1.1 multipart upload, store-only ZIP or — for a receiver that
+// advertises it — deflated ZIP, X-CP-Token PIN), so the PC CLI and a 3DS on the
+// same network interoperate with the Switch. Switch has no extdata: everything
+// travels as dataType "save".
 namespace Transfer {
     // A parsed send destination. The screen only prompts for the raw "ip:port"
     // string and hands it here; validation policy lives with the transport.
@@ -66,7 +68,12 @@ namespace Transfer {
     void stopReceiver(void);
     bool receiverRunning(void);
     bool consumePendingRefresh(void);
-    u64 consumeCompletedTitleId(void);
+    // Ids of the titles that received a backup since the last call; a batch
+    // upload fills in one per title it carried.
+    std::vector<u64> consumeCompletedTitleIds(void);
+    // True once since a received backup replaced a stored one: the caller
+    // sweeps the object store (TransferJob::enqueueCollectGarbage).
+    bool consumeReleasedObjects(void);
     std::string receiverToken(void);
     std::string receiverIp(void);
     int receiverPort(void);
@@ -93,6 +100,20 @@ namespace Transfer {
     // TransferStatus (beginNetwork/addBytesDone) and is drawn by the main loop.
     SendOutcome sendBackup(Title& title, const std::string& backupPath, const std::string& backupName, const std::string& dataType,
         const std::string& ip, u16 port, const std::string& token);
+
+    // One backup of a batch send: the same fields sendBackup takes.
+    struct BatchItem {
+        Title title;
+        std::string backupPath;
+        std::string backupName;
+        std::string dataType;
+    };
+
+    // Sends every item in one upload to a receiver that advertises "batch",
+    // for one connection and one PIN check however many titles there are; an
+    // older receiver gets them one sendBackup at a time instead. Items whose
+    // folder is empty are skipped; EmptyBackup only when all of them are.
+    SendOutcome sendBackups(std::vector<BatchItem>& items, const std::string& ip, u16 port, const std::string& token);
 }
 
 #endif
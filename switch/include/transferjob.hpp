@@ -63,10 +63,22 @@ public:
         io::BackupStage stage = io::BackupStage::Copy;
         std::string successMsg;      // shown on success (already resolved)
         std::vector<u64> refreshIds; // title ids whose backup list the main thread must refresh
+        // Every backup the job wrote, for BackupSizeCache::backupWritten.
+        struct WrittenBackup {
+            u64 id;
+            std::string path;
+            u64 bytes;
+        };
+        std::vector<WrittenBackup> written;
         bool cancelled = false;      // set when a backup was aborted via requestCancel(); ok is false, res is 0
+        // A batch of one backup that found the save unchanged: the existing backup
+        // it matched, shown instead of successMsg.
+        std::string unchangedFrom;
         // Set only for a network send: when present the screen maps
         // SendOutcome::stage to a message instead of the io fields above.
         std::optional<Transfer::SendOutcome> send;
+        // A run that only swept the object store: there is nothing to show.
+        bool quiet = false;
     };
 
     static TransferJob& get(void)
@@ -77,8 +89,9 @@ public:
 
     // Owns `title` for the duration of the copy: io::backup/restore take a
     // reference into it, so it must outlive the main-thread local it was copied
-    // from. `dstPath`/`srcPath` are already fully resolved.
-    void enqueueBackup(Title title, std::string dstPath, std::string successMsg);
+    // from. `dstPath`/`srcPath` are already fully resolved. `skipIfUnchanged` is
+    // passed through to io::backup.
+    void enqueueBackup(Title title, std::string dstPath, std::string successMsg, bool skipIfUnchanged = false);
     void enqueueRestore(Title title, std::string srcPath, std::string successMsg);
 
     // Enqueues a wireless send of an existing backup folder. Keyboard prompts
@@ -88,6 +101,18 @@ public:
     void enqueueSend(Title title, std::string backupPath, std::string backupName, std::string dataType, std::string ip, u16 port, std::string token,
         std::string successMsg);
 
+    // Enqueues a batch send: every item travels in one upload to the same
+    // receiver (see Transfer::sendBackups).
+    void enqueueSend(std::vector<Transfer::BatchItem> items, std::string ip, u16 port, std::string token, std::string successMsg);
+
+    // Enqueues a sweep of the object store (ObjectStore::collectGarbage), for a
+    // stored backup deleted or replaced outside a job. The sweep reads every
+    // manifest under the backup roots, so it stays off the main loop, and it runs
+    // after every other item, never beside a backup still writing objects its
+    // manifest does not name yet. A backup the job writes over a stored one
+    // queues its own.
+    void enqueueCollectGarbage(void);
+
     // Drains the queue on a worker thread, if there is work and none is already
     // running. Idempotent and safe to call with an empty queue.
     void start(void);
@@ -116,19 +141,21 @@ private:
     static void runThread(void* arg);
     void run(void);
 
-    enum class Kind { Backup, Restore, Send };
+    enum class Kind { Backup, Restore, Send, CollectGarbage };
 
     struct WorkItem {
         Kind kind = Kind::Backup;
         Title title;
         std::string path;
         std::string successMsg;
+        bool skipIfUnchanged = false; // backup only
         // Send-only fields (unused for backup/restore).
         std::string backupName;
         std::string dataType;
         std::string ip;
         u16 port = 0;
         std::string token;
+        std::vector<Transfer::BatchItem> batch; // a batch send when non-empty
     };
 
     enum class State { Idle, Running, Done };
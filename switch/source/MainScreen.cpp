@@ -36,6 +36,7 @@
 #include "gfxutils.hpp"
 #include "i18n.hpp"
 #include "main.hpp"
+#include "manifest.hpp"
 #include "paths.hpp"
 #include "savedatasource.hpp"
 #include "savekind.hpp"
@@ -548,11 +549,14 @@ void MainScreen::draw() const
         backupList->draw(backupScrollEnabled);
 
         if (MS::multipleSelectionEnabled()) {
-            // Multi-select is a batch backup only (no restore): show a single
-            // button counting the selected titles, wired to the same L handler.
+            // Multi-select is a batch backup or send (no restore): buttons
+            // counting the selected titles, wired to the same L / ZR handlers.
             const size_t n = selEnt.size();
             const std::string lbl =
                 n == 1 ? i18n::t("main.backup_n_title", {std::to_string(n)}) : i18n::t("main.backup_n_titles", {std::to_string(n)});
+            const std::string sendLbl =
+                n == 1 ? i18n::t("main.send_n_title", {std::to_string(n)}) : i18n::t("main.send_n_titles", {std::to_string(n)});
+            drawActionButton(COL_X, BTN_TRANSFER_Y, sendLbl, "ZR", true, BTN_W, Configuration::getInstance().isTransferEnabled());
             drawActionButton(COL_X, BTN_BACKUP_Y, lbl, "L", true);
         }
         else {
@@ -705,7 +709,13 @@ void MainScreen::update(const InputState& input)
     if (auto result = TransferJob::get().takeResult()) {
         for (u64 id : result->refreshIds) {
             TitleCatalog::get().refreshDirectories(id);
-            BackupSizeCache::get().invalidate(id); // folders changed → recompute sizes
+        }
+        // The copy counted every byte it wrote, so the sizes need no walk.
+        for (const auto& backup : result->written) {
+            BackupSizeCache::get().backupWritten(backup.id, backup.path, backup.bytes);
+        }
+        if (result->quiet) {
+            return;
         }
         if (result->send) {
             // A network send: map the outcome to a message. EmptyBackup/Cancelled
@@ -728,6 +738,9 @@ void MainScreen::update(const InputState& input)
         if (result->cancelled) {
             currentOverlay = std::make_shared<InfoOverlay>(*this, i18n::t("main.backup_cancelled"));
         }
+        else if (result->ok && !result->unchangedFrom.empty()) {
+            currentOverlay = std::make_shared<InfoOverlay>(*this, i18n::t("main.backup_unchanged", {result->unchangedFrom}));
+        }
         else if (result->ok) {
             blinkLed(4);
             currentOverlay = std::make_shared<InfoOverlay>(*this, result->successMsg);
@@ -879,6 +892,7 @@ void MainScreen::updateSelector(const InputState& input)
             }
         }
 
+        prefetchNeighbourSizes(count);
         backupList->resetIndex();
     }
     else {
@@ -886,6 +900,38 @@ void MainScreen::updateSelector(const InputState& input)
     }
 }
 
+void MainScreen::prefetchNeighbourSizes(size_t count)
+{
+    if (count == 0 || (mCursor == mPrefetchCursor && mSaveTypeFilter == mPrefetchFilter && mLastGeneration == mPrefetchGeneration)) {
+        return;
+    }
+    mPrefetchCursor     = mCursor;
+    mPrefetchFilter     = mSaveTypeFilter;
+    mPrefetchGeneration = mLastGeneration;
+
+    // One step in each direction the D-pad moves the cursor; left and right
+    // stay on the cursor's row.
+    const size_t col = mCursor % GRID_COLS;
+    std::vector<size_t> neighbours;
+    if (mCursor >= (size_t)GRID_COLS) {
+        neighbours.push_back(mCursor - GRID_COLS);
+    }
+    if (mCursor + GRID_COLS < count) {
+        neighbours.push_back(mCursor + GRID_COLS);
+    }
+    if (col > 0) {
+        neighbours.push_back(mCursor - 1);
+    }
+    if (col + 1 < (size_t)GRID_COLS && mCursor + 1 < count) {
+        neighbours.push_back(mCursor + 1);
+    }
+    for (size_t i : neighbours) {
+        Title title;
+        TitleCatalog::get().getFilteredTitle(title, g_currentUId, mSaveTypeFilter, i);
+        BackupSizeCache::get().request(title.id(), title.path(), BackupSizeCache::Priority::Prefetch);
+    }
+}
+
 size_t MainScreen::rawIndex() const
 {
     return TitleCatalog::get().filteredToRawIndex(g_currentUId, mSaveTypeFilter, this->index(TITLES));
@@ -907,8 +953,15 @@ void MainScreen::doBackup(size_t rawIdx, size_t cellIndex)
         return;
     }
 
+    // Only a backup that named itself (quick backup or multi-select) may be
+    // skipped as unchanged: one the user typed a name for, or chose to
+    // overwrite, was asked for explicitly.
+    Configuration& cfg         = Configuration::getInstance();
+    const bool autoNamed       = cellIndex == 0 && !usedKeyboardFallback && (MS::multipleSelectionEnabled() || cfg.isQuickBackupEnabled());
+    const bool skipIfUnchanged = autoNamed && cfg.isSkipUnchangedBackupsEnabled();
+
     std::string successMsg = usedKeyboardFallback ? i18n::t("main.backup_success_fallback") : i18n::t("main.backup_success");
-    TransferJob::get().enqueueBackup(std::move(title), *dst, std::move(successMsg));
+    TransferJob::get().enqueueBackup(std::move(title), *dst, std::move(successMsg), skipIfUnchanged);
 }
 
 void MainScreen::doRestore(size_t rawIdx, size_t cellIndex)
@@ -1099,10 +1152,17 @@ void MainScreen::handleEvents(const InputState& input)
                     [this, index, cell]() {
                         Title title;
                         TitleCatalog::get().getTitle(title, g_currentUId, rawIndex());
-                        std::string path = title.fullPath(cell);
+                        std::string path  = title.fullPath(cell);
+                        const bool stored = Manifest::layout(path) == Manifest::Layout::Stored;
                         io::deleteFolderRecursively((path + "/").c_str());
+                        Manifest::discard(path);
+                        if (stored) {
+                            // the objects only this backup used
+                            TransferJob::get().enqueueCollectGarbage();
+                            TransferJob::get().start();
+                        }
                         TitleCatalog::get().refreshDirectories(title.id());
-                        BackupSizeCache::get().invalidate(title.id()); // a backup was removed
+                        BackupSizeCache::get().backupRemoved(title.id(), path);
                         this->index(CELLS, index - 1);
                         this->removeOverlay();
                     },
@@ -1187,10 +1247,16 @@ void MainScreen::handleEvents(const InputState& input)
     // backup first" info box never appears — the script picker otherwise.
     // Receive is a row inside the backup list (handled by the A/touch path
     // above).
-    if (!MS::multipleSelectionEnabled() && (buttonSend->released() || (kdown & HidNpadButton_ZR))) {
+    if (buttonSend->released() || (kdown & HidNpadButton_ZR)) {
         // startTransferSend self-guards: it no-ops unless a highlighted existing
-        // backup is sendable, matching the greyed-out ZR button.
-        startTransferSend();
+        // backup is sendable, matching the greyed-out ZR button. While
+        // multi-selecting, ZR sends the latest backup of every tagged title.
+        if (MS::multipleSelectionEnabled()) {
+            startTransferSendSelected();
+        }
+        else {
+            startTransferSend();
+        }
         return;
     }
 }
@@ -1264,6 +1330,64 @@ void MainScreen::startTransferSend(void)
     TransferJob::get().start();
 }
 
+void MainScreen::startTransferSendSelected(void)
+{
+    if (!Configuration::getInstance().isTransferEnabled()) {
+        return;
+    }
+    if (!KeyboardManager::get().isSystemKeyboardAvailable().first) {
+        currentOverlay = std::make_shared<InfoOverlay>(*this, i18n::t("main.receiver_failed"));
+        return;
+    }
+
+    // The newest backup of each tagged title: saves() lists them newest first,
+    // after the "New..." row at index 0.
+    std::vector<Transfer::BatchItem> items;
+    for (size_t filtered : MS::selectedEntries()) {
+        Title title;
+        TitleCatalog::get().getTitle(title, g_currentUId, TitleCatalog::get().filteredToRawIndex(g_currentUId, mSaveTypeFilter, filtered));
+        if (title.saves().size() < 2) {
+            continue;
+        }
+        Transfer::BatchItem item;
+        item.backupPath = title.fullPath(1);
+        item.backupName = title.saves().at(1);
+        item.dataType   = "save";
+        item.title      = std::move(title);
+        items.push_back(std::move(item));
+    }
+    if (items.empty()) {
+        currentOverlay = std::make_shared<InfoOverlay>(*this, i18n::t("main.no_backups_to_send"));
+        return;
+    }
+
+    // One address and PIN for the whole batch.
+    std::string lastAddress             = Configuration::getInstance().lastTransferAddress();
+    std::pair<bool, std::string> ipResp = KeyboardManager::get().keyboard(lastAddress.empty() ? "192.168.0.10:8000" : lastAddress);
+    if (!ipResp.first || ipResp.second.empty()) {
+        return;
+    }
+    auto dst = Transfer::parseTarget(ipResp.second);
+    if (!dst) {
+        currentOverlay = std::make_shared<ErrorOverlay>(*this, -1, i18n::t("main.invalid_ip_port"));
+        return;
+    }
+    Configuration::getInstance().setLastTransferAddress(ipResp.second);
+
+    std::pair<bool, std::string> pinResp = KeyboardManager::get().keyboard("1234");
+    if (!pinResp.first || pinResp.second.empty()) {
+        return;
+    }
+    if (!Transfer::validPin(pinResp.second)) {
+        currentOverlay = std::make_shared<ErrorOverlay>(*this, -1, i18n::t("main.pin_invalid"));
+        return;
+    }
+
+    TransferJob::get().enqueueSend(std::move(items), std::move(dst->ip), dst->port, std::move(pinResp.second), i18n::t("transfer.completed"));
+    TransferJob::get().start();
+    MS::clearSelectedEntries();
+}
+
 std::string MainScreen::nameFromCell(size_t index) const
 {
     return backupList->cellName(index);
@@ -33,6 +33,7 @@
 #include "shapes.hpp"
 #include "titlecatalog.hpp"
 #include "transfer.hpp"
+#include "transferjob.hpp"
 #include "transferstatus.hpp"
 #include "uikit.hpp"
 
@@ -128,14 +129,18 @@ void ReceiveOverlay::draw(void) const
 void ReceiveOverlay::closeReceiver(void)
 {
     Transfer::stopReceiver();
-    // Refresh the backup list of the title that just received (no-op for id 0 /
-    // an unknown title, which won't appear until the next full reload).
-    u64 id = Transfer::consumeCompletedTitleId();
+    // Refresh the backup lists of the titles that just received (an unknown
+    // title has no id and won't appear until the next full reload).
     Transfer::consumePendingRefresh();
-    if (id != 0) {
+    for (u64 id : Transfer::consumeCompletedTitleIds()) {
         TitleCatalog::get().refreshDirectories(id);
         BackupSizeCache::get().invalidate(id);
     }
+    // A replaced stored backup left its objects behind; sweep them on the worker.
+    if (Transfer::consumeReleasedObjects()) {
+        TransferJob::get().enqueueCollectGarbage();
+        TransferJob::get().start();
+    }
     Transfer::clearReceiverCompletion();
     Transfer::clearReceiverNotice();
     screen.removeOverlay();
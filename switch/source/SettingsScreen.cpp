@@ -277,6 +277,42 @@ void SettingsScreen::rebuildRows(void)
             };
             mRows.push_back(std::move(quickBackup));
 
+            Row skipUnchanged;
+            skipUnchanged.title      = i18n::t("settings.general.skip_unchanged");
+            skipUnchanged.subtitle   = i18n::t("settings.general.skip_unchanged.sub");
+            skipUnchanged.control    = Control::Toggle;
+            skipUnchanged.section    = i18n::t("settings.section.safety");
+            skipUnchanged.getOn      = [&cfg]() { return cfg.isSkipUnchangedBackupsEnabled(); };
+            skipUnchanged.onActivate = [this, &cfg]() {
+                cfg.setSkipUnchangedBackupsEnabled(!cfg.isSkipUnchangedBackupsEnabled());
+                flashSaved();
+            };
+            mRows.push_back(std::move(skipUnchanged));
+
+            Row dedupeBackups;
+            dedupeBackups.title      = i18n::t("settings.general.dedupe_backups");
+            dedupeBackups.subtitle   = i18n::t("settings.general.dedupe_backups.sub");
+            dedupeBackups.control    = Control::Toggle;
+            dedupeBackups.section    = i18n::t("settings.section.safety");
+            dedupeBackups.getOn      = [&cfg]() { return cfg.isDedupeBackupsEnabled(); };
+            dedupeBackups.onActivate = [this, &cfg]() {
+                cfg.setDedupeBackupsEnabled(!cfg.isDedupeBackupsEnabled());
+                flashSaved();
+            };
+            mRows.push_back(std::move(dedupeBackups));
+
+            Row packBackups;
+            packBackups.title      = i18n::t("settings.general.pack_backups");
+            packBackups.subtitle   = i18n::t("settings.general.pack_backups.sub");
+            packBackups.control    = Control::Toggle;
+            packBackups.section    = i18n::t("settings.section.safety");
+            packBackups.getOn      = [&cfg]() { return cfg.isPackBackupsEnabled(); };
+            packBackups.onActivate = [this, &cfg]() {
+                cfg.setPackBackupsEnabled(!cfg.isPackBackupsEnabled());
+                flashSaved();
+            };
+            mRows.push_back(std::move(packBackups));
+
             Row verifyRestore;
             verifyRestore.title      = i18n::t("settings.general.verify_restore");
             verifyRestore.subtitle   = i18n::t("settings.general.verify_restore.sub");
@@ -288,6 +324,18 @@ void SettingsScreen::rebuildRows(void)
                 flashSaved();
             };
             mRows.push_back(std::move(verifyRestore));
+
+            Row differentialRestore;
+            differentialRestore.title      = i18n::t("settings.general.differential_restore");
+            differentialRestore.subtitle   = i18n::t("settings.general.differential_restore.sub");
+            differentialRestore.control    = Control::Toggle;
+            differentialRestore.section    = i18n::t("settings.section.safety");
+            differentialRestore.getOn      = [&cfg]() { return cfg.isDifferentialRestoreEnabled(); };
+            differentialRestore.onActivate = [this, &cfg]() {
+                cfg.setDifferentialRestoreEnabled(!cfg.isDifferentialRestoreEnabled());
+                flashSaved();
+            };
+            mRows.push_back(std::move(differentialRestore));
             break;
         }
         case Category::Connectivity: {
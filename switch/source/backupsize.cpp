@@ -25,11 +25,35 @@
  */
 
 #include "backupsize.hpp"
+#include "common.hpp"
 #include "directory.hpp"
 #include "io.hpp"
 #include "logging.hpp"
+#include "manifest.hpp"
+#include "paths.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <iterator>
 #include <sys/stat.h>
 
+namespace {
+    // One text line per record, so a damaged tail costs only the titles in it:
+    //   T <title id> <total bytes> <title folder>
+    //   B <bytes> <backup path>                    a backup sized from its manifest
+    //   W <bytes> <mtime> <entries> <backup path>  a walked backup and its Stamp
+    //   F <bytes> <file path>                      a plain file beside the backups
+    // Each B/W/F line belongs to the T line above it.
+    constexpr const char* INDEX_FILE   = "/backup-sizes.index";
+    constexpr const char* INDEX_HEADER = "checkpoint-sizes 1";
+
+    std::string indexPath(void)
+    {
+        return std::string(Paths::checkpointRoot()) + INDEX_FILE;
+    }
+}
+
 void BackupSizeCache::ensureWorker(void)
 {
     // Caller holds mMutex. Spawn the single worker lazily on the first request.
@@ -38,16 +62,67 @@ void BackupSizeCache::ensureWorker(void)
     }
 }
 
-void BackupSizeCache::request(u64 id, const std::string& rootPath)
+void BackupSizeCache::request(u64 id, const std::string& rootPath, Priority priority)
 {
     std::lock_guard<std::mutex> lock(mMutex);
-    if (mStop.load() || mCache.count(id) != 0 || mPending.count(id) != 0) {
+    loadIndex();
+
+    // Only one title is focused: the one that was keeps its place in the queue,
+    // but no longer outranks the titles around the new one.
+    if (priority == Priority::Focused) {
+        for (Task& task : mQueue) {
+            if (task.id != id && task.priority == Priority::Focused) {
+                task.priority = Priority::Prefetch;
+            }
+        }
+        if (mBusy && mCurrentId != id && mCurrentPriority == Priority::Focused) {
+            mCurrentPriority = Priority::Prefetch;
+        }
+    }
+
+    auto it = mCache.find(id);
+    if (mStop.load() || (it != mCache.end() && it->second.fresh)) {
+        return;
+    }
+    if (mBusy && mCurrentId == id) {
+        mCurrentPriority = std::max(mCurrentPriority, priority);
         return;
     }
-    mPending.insert(id);
-    mQueue.emplace_back(id, rootPath);
+    if (mPending.count(id) != 0) {
+        // Already queued: a higher priority moves it up, to the newest end.
+        auto queued = std::find_if(mQueue.begin(), mQueue.end(), [id](const Task& task) { return task.id == id; });
+        if (queued == mQueue.end() || queued->priority >= priority) {
+            return;
+        }
+        Task task     = std::move(*queued);
+        task.priority = priority;
+        mQueue.erase(queued);
+        mQueue.push_back(std::move(task));
+    }
+    else {
+        mPending.insert(id);
+        mQueue.push_back(Task{id, rootPath, priority});
+    }
+
+    if (priority == Priority::Prefetch) {
+        size_t prefetches = std::count_if(mQueue.begin(), mQueue.end(), [](const Task& task) { return task.priority == Priority::Prefetch; });
+        for (auto task = mQueue.begin(); prefetches > MAX_PREFETCH && task != mQueue.end();) {
+            if (task->priority == Priority::Prefetch) {
+                mPending.erase(task->id);
+                task = mQueue.erase(task);
+                prefetches--;
+            }
+            else {
+                ++task;
+            }
+        }
+    }
+
+    if (mBusy && priority > mCurrentPriority) {
+        mPreempt.store(true);
+    }
     ensureWorker();
-    mCond.notify_one();
+    mCond.notify_all();
 }
 
 std::optional<u64> BackupSizeCache::total(u64 id)
@@ -77,6 +152,11 @@ std::optional<u64> BackupSizeCache::backupSize(u64 id, const std::string& fullPa
 void BackupSizeCache::invalidate(u64 id)
 {
     std::lock_guard<std::mutex> lock(mMutex);
+    invalidateLocked(id);
+}
+
+void BackupSizeCache::invalidateLocked(u64 id)
+{
     mCache.erase(id);
     // If a compute for this id is in flight, tell it to discard its (now stale)
     // result so the next request recomputes against the current folders.
@@ -86,6 +166,61 @@ void BackupSizeCache::invalidate(u64 id)
     mGeneration.fetch_add(1);
 }
 
+void BackupSizeCache::backupWritten(u64 id, const std::string& fullPath, u64 bytes)
+{
+    applyDelta(id, fullPath, bytes);
+}
+
+void BackupSizeCache::backupRemoved(u64 id, const std::string& fullPath)
+{
+    applyDelta(id, fullPath, std::nullopt);
+}
+
+void BackupSizeCache::applyDelta(u64 id, const std::string& fullPath, std::optional<u64> bytes)
+{
+    // The backup's manifest is one of the plain files the total counts.
+    const std::string manifest = Manifest::pathFor(fullPath);
+    struct stat st;
+    const bool hasManifest = bytes.has_value() && stat(manifest.c_str(), &st) == 0;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mCache.find(id);
+    if (it == mCache.end()) {
+        return; // nothing cached: the next request computes it from scratch
+    }
+    Entry& entry       = it->second;
+    const size_t slash = fullPath.rfind('/');
+    if (mPending.count(id) != 0 || entry.base.empty() || slash == std::string::npos || fullPath.compare(0, slash + 1, entry.base) != 0) {
+        invalidateLocked(id);
+        return;
+    }
+
+    if (bytes.has_value()) {
+        entry.perBackup[fullPath] = *bytes;
+    }
+    else {
+        entry.perBackup.erase(fullPath);
+    }
+    if (hasManifest) {
+        entry.files[manifest] = (u64)st.st_size;
+    }
+    else {
+        entry.files.erase(manifest);
+    }
+    // Sized from its manifest from now on, or gone.
+    mStamps.erase(fullPath);
+
+    entry.total = 0;
+    for (const auto& [path, size] : entry.perBackup) {
+        entry.total += size;
+    }
+    for (const auto& [path, size] : entry.files) {
+        entry.total += size;
+    }
+    mIndexDirty = true;
+    mGeneration.fetch_add(1);
+}
+
 void BackupSizeCache::pause(void)
 {
     mPauseCount.fetch_add(1);
@@ -99,11 +234,11 @@ void BackupSizeCache::resume(void)
 
 void BackupSizeCache::gate(void)
 {
-    if (mPauseCount.load() <= 0 || mStop.load()) {
+    if (mPauseCount.load() <= 0 || aborted()) {
         return;
     }
     std::unique_lock<std::mutex> lock(mMutex);
-    mCond.wait(lock, [this]() { return mPauseCount.load() <= 0 || mStop.load(); });
+    mCond.wait(lock, [this]() { return mPauseCount.load() <= 0 || aborted(); });
 }
 
 void BackupSizeCache::shutdown(void)
@@ -119,6 +254,104 @@ void BackupSizeCache::shutdown(void)
     if (mWorker.joinable()) {
         mWorker.join();
     }
+    saveIndex();
+}
+
+void BackupSizeCache::loadIndex(void)
+{
+    if (mIndexLoaded) {
+        return;
+    }
+    mIndexLoaded = true;
+
+    FILE* f = fopen(indexPath().c_str(), "r");
+    if (f == NULL) {
+        return;
+    }
+    char line[1024];
+    if (fgets(line, sizeof(line), f) == NULL || std::string(line).rfind(INDEX_HEADER, 0) != 0) {
+        fclose(f);
+        Logging::warning("[sizecache] Ignoring {}: not a size index this version writes.", indexPath());
+        return;
+    }
+    Entry* entry  = nullptr;
+    size_t titles = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        std::string text(line);
+        if (text.empty() || text.back() != '\n') {
+            break; // cut short: drop the rest
+        }
+        text.pop_back();
+        unsigned long long a = 0, b = 0, c = 0;
+        int pathAt           = 0;
+        if (text[0] == 'T' && sscanf(text.c_str(), "T %llx %llu %n", &a, &b, &pathAt) == 2 && pathAt > 0) {
+            entry        = &mCache[(u64)a];
+            entry->total = (u64)b;
+            entry->base  = text.substr(pathAt);
+            titles++;
+        }
+        else if (entry != nullptr && text[0] == 'B' && sscanf(text.c_str(), "B %llu %n", &a, &pathAt) == 1 && pathAt > 0) {
+            entry->perBackup[text.substr(pathAt)] = (u64)a;
+        }
+        else if (entry != nullptr && text[0] == 'F' && sscanf(text.c_str(), "F %llu %n", &a, &pathAt) == 1 && pathAt > 0) {
+            entry->files[text.substr(pathAt)] = (u64)a;
+        }
+        else if (entry != nullptr && text[0] == 'W' && sscanf(text.c_str(), "W %llu %llu %llu %n", &a, &b, &c, &pathAt) == 3 && pathAt > 0) {
+            const std::string path = text.substr(pathAt);
+            entry->perBackup[path] = (u64)a;
+            mStamps[path]          = Stamp{(time_t)b, (size_t)c, (u64)a};
+        }
+    }
+    fclose(f);
+    Logging::info("[sizecache] Loaded the sizes of {} titles from {}.", titles, indexPath());
+}
+
+void BackupSizeCache::saveIndex(void)
+{
+    std::string text = std::string(INDEX_HEADER) + "\n";
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mIndexDirty) {
+            return;
+        }
+        mIndexDirty = false;
+        for (const auto& [id, entry] : mCache) {
+            text += StringUtils::format("T %016" PRIX64 " %" PRIu64 " ", id, entry.total) + entry.base + "\n";
+            for (const auto& [path, bytes] : entry.perBackup) {
+                auto stamp = mStamps.find(path);
+                if (stamp == mStamps.end()) {
+                    text += StringUtils::format("B %" PRIu64 " ", bytes) + path + "\n";
+                }
+                else {
+                    const Stamp& held = stamp->second;
+                    text += StringUtils::format("W %" PRIu64 " %lld %zu ", bytes, (long long)held.mtime, held.entries) + path + "\n";
+                }
+            }
+            for (const auto& [path, bytes] : entry.files) {
+                text += StringUtils::format("F %" PRIu64 " ", bytes) + path + "\n";
+            }
+        }
+    }
+
+    // Written aside, so a crash mid-write leaves the previous index rather than
+    // a torn one. The old index goes only once the new one is complete: the SD
+    // card refuses to rename onto an existing file.
+    const std::string path = indexPath();
+    const std::string temp = path + ".tmp";
+    FILE* f                = fopen(temp.c_str(), "w");
+    if (f == NULL) {
+        Logging::warning("[sizecache] Failed to create {} with errno {}.", temp, errno);
+        return;
+    }
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok      = fclose(f) == 0 && ok;
+    if (ok) {
+        std::remove(path.c_str());
+    }
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        Logging::warning("[sizecache] Failed to write {} with errno {}.", path, errno);
+        std::remove(temp.c_str());
+    }
 }
 
 void BackupSizeCache::workerLoop(void)
@@ -135,20 +368,42 @@ void BackupSizeCache::workerLoop(void)
     }
 
     for (;;) {
-        std::pair<u64, std::string> task;
+        Task task;
         {
             std::unique_lock<std::mutex> lock(mMutex);
             mCond.wait(lock, [this]() { return mStop.load() || !mQueue.empty(); });
             if (mStop.load()) {
                 return;
             }
-            // LIFO: take the most recently queued task. While browsing the title list
-            // this computes the size for the title the user just landed on before the
+            // The highest priority first and, among equals, LIFO: the most
+            // recently queued task. While browsing the title list this computes
+            // the size for the title the user just landed on before the
             // now-unfocused ones queued earlier.
-            task = std::move(mQueue.back());
-            mQueue.pop_back();
+            auto next = std::prev(mQueue.end());
+            for (auto it = mQueue.rbegin(); it != mQueue.rend(); ++it) {
+                if (it->priority > next->priority) {
+                    next = std::prev(it.base());
+                }
+            }
+            task = std::move(*next);
+            mQueue.erase(next);
+            mBusy            = true;
+            mCurrentId       = task.id;
+            mCurrentPriority = task.priority;
+            mPreempt.store(false);
+        }
+        compute(task.id, task.rootPath);
+
+        // Once the queue drains, so a browse through the title list writes the
+        // index once rather than once per title.
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            idle = mQueue.empty();
+        }
+        if (idle) {
+            saveIndex();
         }
-        compute(task.first, task.second);
     }
 }
 
@@ -159,37 +414,89 @@ void BackupSizeCache::compute(u64 id, const std::string& rootPath)
     // pause gate; the mStop check between folders lets a shutdown abort a long
     // scan promptly.
     Entry entry;
+    entry.fresh = true;
+    std::map<std::string, Stamp> stamps; // of the walked backups, for the index
     std::string base = rootPath;
     if (!base.empty() && base.back() != '/') {
         base += "/";
     }
+    entry.base = base;
 
     Directory items(base);
     if (items.good()) {
-        for (size_t i = 0, sz = items.size(); i < sz && !mStop.load(); i++) {
+        for (size_t i = 0, sz = items.size(); i < sz && !aborted(); i++) {
             gate();
             const std::string full = base + items.entry(i);
             if (items.folder(i)) {
-                const u64 s = walkSize(full + "/");
+                // A backup taken by this app records its size in its manifest,
+                // which saves walking it; any other falls back to the walk.
+                size_t files = 0;
+                u64 s        = 0;
+                if (!Manifest::readTotals(full, files, s)) {
+                    // Any other is walked only when it changed since the index
+                    // last saw it, going by one stat and one listing.
+                    struct stat st;
+                    Directory top(full + "/");
+                    Stamp stamp;
+                    stamp.mtime   = stat(full.c_str(), &st) == 0 ? st.st_mtime : 0;
+                    stamp.entries = top.good() ? top.size() : 0;
+                    bool known    = false;
+                    {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        auto it = mStamps.find(full);
+                        known   = top.good() && it != mStamps.end() && it->second.mtime == stamp.mtime && it->second.entries == stamp.entries;
+                        s       = known ? it->second.bytes : 0;
+                    }
+                    if (!known) {
+                        s = walkSize(full + "/");
+                    }
+                    stamp.bytes  = s;
+                    stamps[full] = stamp;
+                }
                 entry.total += s;
                 entry.perBackup[full] = s;
             }
-            else {
-                struct stat st;
-                if (stat(full.c_str(), &st) == 0) {
-                    entry.total += (u64)st.st_size;
-                }
+            else if (!Manifest::isPack(full)) {
+                // A pack's bytes are already in its backup's manifest totals.
+                entry.total += items.fileSize(i);
+                entry.files[full] = items.fileSize(i);
             }
         }
     }
 
     std::lock_guard<std::mutex> lock(mMutex);
+    mBusy = false;
+    // A pre-empted walk drops its partial result and goes back to the oldest end
+    // of the queue, at whatever priority it holds by then, to start over.
+    if (mPreempt.load() && !mStop.load()) {
+        mPreempt.store(false);
+        mDirty.erase(id);
+        mQueue.push_front(Task{id, rootPath, mCurrentPriority});
+        Logging::debug("[sizecache] Walk of {:016X} pre-empted.", id);
+        return;
+    }
     mPending.erase(id);
     // Discard a partial result produced during shutdown, or one invalidated
     // while the walk was running.
     if (mStop.load() || mDirty.erase(id) != 0) {
         return;
     }
+    // The index changes only when a size does, or a walked backup's stamp.
+    auto old = mCache.find(id);
+    if (old == mCache.end() || old->second.total != entry.total || old->second.perBackup != entry.perBackup ||
+        old->second.files != entry.files) {
+        mIndexDirty = true;
+    }
+    for (auto it = mStamps.lower_bound(base); it != mStamps.end() && it->first.rfind(base, 0) == 0;) {
+        it = stamps.count(it->first) == 0 ? mStamps.erase(it) : std::next(it);
+    }
+    for (const auto& [path, stamp] : stamps) {
+        Stamp& held = mStamps[path];
+        if (held.mtime != stamp.mtime || held.entries != stamp.entries || held.bytes != stamp.bytes) {
+            held        = stamp;
+            mIndexDirty = true;
+        }
+    }
     mCache[id] = std::move(entry);
     mGeneration.fetch_add(1);
 }
@@ -205,17 +512,14 @@ u64 BackupSizeCache::walkSize(const std::string& path)
     if (!base.empty() && base.back() != '/') {
         base += "/";
     }
-    for (size_t i = 0, sz = items.size(); i < sz && !mStop.load(); i++) {
+    for (size_t i = 0, sz = items.size(); i < sz && !aborted(); i++) {
         gate();
         const std::string child = base + items.entry(i);
         if (items.folder(i)) {
             total += walkSize(child + "/");
         }
         else {
-            struct stat st;
-            if (stat(child.c_str(), &st) == 0) {
-                total += (u64)st.st_size;
-            }
+            total += items.fileSize(i);
         }
     }
     return total;
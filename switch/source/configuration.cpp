@@ -83,6 +83,22 @@ Configuration::Configuration(void)
             mJson["verify-restore"] = false;
             updateJson              = true;
         }
+        if (!(mJson.contains("differential-restore") && mJson["differential-restore"].is_boolean())) {
+            mJson["differential-restore"] = false;
+            updateJson                    = true;
+        }
+        if (!(mJson.contains("skip-unchanged-backups") && mJson["skip-unchanged-backups"].is_boolean())) {
+            mJson["skip-unchanged-backups"] = true;
+            updateJson                      = true;
+        }
+        if (!(mJson.contains("dedupe-backups") && mJson["dedupe-backups"].is_boolean())) {
+            mJson["dedupe-backups"] = false;
+            updateJson              = true;
+        }
+        if (!(mJson.contains("pack-backups") && mJson["pack-backups"].is_boolean())) {
+            mJson["pack-backups"] = false;
+            updateJson            = true;
+        }
         if (!(mJson.contains("filter") && mJson["filter"].is_array())) {
             mJson["filter"] = nlohmann::json::array();
             updateJson      = true;
@@ -274,6 +290,14 @@ void Configuration::parse(void)
     mQuickBackup = mJson.value("quick-backup", false);
     // parse verify-restore flag
     mVerifyRestore = mJson.value("verify-restore", false);
+    // parse differential-restore flag
+    mDifferentialRestore = mJson.value("differential-restore", false);
+    // parse skip-unchanged-backups flag
+    mSkipUnchangedBackups = mJson.value("skip-unchanged-backups", true);
+    // parse dedupe-backups flag
+    mDedupeBackups = mJson.value("dedupe-backups", false);
+    // parse pack-backups flag
+    mPackBackups = mJson.value("pack-backups", false);
 
     mTheme               = mJson.value("theme", "dark");
     mLanguage            = mJson.value("language", "en");
@@ -402,6 +426,54 @@ void Configuration::setVerifyRestoreEnabled(bool enabled)
     save();
 }
 
+bool Configuration::isDifferentialRestoreEnabled(void)
+{
+    return mDifferentialRestore;
+}
+
+void Configuration::setDifferentialRestoreEnabled(bool enabled)
+{
+    mDifferentialRestore          = enabled;
+    mJson["differential-restore"] = enabled;
+    save();
+}
+
+bool Configuration::isSkipUnchangedBackupsEnabled(void)
+{
+    return mSkipUnchangedBackups;
+}
+
+void Configuration::setSkipUnchangedBackupsEnabled(bool enabled)
+{
+    mSkipUnchangedBackups           = enabled;
+    mJson["skip-unchanged-backups"] = enabled;
+    save();
+}
+
+bool Configuration::isDedupeBackupsEnabled(void)
+{
+    return mDedupeBackups;
+}
+
+void Configuration::setDedupeBackupsEnabled(bool enabled)
+{
+    mDedupeBackups          = enabled;
+    mJson["dedupe-backups"] = enabled;
+    save();
+}
+
+bool Configuration::isPackBackupsEnabled(void)
+{
+    return mPackBackups;
+}
+
+void Configuration::setPackBackupsEnabled(bool enabled)
+{
+    mPackBackups          = enabled;
+    mJson["pack-backups"] = enabled;
+    save();
+}
+
 void Configuration::addFolder(std::unordered_map<u64, std::vector<std::string>>& map, const char* key, u64 id, const std::string& path)
 {
     std::vector<std::string>& folders = map[id];
@@ -25,6 +25,51 @@
  */
 
 #include "directory.hpp"
+#include <memory>
+
+namespace {
+    // Entries fetched per fsDirRead call. Each is 0x310 bytes, so the batch
+    // lives on the heap rather than on a worker thread's stack.
+    constexpr size_t READ_BATCH = 64;
+
+    // Lists `root` straight through the filesystem service when it lies on an
+    // fsdev device ("sdmc:/...", "save:/..."): fsDirRead hands back each entry's
+    // size along with its name, where readdir drops it and every caller that
+    // needed it paid a stat() per file. Returns false, with `out` untouched, when
+    // `root` is not on such a device.
+    bool listWithSizes(const std::string& root, std::vector<DirectoryEntry>& out, Result& outError)
+    {
+        const size_t colon = root.find(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        FsFileSystem* fs = fsdevGetDeviceFileSystem(root.substr(0, colon).c_str());
+        if (fs == NULL) {
+            return false;
+        }
+
+        FsDir dir;
+        outError = fsFsOpenDirectory(fs, root.c_str() + colon + 1, FsDirOpenMode_ReadDirs | FsDirOpenMode_ReadFiles, &dir);
+        if (R_FAILED(outError)) {
+            return true;
+        }
+        std::unique_ptr<FsDirectoryEntry[]> batch(new FsDirectoryEntry[READ_BATCH]);
+        s64 count = 0;
+        do {
+            outError = fsDirRead(&dir, &count, READ_BATCH, batch.get());
+            if (R_FAILED(outError)) {
+                break;
+            }
+            for (s64 i = 0; i < count; i++) {
+                const FsDirectoryEntry& ent = batch[i];
+                const bool folder           = ent.type == FsDirEntryType_Dir;
+                out.push_back(DirectoryEntry{std::string(ent.name), folder, folder ? 0 : (u64)ent.file_size});
+            }
+        } while (count > 0);
+        fsDirClose(&dir);
+        return true;
+    }
+}
 
 Directory::Directory(const std::string& root)
 {
@@ -32,6 +77,15 @@ Directory::Directory(const std::string& root)
     mError = 0;
     mList.clear();
 
+    if (listWithSizes(root, mList, mError)) {
+        if (R_FAILED(mError)) {
+            mList.clear();
+            return;
+        }
+        mGood = true;
+        return;
+    }
+
     DIR* dir = opendir(root.c_str());
     if (dir == NULL) {
         mError = (Result)errno;
@@ -46,7 +100,7 @@ Directory::Directory(const std::string& root)
     struct dirent* ent;
     errno = 0;
     while ((ent = readdir(dir)) != NULL) {
-        struct DirectoryEntry de = {std::string(ent->d_name), ent->d_type == DT_DIR};
+        struct DirectoryEntry de = {std::string(ent->d_name), ent->d_type == DT_DIR, 0};
         mList.push_back(de);
         errno = 0;
     }
@@ -82,6 +136,11 @@ bool Directory::folder(size_t index)
     return index < mList.size() ? mList.at(index).directory : false;
 }
 
+u64 Directory::fileSize(size_t index)
+{
+    return index < mList.size() ? mList.at(index).size : 0;
+}
+
 size_t Directory::size(void)
 {
     return mList.size();
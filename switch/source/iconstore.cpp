@@ -38,12 +38,17 @@ static constexpr Color systemSavePalette[] = {
 };
 
 void TextureIconStore::loadIcon(u64 id, NsApplicationControlData* nsacd, size_t iconSize)
+{
+    storeIcon(id, nsacd->icon, iconSize);
+}
+
+void TextureIconStore::storeIcon(u64 id, const u8* jpeg, size_t size)
 {
     if (mIcons.find(id) != mIcons.end()) {
         return;
     }
     Texture* texture = nullptr;
-    Gfx::LoadImage(&texture, nsacd->icon, iconSize);
+    Gfx::LoadImage(&texture, const_cast<u8*>(jpeg), size);
     Gfx::SetTextureOpaque(texture);
     mIcons.insert({id, texture});
 }
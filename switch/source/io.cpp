@@ -27,12 +27,21 @@
 #include "io.hpp"
 #include "configuration.hpp"
 #include "logging.hpp"
+#include "manifest.hpp"
+#include "objectstore.hpp"
 #include "savedatasource.hpp"
 #include "titlecatalog.hpp"
 #include <algorithm>
 #include <arm_acle.h>
+#include <atomic>
+#include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 // Errno-domain copy failures (fopen/fread/fwrite/mkdir) folded into the Result
 // channel that IoOutcome carries; the exact cause is in the log.
@@ -55,6 +64,12 @@ static constexpr u64 SAVE_EXTEND_HEADROOM_DIV = 10;        // or 10% of the payl
 // files.
 static constexpr u64 SAVE_CLUSTER_SIZE = 0x4000;
 
+// What a batched commit charges against the journal for each file or folder it
+// creates, on top of the data: the entry and allocation-table updates. One
+// cluster is deliberately generous, since overflowing the journal fails the
+// whole commit.
+static constexpr u64 JOURNAL_ENTRY_COST = SAVE_CLUSTER_SIZE;
+
 namespace {
     void scanTreeInto(const std::string& path, io::TreeStats& stats, ProgressSink* sink)
     {
@@ -75,14 +90,7 @@ namespace {
                 if (sink != nullptr) {
                     sink->startFile(items.entry(i), 0);
                 }
-                struct stat st;
-                if (stat(child.c_str(), &st) == 0) {
-                    stats.bytes += (u64)st.st_size;
-                }
-                else {
-                    Logging::error("Scan: stat failed on {} with errno {}.", child, errno);
-                    stats.unreadable++;
-                }
+                stats.bytes += items.fileSize(i);
                 if (sink != nullptr) {
                     sink->finishFile();
                 }
@@ -90,6 +98,86 @@ namespace {
         }
     }
 
+    void snapshotInto(const std::string& root, const std::string& rel, io::TreeSnapshot& tree, ProgressSink* sink)
+    {
+        Directory items(root + rel);
+        if (!items.good()) {
+            Logging::error("Scan: failed to list {} with error 0x{:08X}.", root + rel, (u32)items.error());
+            tree.stats.unreadable++;
+            return;
+        }
+        for (size_t i = 0, sz = items.size(); i < sz; i++) {
+            const std::string child = rel + items.entry(i);
+            io::TreeSnapshot::Node node{(u32)tree.paths.size(), (u32)child.size(), items.folder(i), 0};
+            if (node.folder) {
+                tree.stats.dirs++;
+                tree.paths += child;
+                tree.nodes.push_back(node);
+                snapshotInto(root, child + "/", tree, sink);
+                continue;
+            }
+            if (sink != nullptr) {
+                sink->startFile(items.entry(i), 0);
+            }
+            node.size = items.fileSize(i);
+            tree.stats.files++;
+            tree.stats.bytes += node.size;
+            tree.paths += child;
+            tree.nodes.push_back(node);
+            if (sink != nullptr) {
+                sink->finishFile();
+            }
+        }
+    }
+
+    // Commits everything `budget` has pending. `what` names the copy in the log.
+    Result commitBudget(io::CommitBudget& budget, const std::string& what)
+    {
+        if (budget.pending == 0 && budget.entries == 0) {
+            return 0;
+        }
+        const Result res = fsdevCommitDevice("save");
+        if (R_FAILED(res)) {
+            Logging::error("Commit of {} entries / {} journal bytes ending at {} failed with result 0x{:08X}.", budget.entries, budget.pending, what,
+                (u32)res);
+            return res;
+        }
+        budget.pending = 0;
+        budget.entries = 0;
+        return 0;
+    }
+
+    // Charges the creation of one file or folder to `budget`, committing first
+    // if it would not fit.
+    Result chargeEntry(io::CommitBudget& budget, const std::string& what)
+    {
+        if (budget.limit > 0 && budget.pending + JOURNAL_ENTRY_COST > budget.limit) {
+            const Result res = commitBudget(budget, what);
+            if (R_FAILED(res)) {
+                return res;
+            }
+        }
+        budget.pending += JOURNAL_ENTRY_COST;
+        budget.entries++;
+        return 0;
+    }
+
+    // The nodes of `tree` ordered by relative path, for comparing two listings
+    // that the filesystems returned in different orders.
+    std::vector<size_t> sortedByPath(const io::TreeSnapshot& tree)
+    {
+        std::vector<size_t> order(tree.nodes.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&tree](size_t a, size_t b) {
+            const io::TreeSnapshot::Node& na = tree.nodes[a];
+            const io::TreeSnapshot::Node& nb = tree.nodes[b];
+            return tree.paths.compare(na.offset, na.length, tree.paths, nb.offset, nb.length) < 0;
+        });
+        return order;
+    }
+
     // Hardware CRC32 (zlib polynomial), same routine as transfer.cpp: only used
     // to compare a backup file against its restored copy, so the exact variant
     // doesn't matter as long as both sides use this function.
@@ -112,10 +200,12 @@ namespace {
 
     enum class ReadOutcome { Ok, Missing, Unreadable };
 
-    // Reads `path` whole and hands back its size and CRC32. `buf` is the caller's
-    // scratch buffer on purpose: verification opens tens of thousands of files
-    // back to back, and a fresh 512 KiB allocation per file was pure overhead.
-    ReadOutcome fileSizeAndCrc(const std::string& path, u8* buf, u64& outSize, u32& outCrc, ProgressSink* sink = nullptr)
+    // Reads `path` whole, or only the bytes `span` gives, and hands back their
+    // size and CRC32, and feeds `sha` when given. `buf` is the caller's scratch
+    // buffer on purpose: verification opens tens of thousands of files back to
+    // back, and a fresh 512 KiB allocation per file was pure overhead.
+    ReadOutcome fileSizeAndCrc(const std::string& path, u8* buf, u64& outSize, u32& outCrc, ProgressSink* sink = nullptr,
+        Sha256Context* sha = nullptr, const io::FileSpan* span = nullptr)
     {
         FILE* f = fopen(path.c_str(), "rb");
         if (f == NULL) {
@@ -125,11 +215,20 @@ namespace {
             Logging::error("Verification: failed to open {} with errno {}.", path, errno);
             return ReadOutcome::Unreadable;
         }
-        u64 size = 0;
-        u32 crc  = 0;
+        if (span != nullptr && fseek(f, (long)span->offset, SEEK_SET) != 0) {
+            Logging::error("Verification: failed to seek {} to offset {} with errno {}.", path, span->offset, errno);
+            fclose(f);
+            return ReadOutcome::Unreadable;
+        }
+        const u64 limit = span != nullptr ? span->length : UINT64_MAX;
+        u64 size        = 0;
+        u32 crc         = 0;
         size_t count;
-        while ((count = fread(buf, 1, BUFFER_SIZE, f)) > 0) {
+        while (size < limit && (count = fread(buf, 1, std::min<u64>(BUFFER_SIZE, limit - size), f)) > 0) {
             crc = updateCrc(crc, buf, count);
+            if (sha != nullptr) {
+                sha256ContextUpdate(sha, buf, count);
+            }
             size += count;
             if (sink != nullptr) {
                 sink->advanceBytes(size);
@@ -157,21 +256,64 @@ namespace {
         size_t problems() const { return missing + sizeMismatch + crcMismatch + unreadable; }
     };
 
+    // How many files verification reads at once. The save filesystem serves
+    // reads of different files concurrently, so a few in flight hide the open
+    // and read latency of one file behind the CRC of another; past that they
+    // only contend for the same storage.
+    constexpr size_t VERIFY_READERS = 3;
+
     // Re-reads every file the copy wrote, off a freshly mounted save, and compares
     // it against the CRC32 the copy took of the bytes it moved. Only the save is
     // read: the backup was already read once, by the copy.
+    //
+    // A small pool of readers works ahead through the list while this thread
+    // takes their results in list order, so the progress reported and the
+    // mismatches logged come out exactly as a sequential pass would give them.
     void verifyCopiedFiles(const std::vector<io::CopiedFile>& copied, VerifyStats& stats, ProgressSink& sink)
     {
-        std::vector<u8> buf(BUFFER_SIZE);
-        for (const io::CopiedFile& file : copied) {
+        struct FileRead {
+            ReadOutcome outcome = ReadOutcome::Unreadable;
+            u64 size            = 0;
+            u32 crc             = 0;
+            bool done           = false;
+        };
+        std::vector<FileRead> reads(copied.size());
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<size_t> nextToRead{0};
+
+        std::vector<std::thread> readers;
+        for (size_t r = 0, count = std::min(VERIFY_READERS, copied.size()); r < count; r++) {
+            readers.emplace_back([&]() {
+                std::unique_ptr<u8[]> buf(new u8[BUFFER_SIZE]);
+                for (size_t i = nextToRead++; i < copied.size(); i = nextToRead++) {
+                    FileRead read;
+                    read.outcome = fileSizeAndCrc(copied[i].path, buf.get(), read.size, read.crc);
+                    read.done    = true;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        reads[i] = read;
+                    }
+                    cv.notify_all();
+                }
+            });
+        }
+
+        for (size_t i = 0; i < copied.size(); i++) {
+            const io::CopiedFile& file = copied[i];
+            FileRead read;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&reads, i]() { return reads[i].done; });
+                read = reads[i];
+            }
             const size_t slashpos = file.path.rfind('/');
             sink.startFile(file.path.substr(slashpos + 1), file.size);
+            sink.advanceBytes(read.size);
             stats.checked++;
             stats.bytes += file.size;
 
-            u64 size = 0;
-            u32 crc  = 0;
-            switch (fileSizeAndCrc(file.path, buf.data(), size, crc, &sink)) {
+            switch (read.outcome) {
                 case ReadOutcome::Missing:
                     Logging::error("Verification: file {} missing from restored save.", file.path);
                     stats.missing++;
@@ -180,234 +322,873 @@ namespace {
                     stats.unreadable++;
                     break;
                 case ReadOutcome::Ok:
-                    if (size != file.size) {
-                        Logging::error("Verification: size mismatch on {}: copied {} bytes, save holds {} bytes.", file.path, file.size, size);
+                    if (read.size != file.size) {
+                        Logging::error(
+                            "Verification: size mismatch on {}: copied {} bytes, save holds {} bytes.", file.path, file.size, read.size);
                         stats.sizeMismatch++;
                     }
-                    else if (crc != file.crc) {
-                        Logging::error(
-                            "Verification: CRC mismatch on {} ({} bytes): copied {:08X}, save holds {:08X}.", file.path, file.size, file.crc, crc);
+                    else if (read.crc != file.crc) {
+                        Logging::error("Verification: CRC mismatch on {} ({} bytes): copied {:08X}, save holds {:08X}.", file.path, file.size,
+                            file.crc, read.crc);
                         stats.crcMismatch++;
                     }
                     break;
             }
             sink.finishFile();
         }
+
+        for (std::thread& reader : readers) {
+            reader.join();
+        }
     }
 
-}
+    // Records a finished backup in its manifest. `digests` holds one entry per
+    // file of `tree`, in the snapshot's order, as copySnapshot produced them;
+    // `hashes`, given for a stored backup, likewise. A manifest that fails to
+    // write costs a copied backup only the shortcuts that read it, so that
+    // backup still counts as a success; a stored or packed one is lost without it.
+    bool writeManifest(const io::TreeSnapshot& tree, const std::vector<io::CopiedFile>& digests, const std::string& backupPath,
+        const Manifest::SaveStamp* stamp, Manifest::Layout layout = Manifest::Layout::Folder,
+        const std::vector<ObjectStore::Digest>* hashes = nullptr)
+    {
+        if (digests.size() != tree.stats.files || (hashes != nullptr && hashes->size() != digests.size())) {
+            Logging::error("Manifest: {} digests for {} files; not writing one for {}.", digests.size(), tree.stats.files, backupPath);
+            return false;
+        }
+        std::vector<Manifest::Entry> entries;
+        entries.reserve(tree.nodes.size());
+        size_t next = 0;
+        for (size_t i = 0; i < tree.nodes.size(); i++) {
+            Manifest::Entry entry{tree.relPath(i), tree.nodes[i].folder};
+            if (!entry.folder) {
+                entry.size = digests[next].size;
+                entry.crc  = digests[next].crc;
+                if (hashes != nullptr) {
+                    entry.sha256 = (*hashes)[next];
+                }
+                next++;
+            }
+            entries.push_back(std::move(entry));
+        }
+        if (!Manifest::write(backupPath, entries, stamp, layout)) {
+            return false;
+        }
+        Logging::info("Manifest: recorded {} entries for {}.", entries.size(), backupPath);
+        return true;
+    }
 
-bool io::fileExists(const std::string& path)
-{
-    struct stat buffer;
-    return (stat(path.c_str(), &buffer) == 0);
-}
+    // Compares what a restore copied out of a backup (`copied`, paths under
+    // `dstRoot`) against the backup's manifest. A difference is not an error:
+    // backups are edited on the SD card on purpose. It is logged so a restore
+    // of a backup that has rotted or been changed since it was taken says so.
+    void crossCheckManifest(const Manifest::Contents& manifest, const std::vector<io::CopiedFile>& copied, const std::string& dstRoot)
+    {
+        static constexpr size_t MAX_LOGGED = 10;
 
-size_t io::countFiles(const std::string& path)
-{
-    size_t count = 0;
-    Directory items(path);
-    if (!items.good()) {
-        return 0;
-    }
-    for (size_t i = 0, sz = items.size(); i < sz; i++) {
-        if (items.folder(i)) {
-            count += io::countFiles(path + items.entry(i) + "/");
+        std::unordered_map<std::string, const Manifest::Entry*> recorded;
+        recorded.reserve(manifest.files);
+        for (const Manifest::Entry& entry : manifest.entries) {
+            if (!entry.folder) {
+                recorded.emplace(entry.relPath, &entry);
+            }
+        }
+        size_t changed = 0;
+        for (const io::CopiedFile& file : copied) {
+            const std::string rel = file.path.substr(dstRoot.size());
+            auto it               = recorded.find(rel);
+            if (it != recorded.end() && it->second->size == file.size && it->second->crc == file.crc) {
+                continue;
+            }
+            if (changed++ < MAX_LOGGED) {
+                Logging::warning("Manifest: {} differs from when the backup was taken.", rel);
+            }
+        }
+        if (changed > 0 || copied.size() != manifest.files) {
+            Logging::warning("Manifest: {} of {} restored files differ from the backup as it was taken ({} files then).", changed, copied.size(),
+                manifest.files);
         }
         else {
-            count++;
+            Logging::info("Manifest: all {} restored files match the backup as it was taken.", copied.size());
         }
     }
-    return count;
-}
-
-io::TreeStats io::scanTree(const std::string& path, ProgressSink* sink)
-{
-    TreeStats total;
-    scanTreeInto(path, total, sink);
-    return total;
-}
 
-Result io::copyFile(const std::string& srcPath, const std::string& dstPath, ProgressSink& sink, u64 commitWriteLimit, u64* bytesCopied, u32* crcOut)
-{
-    FILE* src = fopen(srcPath.c_str(), "rb");
-    if (src == NULL) {
-        Logging::error("Failed to open source file {} during copy with errno {}.", srcPath, errno);
-        return RES_COPY_FAILED;
+    // The commit id and timestamp the filesystem keeps in the save's extra data.
+    // False when they cannot be read or the save has never been committed.
+    bool readSaveStamp(Title& title, Manifest::SaveStamp& out)
+    {
+        FsSaveDataExtraData extraData = {};
+        Result res                    = fsReadSaveDataFileSystemExtraDataBySaveDataSpaceId(
+            &extraData, sizeof(extraData), (FsSaveDataSpaceId)title.saveDataSpaceId(), title.saveId());
+        if (R_FAILED(res) || extraData.commit_id == 0) {
+            return false;
+        }
+        out.commitId  = extraData.commit_id;
+        out.timestamp = extraData.timestamp;
+        return true;
     }
-    fseek(src, 0, SEEK_END);
-    u64 sz = ftell(src);
-    rewind(src);
 
-    const bool toSaveDevice = dstPath.rfind("save:/", 0) == 0;
+    // The title's most recent backup that has a manifest, going by when the
+    // manifest was written (folder names are free-form, so their order says
+    // nothing). Empty when no backup has one.
+    std::string newestManifestedBackup(Title& title, time_t& outWritten)
+    {
+        std::string newest;
+        outWritten = 0;
+        for (size_t i = 0, sz = title.saves().size(); i < sz; i++) {
+            const std::string path = title.fullPath(i);
+            struct stat st;
+            if (stat(Manifest::pathFor(path).c_str(), &st) == 0 && (newest.empty() || st.st_mtime > outWritten)) {
+                newest     = path;
+                outWritten = st.st_mtime;
+            }
+        }
+        return newest;
+    }
 
-    // Create the destination at its final size instead of letting it grow one
-    // write at a time. Every extending write on the save filesystem has to find
-    // and chain a free block, so an append-grown tree of tens of thousands of
-    // files both fragments and gets slower as the save fills.
-    bool preallocated = false;
-    if (toSaveDevice && sz > 0) {
-        const Result cr = fsdevCreateFile(dstPath.c_str(), (size_t)sz, 0);
-        if (R_SUCCEEDED(cr)) {
-            preallocated = true;
+    // True when `backupPath` still holds exactly the files its manifest lists, at
+    // their recorded sizes, none modified after the manifest was written. A
+    // backup edited on the SD card no longer matches its manifest, and must not
+    // stand in for a fresh copy of the save. The files of a stored backup are
+    // its objects; a packed one is checked as its pack, whose folder holds none.
+    bool backupMatchesManifest(const Manifest::Contents& manifest, const std::string& backupPath, time_t written)
+    {
+        const bool stored        = manifest.layout == Manifest::Layout::Stored;
+        const bool packed        = manifest.layout == Manifest::Layout::Packed;
+        const io::TreeStats held = stored ? io::TreeStats{} : io::scanTree(backupPath + "/");
+        if (packed) {
+            struct stat st;
+            const std::string pack = Manifest::packPathFor(backupPath);
+            if (held.unreadable > 0 || held.files != 0 || stat(pack.c_str(), &st) != 0 || (u64)st.st_size != manifest.totalBytes ||
+                st.st_mtime > written) {
+                Logging::info("Change check: {} was changed after its manifest was written.", pack);
+                return false;
+            }
+            return true;
         }
-        else {
-            Logging::debug("Preallocating {} at {} bytes failed with result 0x{:08X}; growing it by writes instead.", dstPath, sz, (u32)cr);
+        if (!stored && (held.unreadable > 0 || held.files != manifest.files || held.bytes != manifest.totalBytes)) {
+            return false;
         }
+        for (const Manifest::Entry& entry : manifest.entries) {
+            if (entry.folder) {
+                continue;
+            }
+            struct stat st;
+            const std::string path = stored ? ObjectStore::objectPath(entry.sha256) : backupPath + "/" + entry.relPath;
+            if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || (u64)st.st_size != entry.size || st.st_mtime > written) {
+                Logging::info("Change check: {} was changed after its manifest was written.", path);
+                return false;
+            }
+        }
+        return true;
     }
 
-    // "wb" truncates, which would throw the preallocation away: an already-sized
-    // file has to be opened for update instead.
-    FILE* dst = fopen(dstPath.c_str(), preallocated ? "r+b" : "wb");
-    if (dst == NULL) {
-        Logging::error("Failed to open destination file {} during copy with errno {}.", dstPath, errno);
-        fclose(src);
-        return RES_COPY_FAILED;
+    // True when the save (`save`, a snapshot of save:/) holds what `manifest`
+    // records: the same entries and sizes and, with `readContents`, the same
+    // CRC32 file by file. Stops at the first difference, so a changed save costs
+    // little more than its listing.
+    bool saveMatchesManifest(const io::TreeSnapshot& save, const Manifest::Contents& manifest, bool readContents, ProgressSink& sink)
+    {
+        if (save.nodes.size() != manifest.entries.size() || save.stats.files != manifest.files || save.stats.bytes != manifest.totalBytes) {
+            return false;
+        }
+        std::unordered_map<std::string, const Manifest::Entry*> recorded;
+        recorded.reserve(manifest.entries.size());
+        for (const Manifest::Entry& entry : manifest.entries) {
+            recorded.emplace(entry.relPath, &entry);
+        }
+        std::vector<const Manifest::Entry*> files;
+        files.reserve(manifest.files);
+        for (size_t i = 0; i < save.nodes.size(); i++) {
+            auto it = recorded.find(save.relPath(i));
+            if (it == recorded.end() || it->second->folder != save.nodes[i].folder || it->second->size != save.nodes[i].size) {
+                return false;
+            }
+            if (!save.nodes[i].folder) {
+                files.push_back(it->second);
+            }
+        }
+
+        if (!readContents) {
+            return true;
+        }
+
+        std::vector<u8> buf(BUFFER_SIZE);
+        bool same = true;
+        sink.begin("Comparing", files.size());
+        for (const Manifest::Entry* entry : files) {
+            sink.startFile(entry->relPath.substr(entry->relPath.rfind('/') + 1), entry->size);
+            u64 size = 0;
+            u32 crc  = 0;
+            same     = fileSizeAndCrc("save:/" + entry->relPath, buf.data(), size, crc, &sink) == ReadOutcome::Ok && size == entry->size &&
+                   crc == entry->crc;
+            sink.finishFile();
+            if (!same) {
+                break;
+            }
+        }
+        sink.end();
+        return same;
     }
 
-    u8* buf    = new u8[BUFFER_SIZE];
-    u64 offset = 0;
-    u32 crc    = 0;
-    Result res = 0;
+    // The copy of a backup into the object store. Each file of `tree` (under
+    // `srcRoot`) is hashed first and written only when the store lacks its
+    // contents, so a backup of a mostly unchanged save reads the save once and
+    // writes little more than its manifest. `digests` and `hashes` get one entry
+    // per file, in the snapshot's order.
+    Result storeSnapshot(const io::TreeSnapshot& tree, const std::string& srcRoot, ProgressSink& sink, io::TreeStats& copied,
+        std::vector<io::CopiedFile>& digests, std::vector<ObjectStore::Digest>& hashes)
+    {
+        std::vector<u8> buf(BUFFER_SIZE);
+        size_t added = 0;
+        for (size_t i = 0, sz = tree.nodes.size(); i < sz && !sink.cancelled(); i++) {
+            if (tree.nodes[i].folder) {
+                copied.dirs++;
+                continue;
+            }
+            const std::string rel = tree.relPath(i);
+            const std::string src = srcRoot + rel;
+            u64 size              = 0;
+            u32 crc               = 0;
+            ObjectStore::Digest digest;
+            Sha256Context sha;
+            sha256ContextCreate(&sha);
+            sink.startFile(rel.substr(rel.rfind('/') + 1), tree.nodes[i].size);
+            const ReadOutcome read = fileSizeAndCrc(src, buf.data(), size, crc, &sink, &sha);
+            sink.finishFile();
+            if (read != ReadOutcome::Ok) {
+                Logging::error("Object store: failed to read {}.", src);
+                return RES_COPY_FAILED;
+            }
+            sha256ContextGetHash(&sha, digest.data());
+
+            const std::string object = ObjectStore::objectPath(digest);
+            if (!ObjectStore::holds(digest, size)) {
+                const std::string temp = ObjectStore::tempPath(digest);
+                u64 bytes              = 0;
+                u32 written            = 0;
+                Result res             = ObjectStore::prepare(digest);
+                if (R_SUCCEEDED(res)) {
+                    res = io::copyFile(src, temp, sink, nullptr, &bytes, &written);
+                }
+                // The file is read twice; one that changed in between would be
+                // stored under a hash that does not describe it.
+                if (R_SUCCEEDED(res) && (bytes != size || written != crc)) {
+                    Logging::error("Object store: {} changed while it was being stored.", src);
+                    res = RES_COPY_FAILED;
+                }
+                // A damaged object of this digest may be in the way, and the SD
+                // card refuses to rename onto an existing file.
+                if (R_SUCCEEDED(res)) {
+                    std::remove(object.c_str());
+                }
+                if (R_SUCCEEDED(res) && rename(temp.c_str(), object.c_str()) != 0) {
+                    Logging::error("Object store: failed to rename {} with errno {}.", temp, errno);
+                    res = RES_COPY_FAILED;
+                }
+                if (R_FAILED(res)) {
+                    std::remove(temp.c_str());
+                    return res;
+                }
+                added++;
+            }
+            copied.files++;
+            copied.bytes += size;
+            digests.push_back(io::CopiedFile{object, size, crc});
+            hashes.push_back(digest);
+        }
+        Logging::info("Object store: {} of {} files were new.", added, digests.size());
+        return 0;
+    }
 
-    size_t slashpos = srcPath.rfind("/");
-    sink.startFile(srcPath.substr(slashpos + 1, srcPath.length() - slashpos - 1), sz);
+    // The snapshot of a packed backup, out of its manifest: every file is read
+    // from the pack, at the offset where the files before it end. A pack that
+    // does not hold exactly what the manifest lists is refused as unreadable.
+    io::TreeSnapshot packedSnapshot(const Manifest::Contents& manifest, const std::string& backupPath)
+    {
+        io::TreeSnapshot tree;
+        tree.pack = Manifest::packPathFor(backupPath);
+        tree.nodes.reserve(manifest.entries.size());
+        tree.offsets.reserve(manifest.entries.size());
+        u64 offset = 0;
+        for (const Manifest::Entry& entry : manifest.entries) {
+            if (entry.folder) {
+                tree.stats.dirs++;
+            }
+            else {
+                tree.stats.files++;
+                tree.stats.bytes += entry.size;
+            }
+            tree.nodes.push_back(io::TreeSnapshot::Node{(u32)tree.paths.size(), (u32)entry.relPath.size(), entry.folder, entry.size});
+            tree.paths += entry.relPath;
+            tree.offsets.push_back(offset);
+            offset += entry.size;
+        }
+        struct stat st;
+        if (stat(tree.pack.c_str(), &st) != 0 || (u64)st.st_size != offset) {
+            Logging::error("Pack {} is missing or does not hold the {} bytes its manifest lists.", tree.pack, offset);
+            tree.stats.unreadable++;
+        }
+        return tree;
+    }
 
-    // The save journal only holds `commitWriteLimit` bytes of uncommitted writes:
-    // a single file bigger than that must be committed partway through, or the
-    // commit at the end would overflow the journal and fail (#443, #297).
-    u64 journalPending = 0;
+    // The copy of a backup into a single pack: the files of `tree` (under
+    // `srcRoot`) are written back to back, in the snapshot's order, which is
+    // the order packedSnapshot reads them in. The SD card sees one file grow
+    // instead of one file created per save file. The pack is written under a
+    // temporary name and renamed once complete.
+    Result packSnapshot(const io::TreeSnapshot& tree, const std::string& srcRoot, const std::string& packPath, ProgressSink& sink,
+        io::TreeStats& copied, std::vector<io::CopiedFile>& digests)
+    {
+        const std::string temp = packPath + ".tmp";
+        FILE* dst              = fopen(temp.c_str(), "wb");
+        if (dst == NULL) {
+            Logging::error("Failed to create pack {} with errno {}.", temp, errno);
+            return RES_COPY_FAILED;
+        }
+        std::unique_ptr<char[]> dstBuffer(new char[BUFFER_SIZE]);
+        setvbuf(dst, dstBuffer.get(), _IOFBF, BUFFER_SIZE);
+        std::vector<u8> buf(BUFFER_SIZE);
 
-    while (offset < sz) {
-        if (sink.cancelled()) {
-            break;
+        Result res = 0;
+        for (size_t i = 0, sz = tree.nodes.size(); i < sz && R_SUCCEEDED(res) && !sink.cancelled(); i++) {
+            if (tree.nodes[i].folder) {
+                copied.dirs++;
+                continue;
+            }
+            const std::string rel = tree.relPath(i);
+            const std::string src = srcRoot + rel;
+            FILE* in              = fopen(src.c_str(), "rb");
+            if (in == NULL) {
+                Logging::error("Failed to open source file {} during copy with errno {}.", src, errno);
+                res = RES_COPY_FAILED;
+                break;
+            }
+            sink.startFile(rel.substr(rel.rfind('/') + 1), tree.nodes[i].size);
+            u64 size = 0;
+            u32 crc  = 0;
+            size_t count;
+            while (!sink.cancelled() && (count = fread(buf.data(), 1, BUFFER_SIZE, in)) > 0) {
+                crc = updateCrc(crc, buf.data(), count);
+                if (fwrite(buf.data(), 1, count, dst) != count) {
+                    Logging::error("fwrite failed for pack {} at {} of {} with errno {}. Aborting copy.", temp, size, src, errno);
+                    res = RES_COPY_FAILED;
+                    break;
+                }
+                size += count;
+                sink.advanceBytes(size);
+            }
+            if (R_SUCCEEDED(res) && ferror(in) != 0) {
+                Logging::error("Read error on {} with errno {}. Aborting copy.", src, errno);
+                res = RES_COPY_FAILED;
+            }
+            fclose(in);
+            sink.finishFile();
+            // The offsets of every later file hang off this one's size, so a
+            // file that changed size under the copy breaks the whole pack.
+            if (R_SUCCEEDED(res) && !sink.cancelled() && size != tree.nodes[i].size) {
+                Logging::error("{} is {} bytes but was listed at {}. Aborting copy.", src, size, tree.nodes[i].size);
+                res = RES_COPY_FAILED;
+            }
+            if (R_SUCCEEDED(res)) {
+                copied.files++;
+                copied.bytes += size;
+                digests.push_back(io::CopiedFile{packPath, size, crc});
+            }
         }
 
-        size_t count = fread((char*)buf, 1, BUFFER_SIZE, src);
-        if (count == 0) {
-            Logging::error("fread returned 0 for file {} at offset {}/{} with errno {}. Aborting copy.", srcPath, offset, sz, errno);
+        if (fclose(dst) != 0 && R_SUCCEEDED(res)) {
+            Logging::error("fclose failed for pack {} with errno {}.", temp, errno);
             res = RES_COPY_FAILED;
-            break;
         }
+        if (R_SUCCEEDED(res) && !sink.cancelled() && rename(temp.c_str(), packPath.c_str()) != 0) {
+            Logging::error("Failed to rename {} with errno {}.", temp, errno);
+            res = RES_COPY_FAILED;
+        }
+        if (R_FAILED(res) || sink.cancelled()) {
+            std::remove(temp.c_str());
+        }
+        return res;
+    }
 
-        // Checksum on the way through: the data is already in the buffer and the
-        // CRC32 is a hardware instruction, so this costs the copy nothing and
-        // saves the verification pass a full second read of the backup.
-        if (crcOut != nullptr) {
-            crc = updateCrc(crc, buf, count);
+    // The source side of io::copyFile. A file larger than one buffer is read on a
+    // thread of its own into a ring of BUFFER_SIZE slots, so the SD card reads
+    // the next chunks while the save filesystem writes (and commits) this one;
+    // a smaller file is read inline, where a thread would cost more than the
+    // overlap can win back. Reads never go past `size` bytes, so the source
+    // may be a span of a larger file.
+    class ChunkReader {
+    public:
+        static constexpr size_t DEPTH = 3;
+
+        ChunkReader(FILE* src, u64 size) : mSrc(src), mSize(size), mThreaded(size > BUFFER_SIZE)
+        {
+            mSlots.resize(mThreaded ? DEPTH : 1);
+            for (Slot& slot : mSlots) {
+                slot.data.reset(new u8[BUFFER_SIZE]);
+            }
+            if (mThreaded) {
+                mThread = std::thread([this]() { produce(); });
+            }
         }
 
-        // commit *before* the write that would cross the limit, while the
-        // journal still has room for it
-        if (toSaveDevice && commitWriteLimit > 0 && journalPending + count > commitWriteLimit && journalPending > 0) {
-            if (fclose(dst) != 0) {
-                Logging::error("fclose before mid-file commit failed for {} with errno {}. Aborting copy.", dstPath, errno);
-                dst = NULL;
-                res = RES_COPY_FAILED;
-                break;
+        ~ChunkReader() { stop(); }
+
+        // Hands out the next chunk of the file in `data` and returns its length;
+        // 0 means the read failed, with its errno in readErrno(). The chunk stays
+        // valid until the next call, which is when its slot is given back.
+        size_t next(const u8*& data)
+        {
+            if (!mThreaded) {
+                const size_t count = fread(mSlots[0].data.get(), 1, std::min<u64>(BUFFER_SIZE, mSize - mOffset), mSrc);
+                mErrno             = count == 0 ? errno : 0;
+                data               = mSlots[0].data.get();
+                mOffset += count;
+                return count;
             }
-            res = fsdevCommitDevice("save");
-            if (R_FAILED(res)) {
-                Logging::error("Mid-file commit of {} at offset {}/{} failed with result 0x{:08X}. Aborting copy.", dstPath, offset, sz, (u32)res);
-                dst = NULL;
+            std::unique_lock<std::mutex> lock(mMutex);
+            if (mHolding) {
+                mHead = (mHead + 1) % mSlots.size();
+                mCount--;
+                mHolding = false;
+                mCv.notify_all();
+            }
+            mCv.wait(lock, [this]() { return mCount > 0; });
+            const Slot& slot = mSlots[mHead];
+            mHolding         = true;
+            mErrno           = slot.err;
+            data             = slot.data.get();
+            return slot.len;
+        }
+
+        // Stops the reader thread and waits for it; the source file may be closed
+        // once this returns. Called on every way out of the copy loop, including
+        // a cancel or a failed write with chunks still queued.
+        void stop()
+        {
+            if (!mThread.joinable()) {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStop = true;
+            }
+            mCv.notify_all();
+            mThread.join();
+        }
+
+        int readErrno() const { return mErrno; }
+
+    private:
+        struct Slot {
+            std::unique_ptr<u8[]> data;
+            size_t len = 0;
+            int err    = 0;
+        };
+
+        void produce()
+        {
+            u64 offset  = 0;
+            size_t tail = 0;
+            while (offset < mSize) {
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCv.wait(lock, [this]() { return mStop || mCount < mSlots.size(); });
+                    if (mStop) {
+                        return;
+                    }
+                }
+                // The slot at `tail` is free, so it is this thread's alone
+                // until it is published below.
+                Slot& slot = mSlots[tail];
+                slot.len   = fread(slot.data.get(), 1, std::min<u64>(BUFFER_SIZE, mSize - offset), mSrc);
+                slot.err   = slot.len == 0 ? errno : 0;
+                offset += slot.len;
+                tail = (tail + 1) % mSlots.size();
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+                    mCount++;
+                }
+                mCv.notify_all();
+                if (slot.len == 0) {
+                    return;
+                }
+            }
+        }
+
+        FILE* mSrc;
+        const u64 mSize;
+        const bool mThreaded;
+        std::vector<Slot> mSlots;
+        std::thread mThread;
+        u64 mOffset   = 0; // bytes read so far, inline only
+        size_t mHead  = 0; // oldest filled slot; the consumer's
+        size_t mCount = 0; // filled slots, from mHead on
+        bool mHolding = false;
+        bool mStop    = false;
+        int mErrno    = 0;
+        std::mutex mMutex;
+        std::condition_variable mCv;
+    };
+
+    // The body of io::copyFile, for a source that is already open and positioned
+    // at the `sz` bytes to copy; the caller closes it. `srcLabel` names the
+    // source in the log and, after its last slash, in the progress modal.
+    Result copyOpenFile(FILE* src, u64 sz, const std::string& srcLabel, const std::string& dstPath, ProgressSink& sink, io::CommitBudget* budget,
+        u64* bytesCopied, u32* crcOut)
+    {
+        const bool toSaveDevice = dstPath.rfind("save:/", 0) == 0;
+        // A caller without a budget gets the old behaviour: one commit for this
+        // file at its end, and none partway through.
+        io::CommitBudget ownBudget;
+        io::CommitBudget& journal = budget != nullptr ? *budget : ownBudget;
+        if (toSaveDevice) {
+            const Result cr = chargeEntry(journal, dstPath);
+            if (R_FAILED(cr)) {
+                return cr;
+            }
+        }
+
+        // Create the destination at its final size instead of letting it grow one
+        // write at a time. Every extending write on the save filesystem has to find
+        // and chain a free block, so an append-grown tree of tens of thousands of
+        // files both fragments and gets slower as the save fills.
+        bool preallocated = false;
+        if (toSaveDevice && sz > 0) {
+            const Result cr = fsdevCreateFile(dstPath.c_str(), (size_t)sz, 0);
+            if (R_SUCCEEDED(cr)) {
+                preallocated = true;
+            }
+            else {
+                Logging::debug("Preallocating {} at {} bytes failed with result 0x{:08X}; growing it by writes instead.", dstPath, sz, (u32)cr);
+            }
+        }
+
+        // "wb" truncates, which would throw the preallocation away: an already-sized
+        // file has to be opened for update instead.
+        FILE* dst = fopen(dstPath.c_str(), preallocated ? "r+b" : "wb");
+        if (dst == NULL) {
+            Logging::error("Failed to open destination file {} during copy with errno {}.", dstPath, errno);
+            return RES_COPY_FAILED;
+        }
+
+        ChunkReader reader(src, sz);
+        u64 offset = 0;
+        u32 crc    = 0;
+        Result res = 0;
+
+        size_t slashpos = srcLabel.rfind("/");
+        sink.startFile(srcLabel.substr(slashpos + 1, srcLabel.length() - slashpos - 1), sz);
+
+        while (offset < sz) {
+            if (sink.cancelled()) {
                 break;
             }
-            // A preallocated file is already `sz` long, so appending would write
-            // past the data instead of into it: reopen for update and seek back.
-            dst = fopen(dstPath.c_str(), preallocated ? "r+b" : "ab");
-            if (dst == NULL) {
-                Logging::error("Failed to reopen {} after mid-file commit with errno {}. Aborting copy.", dstPath, errno);
+
+            const u8* buf      = nullptr;
+            const size_t count = reader.next(buf);
+            if (count == 0) {
+                Logging::error(
+                    "fread returned 0 for file {} at offset {}/{} with errno {}. Aborting copy.", srcLabel, offset, sz, reader.readErrno());
                 res = RES_COPY_FAILED;
                 break;
             }
-            if (preallocated && fseek(dst, (long)offset, SEEK_SET) != 0) {
-                Logging::error("Failed to seek {} back to offset {} after mid-file commit with errno {}. Aborting copy.", dstPath, offset, errno);
+
+            // Checksum on the way through: the data is already in the buffer and the
+            // CRC32 is a hardware instruction, so this costs the copy nothing and
+            // saves the verification pass a full second read of the backup.
+            if (crcOut != nullptr) {
+                crc = updateCrc(crc, buf, count);
+            }
+
+            // The save journal only holds `journal.limit` bytes of uncommitted
+            // writes, this file's and those of the files before it in the batch:
+            // commit *before* the write that would cross the limit, while the
+            // journal still has room for it, or the commit would overflow the
+            // journal and fail (#443, #297).
+            if (toSaveDevice && journal.limit > 0 && journal.pending + count > journal.limit && journal.pending > 0) {
+                if (fclose(dst) != 0) {
+                    Logging::error("fclose before mid-file commit failed for {} with errno {}. Aborting copy.", dstPath, errno);
+                    dst = NULL;
+                    res = RES_COPY_FAILED;
+                    break;
+                }
+                res = commitBudget(journal, dstPath);
+                if (R_FAILED(res)) {
+                    Logging::error("Mid-file commit of {} at offset {}/{} failed. Aborting copy.", dstPath, offset, sz);
+                    dst = NULL;
+                    break;
+                }
+                // A preallocated file is already `sz` long, so appending would write
+                // past the data instead of into it: reopen for update and seek back.
+                dst = fopen(dstPath.c_str(), preallocated ? "r+b" : "ab");
+                if (dst == NULL) {
+                    Logging::error("Failed to reopen {} after mid-file commit with errno {}. Aborting copy.", dstPath, errno);
+                    res = RES_COPY_FAILED;
+                    break;
+                }
+                if (preallocated && fseek(dst, (long)offset, SEEK_SET) != 0) {
+                    Logging::error("Failed to seek {} back to offset {} after mid-file commit with errno {}. Aborting copy.", dstPath, offset, errno);
+                    res = RES_COPY_FAILED;
+                    break;
+                }
+                Logging::debug("Mid-file commit of {} at offset {}/{} OK.", dstPath, offset, sz);
+            }
+
+            if (fwrite(buf, 1, count, dst) != count) {
+                Logging::error("fwrite failed for file {} at offset {}/{} with errno {}. Aborting copy.", dstPath, offset, sz, errno);
                 res = RES_COPY_FAILED;
                 break;
             }
-            Logging::debug("Mid-file commit of {} at offset {}/{} OK.", dstPath, offset, sz);
-            journalPending = 0;
+            offset += count;
+            journal.pending += count;
+            sink.advanceBytes(offset);
         }
 
-        if (fwrite((char*)buf, 1, count, dst) != count) {
-            Logging::error("fwrite failed for file {} at offset {}/{} with errno {}. Aborting copy.", dstPath, offset, sz, errno);
+        reader.stop();
+        // stdio buffers, so a write that the save filesystem rejects usually only
+        // surfaces here: never treat a copy as complete without checking the close
+        if (dst != NULL && fclose(dst) != 0 && R_SUCCEEDED(res)) {
+            Logging::error("fclose failed for file {} with errno {}.", dstPath, errno);
             res = RES_COPY_FAILED;
-            break;
         }
-        offset += count;
-        journalPending += count;
-        sink.advanceBytes(offset);
-    }
+        sink.finishFile();
 
-    delete[] buf;
-    fclose(src);
-    // stdio buffers, so a write that the save filesystem rejects usually only
-    // surfaces here: never treat a copy as complete without checking the close
-    if (dst != NULL && fclose(dst) != 0 && R_SUCCEEDED(res)) {
-        Logging::error("fclose failed for file {} with errno {}.", dstPath, errno);
-        res = RES_COPY_FAILED;
-    }
-    sink.finishFile();
+        // A loop that ends early without setting `res` would otherwise hand back a
+        // short file as a successful copy.
+        if (R_SUCCEEDED(res) && offset != sz && !sink.cancelled()) {
+            Logging::error("Copy of {} ended at {} of {} bytes without an error. Treating as failed.", dstPath, offset, sz);
+            res = RES_COPY_FAILED;
+        }
 
-    // A loop that ends early without setting `res` would otherwise hand back a
-    // short file as a successful copy.
-    if (R_SUCCEEDED(res) && offset != sz && !sink.cancelled()) {
-        Logging::error("Copy of {} ended at {} of {} bytes without an error. Treating as failed.", dstPath, offset, sz);
-        res = RES_COPY_FAILED;
+        if (bytesCopied != nullptr) {
+            *bytesCopied = offset;
+        }
+        if (crcOut != nullptr) {
+            *crcOut = crc;
+        }
+
+        // Without a journal limit there is no telling how much a batch can hold, so
+        // each file is committed on its own; with one, the batch is committed by a
+        // later file or by the caller once the copy is done.
+        if (R_SUCCEEDED(res) && toSaveDevice && journal.limit == 0) {
+            res = commitBudget(journal, dstPath);
+        }
+        return res;
     }
+}
 
-    if (bytesCopied != nullptr) {
-        *bytesCopied = offset;
+bool io::fileExists(const std::string& path)
+{
+    struct stat buffer;
+    return (stat(path.c_str(), &buffer) == 0);
+}
+
+io::TreeStats io::scanTree(const std::string& path, ProgressSink* sink)
+{
+    TreeStats total;
+    scanTreeInto(path, total, sink);
+    return total;
+}
+
+io::TreeSnapshot io::snapshotTree(const std::string& path, ProgressSink* sink)
+{
+    TreeSnapshot tree;
+    snapshotInto(path, "", tree, sink);
+    return tree;
+}
+
+size_t io::compareSnapshots(const TreeSnapshot& expected, const TreeSnapshot& actual)
+{
+    static constexpr size_t MAX_LOGGED = 10;
+
+    const std::vector<size_t> want = sortedByPath(expected);
+    const std::vector<size_t> have = sortedByPath(actual);
+    size_t differences             = 0;
+    auto report                    = [&differences](const std::string& what, const std::string& path) {
+        if (differences++ < MAX_LOGGED) {
+            Logging::error("Tree check: {} {}.", what, path);
+        }
+    };
+
+    size_t i = 0, j = 0;
+    while (i < want.size() || j < have.size()) {
+        const int order = i == want.size()   ? 1
+                          : j == have.size() ? -1
+                                             : expected.relPath(want[i]).compare(actual.relPath(have[j]));
+        if (order < 0) {
+            report("missing", expected.relPath(want[i++]));
+        }
+        else if (order > 0) {
+            report("unexpected", actual.relPath(have[j++]));
+        }
+        else {
+            const TreeSnapshot::Node& a = expected.nodes[want[i]];
+            const TreeSnapshot::Node& b = actual.nodes[have[j]];
+            if (a.folder != b.folder) {
+                report(a.folder ? "file in place of folder" : "folder in place of file", expected.relPath(want[i]));
+            }
+            else if (a.size != b.size) {
+                report(StringUtils::format("size %llu instead of %llu on", (unsigned long long)b.size, (unsigned long long)a.size),
+                    expected.relPath(want[i]));
+            }
+            i++;
+            j++;
+        }
     }
-    if (crcOut != nullptr) {
-        *crcOut = crc;
+    if (differences > MAX_LOGGED) {
+        Logging::error("Tree check: {} more differences not listed.", differences - MAX_LOGGED);
     }
+    return differences;
+}
 
-    // commit each file to the save, so a huge restore doesn't accumulate one
-    // giant uncommitted journal
-    if (R_SUCCEEDED(res) && toSaveDevice) {
-        res = fsdevCommitDevice("save");
-        if (R_FAILED(res)) {
-            Logging::error("Failed to commit file {} to the save archive with result 0x{:08X}.", dstPath, (u32)res);
+io::RestorePlan io::planRestore(
+    const TreeSnapshot& backup, const std::string& srcRoot, const TreeSnapshot& save, const std::string& dstRoot, ProgressSink& sink)
+{
+    RestorePlan plan;
+    plan.unchanged.assign(backup.nodes.size(), false);
+
+    const std::vector<size_t> want = sortedByPath(backup);
+    const std::vector<size_t> have = sortedByPath(save);
+    std::vector<u8> buf(BUFFER_SIZE);
+    size_t i = 0, j = 0;
+    while (i < want.size() || j < have.size()) {
+        const int order = i == want.size()   ? 1
+                          : j == have.size() ? -1
+                                             : backup.relPath(want[i]).compare(save.relPath(have[j]));
+        if (order < 0) {
+            // only in the backup: the copy creates it
+            i++;
+            continue;
+        }
+        if (order > 0) {
+            plan.stale.push_back(have[j++]);
+            continue;
+        }
+
+        const size_t b              = want[i++];
+        const size_t s              = have[j++];
+        const TreeSnapshot::Node& a = backup.nodes[b];
+        if (a.folder != save.nodes[s].folder) {
+            plan.stale.push_back(s);
+            continue;
+        }
+        if (a.folder) {
+            plan.unchanged[b] = true;
+            plan.unchangedStats.dirs++;
+            continue;
+        }
+        if (a.size != save.nodes[s].size) {
+            plan.stale.push_back(s);
+            continue;
+        }
+
+        // Same path, same size: only the contents can tell. A file that cannot
+        // be read on either side is treated as changed and rewritten.
+        const std::string rel = backup.relPath(b);
+        sink.startFile(rel.substr(rel.rfind('/') + 1), a.size);
+        u64 srcSize = 0, dstSize = 0;
+        u32 srcCrc = 0, dstCrc = 0;
+        const FileSpan span  = !backup.pack.empty() ? backup.span(b) : FileSpan{};
+        const FileSpan* part = !backup.pack.empty() ? &span : nullptr;
+        const bool same      = fileSizeAndCrc(backup.sourcePath(b, srcRoot), buf.data(), srcSize, srcCrc, &sink, nullptr, part) == ReadOutcome::Ok &&
+                               fileSizeAndCrc(dstRoot + rel, buf.data(), dstSize, dstCrc) == ReadOutcome::Ok && srcSize == dstSize &&
+                               srcCrc == dstCrc;
+        sink.finishFile();
+        if (!same) {
+            plan.stale.push_back(s);
+            continue;
         }
+        plan.unchanged[b] = true;
+        plan.unchangedStats.files++;
+        plan.unchangedStats.bytes += a.size;
+        plan.unchangedFiles.push_back(CopiedFile{dstRoot + rel, a.size, srcCrc});
     }
-    return res;
+
+    // deleteSnapshot wants them in listing order, contents after their folder.
+    std::sort(plan.stale.begin(), plan.stale.end());
+    return plan;
 }
 
-Result io::copyDirectory(const std::string& srcPath, const std::string& dstPath, ProgressSink& sink, u64 commitWriteLimit, TreeStats* copied,
-    std::vector<CopiedFile>* digests)
+Result io::copyFile(const std::string& srcPath, const std::string& dstPath, ProgressSink& sink, CommitBudget* budget, u64* bytesCopied, u32* crcOut)
 {
-    Result res = 0;
-    Directory items(srcPath);
+    FILE* src = fopen(srcPath.c_str(), "rb");
+    if (src == NULL) {
+        Logging::error("Failed to open source file {} during copy with errno {}.", srcPath, errno);
+        return RES_COPY_FAILED;
+    }
+    fseek(src, 0, SEEK_END);
+    u64 sz = ftell(src);
+    rewind(src);
 
-    if (!items.good()) {
-        Logging::error("Copy: failed to list source directory {} with error 0x{:08X}. Aborting copy.", srcPath, (u32)items.error());
-        return items.error();
+    const Result res = copyOpenFile(src, sz, srcPath, dstPath, sink, budget, bytesCopied, crcOut);
+    fclose(src);
+    return res;
+}
+
+Result io::copySnapshot(const TreeSnapshot& tree, const std::string& srcRoot, const std::string& dstRoot, ProgressSink& sink,
+    u64 commitWriteLimit, TreeStats* copied, std::vector<CopiedFile>* digests, const std::vector<bool>* skip)
+{
+    const bool toSaveDevice = dstRoot.rfind("save:/", 0) == 0;
+    CommitBudget budget;
+    budget.limit = commitWriteLimit;
+
+    // A packed tree is one file read front to back: it is opened once, behind a
+    // buffer large enough that a run of small files costs a handful of reads.
+    FILE* pack = NULL;
+    std::unique_ptr<char[]> packBuffer;
+    u64 packAt = 0;
+    if (!tree.pack.empty()) {
+        pack = fopen(tree.pack.c_str(), "rb");
+        if (pack == NULL) {
+            Logging::error("Failed to open pack {} during copy with errno {}.", tree.pack, errno);
+            return RES_COPY_FAILED;
+        }
+        packBuffer.reset(new char[BUFFER_SIZE]);
+        setvbuf(pack, packBuffer.get(), _IOFBF, BUFFER_SIZE);
     }
 
-    for (size_t i = 0, sz = items.size(); i < sz && R_SUCCEEDED(res); i++) {
+    Result res = 0;
+    for (size_t i = 0, sz = tree.nodes.size(); i < sz && R_SUCCEEDED(res); i++) {
         if (sink.cancelled()) {
             break;
         }
+        if (skip != nullptr && (*skip)[i]) {
+            continue;
+        }
 
-        std::string newsrc = srcPath + items.entry(i);
-        std::string newdst = dstPath + items.entry(i);
+        const std::string rel    = tree.relPath(i);
+        const std::string newsrc = tree.sourcePath(i, srcRoot);
+        const std::string newdst = dstRoot + rel;
 
-        if (items.folder(i)) {
-            res = io::createDirectory(newdst);
-            if (R_SUCCEEDED(res)) {
-                if (copied != nullptr) {
-                    copied->dirs++;
+        if (tree.nodes[i].folder) {
+            if (toSaveDevice) {
+                res = chargeEntry(budget, newdst);
+                if (R_FAILED(res)) {
+                    break;
                 }
-                newsrc += "/";
-                newdst += "/";
-                res = io::copyDirectory(newsrc, newdst, sink, commitWriteLimit, copied, digests);
+            }
+            res = io::createDirectory(newdst);
+            if (copied != nullptr && R_SUCCEEDED(res)) {
+                copied->dirs++;
             }
         }
         else {
             u64 bytes = 0;
             u32 crc   = 0;
-            res       = io::copyFile(newsrc, newdst, sink, commitWriteLimit, &bytes, digests != nullptr ? &crc : nullptr);
+            if (pack != NULL) {
+                // Members follow each other, so only a skipped file costs a seek.
+                const FileSpan span = tree.span(i);
+                if (packAt != span.offset && fseek(pack, (long)span.offset, SEEK_SET) != 0) {
+                    Logging::error("Failed to seek pack {} to offset {} with errno {}.", tree.pack, span.offset, errno);
+                    res = RES_COPY_FAILED;
+                    break;
+                }
+                res    = copyOpenFile(pack, span.length, srcRoot + rel, newdst, sink, &budget, &bytes, digests != nullptr ? &crc : nullptr);
+                packAt = span.offset + bytes;
+            }
+            else {
+                res = io::copyFile(newsrc, newdst, sink, &budget, &bytes, digests != nullptr ? &crc : nullptr);
+            }
             if (digests != nullptr && R_SUCCEEDED(res)) {
                 digests->push_back(CopiedFile{newdst, bytes, crc});
             }
@@ -418,6 +1199,15 @@ Result io::copyDirectory(const std::string& srcPath, const std::string& dstPath,
         }
     }
 
+    if (pack != NULL) {
+        fclose(pack);
+    }
+
+    // What the last batch left uncommitted. A cancelled copy commits it too:
+    // the caller wipes or reports the partial save either way.
+    if (R_SUCCEEDED(res) && toSaveDevice) {
+        res = commitBudget(budget, dstRoot);
+    }
     return res;
 }
 
@@ -440,7 +1230,7 @@ Result io::deleteFolderRecursively(const std::string& path, bool removeRoot, Pro
 {
     Directory dir(path);
     if (!dir.good()) {
-        Logging::error("Delete: failed to list directory {} with errno {}.", path, (u32)dir.error());
+        Logging::error("Delete: failed to list directory {} with error 0x{:08X}.", path, (u32)dir.error());
         return dir.error();
     }
 
@@ -487,17 +1277,80 @@ Result io::deleteFolderRecursively(const std::string& path, bool removeRoot, Pro
     return firstError;
 }
 
-io::IoOutcome io::backup(Title& title, const std::string& dstPath, ProgressSink& sink)
+Result io::deleteSnapshot(const TreeSnapshot& tree, const std::string& root, ProgressSink* sink, const std::vector<size_t>* only)
+{
+    Result firstError = 0;
+    // Walking the pre-order listing backwards reaches every entry before the
+    // folder that holds it, so each rmdir finds its folder already empty.
+    const size_t count = only != nullptr ? only->size() : tree.nodes.size();
+    for (size_t k = count; k-- > 0;) {
+        const size_t i           = only != nullptr ? (*only)[k] : k;
+        const std::string rel    = tree.relPath(i);
+        const std::string target = root + rel;
+        const int rc             = tree.nodes[i].folder ? rmdir(target.c_str()) : std::remove(target.c_str());
+        // As in deleteFolderRecursively, an entry already gone is not a failure.
+        if (rc != 0 && errno != ENOENT) {
+            Logging::error("Delete: failed to delete {} with errno {}.", target, errno);
+            if (firstError == 0) {
+                firstError = errno ? errno : -1;
+            }
+        }
+        if (sink != nullptr && !tree.nodes[i].folder) {
+            sink->startFile(rel.substr(rel.rfind('/') + 1), 0);
+            sink->finishFile();
+        }
+    }
+    return firstError;
+}
+
+io::IoOutcome io::backup(Title& title, const std::string& dstPath, ProgressSink& sink, bool skipIfUnchanged)
 {
     Logging::info("Started backup of {}. Title id: 0x{:016X}; User id: 0x{:X}{:X}.", title.name().c_str(), title.id(), title.userId().uid[1],
         title.userId().uid[0]);
 
+    Manifest::SaveStamp stamp;
+    const bool hasStamp = readSaveStamp(title, stamp);
+
     Result res = SaveDataSource(title.saveDataType()).mount(title);
     if (R_FAILED(res)) {
         Logging::error("Failed to mount filesystem during backup with result 0x{:08X}. Title id: 0x{:016X}.", res, title.id());
         return {false, res, io::BackupStage::OpenArchive};
     }
 
+    const io::TreeSnapshot saveTree = io::snapshotTree("save:/");
+    if (saveTree.stats.unreadable > 0) {
+        FileSystem::unmountDevice();
+        Logging::error("Refusing to back up: {} entries under save:/ could not be read, so the backup would be silently incomplete.",
+            saveTree.stats.unreadable);
+        return {false, RES_COPY_FAILED, io::BackupStage::Copy};
+    }
+
+    // A new backup of a save that has not changed since the newest one would
+    // only duplicate it. Overwriting a chosen folder always copies: the caller
+    // asked for that folder's contents to be replaced.
+    if (skipIfUnchanged && !io::directoryExists(dstPath)) {
+        time_t written           = 0;
+        const std::string newest = newestManifestedBackup(title, written);
+        Manifest::Contents manifest;
+        if (!newest.empty() && Manifest::read(newest, manifest) && backupMatchesManifest(manifest, newest, written)) {
+            // An unchanged commit id settles it without reading the save; the
+            // listing is still compared, as it costs next to nothing.
+            const bool sameCommit =
+                hasStamp && manifest.hasStamp && manifest.stamp.commitId == stamp.commitId && manifest.stamp.timestamp == stamp.timestamp;
+            if (saveMatchesManifest(saveTree, manifest, !sameCommit, sink)) {
+                FileSystem::unmountDevice();
+                const std::string name = newest.substr(newest.rfind('/') + 1);
+                Logging::info(
+                    "Save unchanged since backup {} ({}); not creating {}.", name, sameCommit ? "same commit id" : "same contents", dstPath);
+                return {true, 0, io::BackupStage::Copy, false, name};
+            }
+        }
+    }
+
+    // Whatever happens next, the manifest of a backup being replaced no longer
+    // describes the folder; a new one is written once the copy is complete. The
+    // objects a stored one leaves behind are swept by TransferJob after the batch.
+    Manifest::discard(dstPath);
     if (io::directoryExists(dstPath)) {
         int rc = io::deleteFolderRecursively((dstPath + "/").c_str());
         if (rc != 0) {
@@ -513,17 +1366,30 @@ io::IoOutcome io::backup(Title& title, const std::string& dstPath, ProgressSink&
         Logging::error("Failed to create directory {} with result 0x{:08X}.", dstPath, (u32)res);
         return {false, res, io::BackupStage::CreateDst};
     }
-    const io::TreeStats saveTree = io::scanTree("save:/");
-    if (saveTree.unreadable > 0) {
-        FileSystem::unmountDevice();
-        Logging::error(
-            "Refusing to back up: {} entries under save:/ could not be read, so the backup would be silently incomplete.", saveTree.unreadable);
-        return {false, RES_COPY_FAILED, io::BackupStage::Copy};
-    }
 
+    // A backup in the object store leaves its folder empty and is only as good
+    // as its manifest, so it is written only where collectGarbage() will find
+    // that manifest.
+    const bool toStore = Configuration::getInstance().isDedupeBackupsEnabled() && ObjectStore::covers(dstPath);
+    // Likewise a packed backup, whose folder stays empty next to its pack.
+    const bool toPack = !toStore && Configuration::getInstance().isPackBackupsEnabled();
+    const Manifest::Layout layout = toStore ? Manifest::Layout::Stored : toPack ? Manifest::Layout::Packed : Manifest::Layout::Folder;
+
+    // The CRC32 of each file comes free with the copy; kept for the manifest.
     io::TreeStats copiedTree;
-    sink.begin("Backup", saveTree.files);
-    res = io::copyDirectory("save:/", dstPath + "/", sink, 0, &copiedTree);
+    std::vector<io::CopiedFile> digests;
+    std::vector<ObjectStore::Digest> hashes;
+    digests.reserve(saveTree.stats.files);
+    sink.begin("Backup", saveTree.stats.files);
+    if (toStore) {
+        res = storeSnapshot(saveTree, "save:/", sink, copiedTree, digests, hashes);
+    }
+    else if (toPack) {
+        res = packSnapshot(saveTree, "save:/", Manifest::packPathFor(dstPath), sink, copiedTree, digests);
+    }
+    else {
+        res = io::copySnapshot(saveTree, "save:/", dstPath + "/", sink, 0, &copiedTree, &digests);
+    }
     sink.end();
     if (sink.cancelled()) {
         FileSystem::unmountDevice();
@@ -538,14 +1404,25 @@ io::IoOutcome io::backup(Title& title, const std::string& dstPath, ProgressSink&
         return {false, res, io::BackupStage::Copy};
     }
 
-    // A copy that reported success but moved less than the scan found means the
-    // walk lost part of the tree without any single operation failing; the
-    // backup on the SD card would look fine and restore to a broken save.
-    if (copiedTree.files != saveTree.files || copiedTree.bytes != saveTree.bytes) {
+    // A copy that reported success but moved less than the snapshot holds means
+    // files changed size or vanished under it without any single operation
+    // failing; the backup on the SD card would look fine and restore to a broken
+    // save.
+    if (copiedTree.files != saveTree.stats.files || copiedTree.bytes != saveTree.stats.bytes) {
         FileSystem::unmountDevice();
+        Manifest::discard(dstPath);
         io::deleteFolderRecursively((dstPath + "/").c_str());
         Logging::error("Backup incomplete: copied {} files / {} bytes but the save holds {} files / {} bytes. Discarding the backup.",
-            copiedTree.files, copiedTree.bytes, saveTree.files, saveTree.bytes);
+            copiedTree.files, copiedTree.bytes, saveTree.stats.files, saveTree.stats.bytes);
+        return {false, RES_COPY_FAILED, io::BackupStage::Copy};
+    }
+
+    if (!writeManifest(saveTree, digests, dstPath, hasStamp ? &stamp : nullptr, layout, toStore ? &hashes : nullptr) &&
+        layout != Manifest::Layout::Folder) {
+        FileSystem::unmountDevice();
+        Manifest::discard(dstPath);
+        io::deleteFolderRecursively((dstPath + "/").c_str());
+        Logging::error("Backup of {} has no manifest, without which its files cannot be found. Discarding the backup.", dstPath);
         return {false, RES_COPY_FAILED, io::BackupStage::Copy};
     }
 
@@ -554,7 +1431,7 @@ io::IoOutcome io::backup(Title& title, const std::string& dstPath, ProgressSink&
     // mutex, so the worker must not mutate it while the UI thread reads it.
     FileSystem::unmountDevice();
     Logging::info("Backup succeeded.");
-    return {true, 0, io::BackupStage::Copy};
+    return {true, 0, io::BackupStage::Copy, false, {}, copiedTree.bytes};
 }
 
 io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink& sink)
@@ -581,10 +1458,19 @@ io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink
             (u32)res, title.id());
     }
 
+    // The one walk of the backup: sizing, the copy and every check after it
+    // work off this snapshot. A stored backup is its manifest, read straight
+    // out of the object store; a packed one its manifest over its pack.
+    Manifest::Contents manifest;
+    const bool hasManifest = Manifest::read(srcPath, manifest);
     Logging::info("Scanning backup {} (this can take minutes for backups with many files)...", srcPath);
-    const io::TreeStats backupTree = io::scanTree(srcPath);
-    const size_t fileCount         = backupTree.files;
-    const u64 backupSize           = backupTree.bytes;
+    const Manifest::Layout layout         = hasManifest ? manifest.layout : Manifest::Layout::Folder;
+    const io::TreeSnapshot backupSnapshot = layout == Manifest::Layout::Stored   ? ObjectStore::snapshot(manifest)
+                                            : layout == Manifest::Layout::Packed ? packedSnapshot(manifest, srcPath)
+                                                                                 : io::snapshotTree(srcPath);
+    const io::TreeStats& backupTree       = backupSnapshot.stats;
+    const size_t fileCount                = backupTree.files;
+    const u64 backupSize                  = backupTree.bytes;
     Logging::info("Backup to restore: {} files, {} dirs, {} bytes total.", fileCount, backupTree.dirs, backupSize);
 
     // Restoring a tree we could not fully read would wipe the save and put back
@@ -646,8 +1532,37 @@ io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink
 
     std::string dstPath = "save:/";
 
-    sink.begin("Clearing", io::countFiles(dstPath));
-    res = io::deleteFolderRecursively(dstPath.c_str(), false, &sink);
+    // One listing of the save serves as both the wipe's progress total and its
+    // plan. If part of it could not be read, the recursive delete lists again
+    // and surfaces the error itself.
+    const io::TreeSnapshot oldSave = io::snapshotTree(dstPath);
+
+    // A differential restore compares first and then deletes only what is
+    // stale; it needs the whole save listed to know what that is, and falls
+    // back to a full wipe when it is not.
+    const bool differential = Configuration::getInstance().isDifferentialRestoreEnabled() && oldSave.stats.unreadable == 0;
+    io::RestorePlan plan;
+    if (differential) {
+        const auto compareStart = std::chrono::steady_clock::now();
+        sink.begin("Comparing", std::min(oldSave.stats.files, fileCount));
+        plan = io::planRestore(backupSnapshot, srcPath, oldSave, dstPath, sink);
+        sink.end();
+        const auto compareSeconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - compareStart).count();
+        Logging::info("Differential restore: {} of {} files already match ({} s to compare); {} entries of the save to remove.",
+            plan.unchangedStats.files, fileCount, compareSeconds, plan.stale.size());
+
+        size_t staleFiles = 0;
+        for (size_t i : plan.stale) {
+            staleFiles += oldSave.nodes[i].folder ? 0 : 1;
+        }
+        sink.begin("Clearing", staleFiles);
+        res = io::deleteSnapshot(oldSave, dstPath, &sink, &plan.stale);
+    }
+    else {
+        sink.begin("Clearing", oldSave.stats.files);
+        res = oldSave.stats.unreadable == 0 ? io::deleteSnapshot(oldSave, dstPath, &sink)
+                                            : io::deleteFolderRecursively(dstPath.c_str(), false, &sink);
+    }
     sink.end();
     if (R_FAILED(res)) {
         FileSystem::unmountDevice();
@@ -666,8 +1581,10 @@ io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink
 
     // A wipe that left entries behind means the restore starts on top of the old
     // save: files the backup does not contain survive, and the free space the
-    // copy is about to need is already spent.
-    const io::TreeStats leftovers = io::scanTree(dstPath);
+    // copy is about to need is already spent. This has to look at the save
+    // again; on a clean wipe it is a single empty listing. A differential
+    // restore keeps entries on purpose; the checks after the copy cover it.
+    const io::TreeStats leftovers = differential ? io::TreeStats{} : io::scanTree(dstPath);
     if (leftovers.files > 0 || leftovers.dirs > 0 || leftovers.unreadable > 0) {
         FileSystem::unmountDevice();
         Logging::error("Wipe left {} files, {} dirs and {} unreadable entries under save:/. Aborting before the copy.", leftovers.files,
@@ -681,17 +1598,26 @@ io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink
     Logging::info("Copy starting with commitWriteLimit={} (journal size {}).", commitWriteLimit, journalSize);
 
     // With byte-for-byte verification on, the copy hands back a CRC32 per file so
-    // the check that follows only has to read the save.
+    // the check that follows only has to read the save. A backup that has a
+    // manifest gets the same digests checked against it.
     const bool verifyBytes = Configuration::getInstance().isVerifyRestoreEnabled();
+    const bool keepDigests = verifyBytes || hasManifest;
     std::vector<io::CopiedFile> copiedFiles;
-    if (verifyBytes) {
+    if (keepDigests) {
         copiedFiles.reserve(fileCount);
     }
 
-    io::TreeStats copiedTree;
+    // The files a differential restore left in place count as copied: the
+    // comparison proved them identical to the backup, and the checks below
+    // look at them like any other.
+    io::TreeStats copiedTree = plan.unchangedStats;
+    if (keepDigests) {
+        copiedFiles.insert(copiedFiles.end(), plan.unchangedFiles.begin(), plan.unchangedFiles.end());
+    }
     const auto copyStart = std::chrono::steady_clock::now();
-    sink.begin("Restore", fileCount);
-    res = io::copyDirectory(srcPath, dstPath, sink, commitWriteLimit, &copiedTree, verifyBytes ? &copiedFiles : nullptr);
+    sink.begin("Restore", fileCount - plan.unchangedStats.files);
+    res = io::copySnapshot(backupSnapshot, srcPath, dstPath, sink, commitWriteLimit, &copiedTree, keepDigests ? &copiedFiles : nullptr,
+        differential ? &plan.unchanged : nullptr);
     sink.end();
     const auto copySeconds = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - copyStart).count();
     if (R_FAILED(res)) {
@@ -700,10 +1626,13 @@ io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink
         return {false, res, io::BackupStage::Copy};
     }
     Logging::info("Copy phase finished in {} s.", copySeconds);
+    if (hasManifest) {
+        crossCheckManifest(manifest, copiedFiles, dstPath);
+    }
 
     // The cheap structural guarantee, always on: whatever the CRC verification
     // setting says, a restore never reports success after moving fewer files or
-    // fewer bytes than the pre-flight scan of the backup found.
+    // fewer bytes than the snapshot of the backup holds.
     if (copiedTree.files != backupTree.files || copiedTree.dirs != backupTree.dirs || copiedTree.bytes != backupTree.bytes) {
         FileSystem::unmountDevice();
         Logging::error("Restore incomplete: copied {} files / {} dirs / {} bytes but the backup holds {} files / {} dirs / {} bytes.",
@@ -728,17 +1657,18 @@ io::IoOutcome io::restore(Title& title, const std::string& srcPath, ProgressSink
         return {true, 0, io::BackupStage::Copy};
     }
 
-    // Structural check: re-walk the committed save and compare its shape against
-    // the backup. One directory walk, no file reads — it catches a save that lost
-    // entries between the writes and the commit. Redundant when the byte-for-byte
-    // pass below runs, since that one opens every file the copy wrote.
+    // Structural check: re-walk the committed save and compare it path by path
+    // against the backup's snapshot. One directory walk, no file reads — it
+    // catches a save that lost, gained or resized entries between the writes and
+    // the commit. Redundant when the byte-for-byte pass below runs, since that
+    // one opens every file the copy wrote.
     if (!verifyBytes) {
         sink.begin("Verify", fileCount);
-        const io::TreeStats restoredTree = io::scanTree(dstPath, &sink);
+        const io::TreeSnapshot restored = io::snapshotTree(dstPath, &sink);
         sink.end();
         FileSystem::unmountDevice();
-        if (restoredTree.files != backupTree.files || restoredTree.dirs != backupTree.dirs || restoredTree.bytes != backupTree.bytes ||
-            restoredTree.unreadable > 0) {
+        const io::TreeStats& restoredTree = restored.stats;
+        if (restoredTree.unreadable > 0 || io::compareSnapshots(backupSnapshot, restored) > 0) {
             Logging::error(
                 "Restore check FAILED: save holds {} files / {} dirs / {} bytes ({} unreadable), backup holds {} files / {} dirs / {} bytes.",
                 restoredTree.files, restoredTree.dirs, restoredTree.bytes, restoredTree.unreadable, backupTree.files, backupTree.dirs,
@@ -0,0 +1,270 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "manifest.hpp"
+#include "logging.hpp"
+#include "transferprotocol.hpp"
+#include <cstdio>
+#include <cstring>
+
+namespace {
+    constexpr char MAGIC[4]        = {'C', 'P', 'M', 'F'};
+    constexpr u16 VERSION          = 1;
+    constexpr u16 FLAG_SHA256      = 1 << 0;
+    constexpr u16 FLAG_STAMP       = 1 << 1;
+    constexpr u16 FLAG_STORED      = 1 << 2;
+    constexpr u16 FLAG_PACKED      = 1 << 3;
+    constexpr size_t HEADER_SIZE   = 28;
+    constexpr u32 MAX_ENTRIES      = 1 << 22; // far past any save; bounds a corrupt header
+    constexpr size_t MAX_PATH_SIZE = 0x301;
+
+    struct Header {
+        u16 flags;
+        u32 entries;
+        u32 files;
+        u64 bytes;
+        u32 crc;
+    };
+
+    template <typename T>
+    void put(std::string& out, T value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool take(const std::string& in, size_t& pos, T& value)
+    {
+        if (in.size() - pos < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, in.data() + pos, sizeof(value));
+        pos += sizeof(value);
+        return true;
+    }
+
+    bool readHeader(FILE* f, Header& out)
+    {
+        std::string raw(HEADER_SIZE, '\0');
+        if (fread(raw.data(), 1, HEADER_SIZE, f) != HEADER_SIZE || memcmp(raw.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            return false;
+        }
+        size_t pos  = sizeof(MAGIC);
+        u16 version = 0;
+        return take(raw, pos, version) && version == VERSION && take(raw, pos, out.flags) && take(raw, pos, out.entries) &&
+               take(raw, pos, out.files) && take(raw, pos, out.bytes) && take(raw, pos, out.crc) && out.entries <= MAX_ENTRIES;
+    }
+
+    Manifest::Layout layoutOf(const Header& header)
+    {
+        if (header.flags & FLAG_STORED) {
+            return Manifest::Layout::Stored;
+        }
+        return header.flags & FLAG_PACKED ? Manifest::Layout::Packed : Manifest::Layout::Folder;
+    }
+
+    std::string stripSlash(const std::string& path)
+    {
+        return !path.empty() && path.back() == '/' ? path.substr(0, path.size() - 1) : path;
+    }
+}
+
+std::string Manifest::pathFor(const std::string& backupPath)
+{
+    return stripSlash(backupPath) + ".manifest";
+}
+
+std::string Manifest::packPathFor(const std::string& backupPath)
+{
+    return stripSlash(backupPath) + ".pack";
+}
+
+bool Manifest::isPack(const std::string& path)
+{
+    static const std::string suffix = ".pack";
+    return path.size() > suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+bool Manifest::write(const std::string& backupPath, const std::vector<Entry>& entries, const SaveStamp* stamp, Layout layout)
+{
+    const bool stored = layout == Layout::Stored;
+    std::string body;
+    if (stamp != nullptr) {
+        put<u64>(body, stamp->commitId);
+        put<u64>(body, stamp->timestamp);
+    }
+    u32 files = 0;
+    u64 bytes = 0;
+    for (const Entry& entry : entries) {
+        put<u8>(body, entry.folder ? 1 : 0);
+        put<u16>(body, (u16)entry.relPath.size());
+        body += entry.relPath;
+        if (!entry.folder) {
+            put<u64>(body, entry.size);
+            put<u32>(body, entry.crc);
+            if (stored) {
+                body.append(reinterpret_cast<const char*>(entry.sha256.data()), entry.sha256.size());
+            }
+            files++;
+            bytes += entry.size;
+        }
+    }
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    put<u16>(header, VERSION);
+    put<u16>(header, (stamp != nullptr ? FLAG_STAMP : 0) | (stored ? FLAG_SHA256 | FLAG_STORED : 0) | (layout == Layout::Packed ? FLAG_PACKED : 0));
+    put<u32>(header, (u32)entries.size());
+    put<u32>(header, files);
+    put<u64>(header, bytes);
+    put<u32>(header, TransferProto::updateCrc(0, reinterpret_cast<const uint8_t*>(body.data()), body.size()));
+
+    // Written aside and renamed over, so a crash mid-write never leaves a
+    // truncated manifest that claims to describe the backup.
+    const std::string path = pathFor(backupPath);
+    const std::string temp = path + ".tmp";
+    FILE* f                = fopen(temp.c_str(), "wb");
+    if (f == NULL) {
+        Logging::error("Manifest: failed to create {} with errno {}.", temp, errno);
+        return false;
+    }
+    bool ok = fwrite(header.data(), 1, header.size(), f) == header.size() && fwrite(body.data(), 1, body.size(), f) == body.size();
+    ok      = fclose(f) == 0 && ok;
+    std::remove(path.c_str());
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        Logging::error("Manifest: failed to write {} with errno {}.", path, errno);
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Manifest::read(const std::string& backupPath, Contents& out)
+{
+    const std::string path = pathFor(backupPath);
+    FILE* f                = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        return false;
+    }
+    Header header;
+    std::string body;
+    bool ok = readHeader(f, header);
+    if (ok) {
+        char buf[0x4000];
+        size_t count;
+        while ((count = fread(buf, 1, sizeof(buf), f)) > 0) {
+            body.append(buf, count);
+        }
+        ok = ferror(f) == 0;
+    }
+    fclose(f);
+    if (!ok || TransferProto::updateCrc(0, reinterpret_cast<const uint8_t*>(body.data()), body.size()) != header.crc) {
+        Logging::warning("Manifest: {} is unreadable or corrupt; ignoring it.", path);
+        return false;
+    }
+
+    Contents contents;
+    contents.layout = layoutOf(header);
+    contents.entries.reserve(header.entries);
+    size_t pos = 0;
+    if (header.flags & FLAG_STAMP) {
+        contents.hasStamp = take(body, pos, contents.stamp.commitId) && take(body, pos, contents.stamp.timestamp);
+        ok                = contents.hasStamp;
+    }
+    for (u32 i = 0; ok && i < header.entries; i++) {
+        Entry entry;
+        u8 kind = 0;
+        u16 len = 0;
+        if (!take(body, pos, kind) || !take(body, pos, len) || len > MAX_PATH_SIZE || body.size() - pos < len) {
+            ok = false;
+            break;
+        }
+        entry.relPath = body.substr(pos, len);
+        entry.folder  = kind == 1;
+        pos += len;
+        if (!entry.folder) {
+            if (!take(body, pos, entry.size) || !take(body, pos, entry.crc)) {
+                ok = false;
+                break;
+            }
+            if ((header.flags & FLAG_SHA256) && !take(body, pos, entry.sha256)) {
+                ok = false;
+                break;
+            }
+            contents.files++;
+            contents.totalBytes += entry.size;
+        }
+        contents.entries.push_back(std::move(entry));
+    }
+    if (!ok || pos != body.size() || contents.files != header.files || contents.totalBytes != header.bytes) {
+        Logging::warning("Manifest: {} does not match its own header; ignoring it.", path);
+        return false;
+    }
+    out = std::move(contents);
+    return true;
+}
+
+bool Manifest::readTotals(const std::string& backupPath, size_t& outFiles, u64& outBytes)
+{
+    FILE* f = fopen(pathFor(backupPath).c_str(), "rb");
+    if (f == NULL) {
+        return false;
+    }
+    Header header;
+    const bool ok = readHeader(f, header);
+    fclose(f);
+    if (ok) {
+        outFiles = header.files;
+        outBytes = header.bytes;
+    }
+    return ok;
+}
+
+Manifest::Layout Manifest::layout(const std::string& backupPath)
+{
+    Layout layout;
+    return readLayout(backupPath, layout) ? layout : Layout::Folder;
+}
+
+bool Manifest::readLayout(const std::string& backupPath, Layout& out)
+{
+    FILE* f = fopen(pathFor(backupPath).c_str(), "rb");
+    if (f == NULL) {
+        return false;
+    }
+    Header header;
+    const bool ok = readHeader(f, header);
+    fclose(f);
+    if (ok) {
+        out = layoutOf(header);
+    }
+    return ok;
+}
+
+void Manifest::discard(const std::string& backupPath)
+{
+    std::remove(pathFor(backupPath).c_str());
+    std::remove(packPathFor(backupPath).c_str());
+}
@@ -0,0 +1,219 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "objectstore.hpp"
+#include "directory.hpp"
+#include "logging.hpp"
+#include "paths.hpp"
+#include "savedatasource.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unordered_set>
+
+namespace {
+    constexpr const char* OBJECTS_DIR = "/objects/";
+    constexpr const char* TEMP_SUFFIX = ".tmp";
+
+    // Every backup root a title folder (and so a stored backup) can sit in.
+    std::vector<std::string> backupRoots(void)
+    {
+        return {SaveDataSource(FsSaveDataType_Account).baseDir(), SaveDataSource(FsSaveDataType_Bcat).baseDir(),
+            SaveDataSource(FsSaveDataType_Device).baseDir(), SaveDataSource(FsSaveDataType_System).baseDir()};
+    }
+
+    std::string hex(const ObjectStore::Digest& digest)
+    {
+        static constexpr char DIGITS[] = "0123456789abcdef";
+        std::string out;
+        out.reserve(digest.size() * 2);
+        for (u8 byte : digest) {
+            out += DIGITS[byte >> 4];
+            out += DIGITS[byte & 0xF];
+        }
+        return out;
+    }
+
+    bool endsWith(const std::string& s, const std::string& suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+}
+
+std::string ObjectStore::root(void)
+{
+    return std::string(Paths::checkpointRoot()) + OBJECTS_DIR;
+}
+
+std::string ObjectStore::objectPath(const Digest& digest)
+{
+    const std::string name = hex(digest);
+    return root() + name.substr(0, 2) + "/" + name;
+}
+
+std::string ObjectStore::tempPath(const Digest& digest)
+{
+    return objectPath(digest) + TEMP_SUFFIX;
+}
+
+bool ObjectStore::holds(const Digest& digest, u64 size)
+{
+    struct stat st;
+    return stat(objectPath(digest).c_str(), &st) == 0 && S_ISREG(st.st_mode) && (u64)st.st_size == size;
+}
+
+Result ObjectStore::prepare(const Digest& digest)
+{
+    Result res = io::createDirectory(root());
+    if (R_SUCCEEDED(res)) {
+        res = io::createDirectory(root() + hex(digest).substr(0, 2));
+    }
+    return res;
+}
+
+bool ObjectStore::covers(const std::string& backupPath)
+{
+    const std::string path = !backupPath.empty() && backupPath.back() == '/' ? backupPath.substr(0, backupPath.size() - 1) : backupPath;
+    for (const std::string& base : backupRoots()) {
+        if (path.rfind(base, 0) != 0) {
+            continue;
+        }
+        const size_t slash = path.find('/', base.size());
+        return slash != std::string::npos && slash > base.size() && slash + 1 < path.size() && path.find('/', slash + 1) == std::string::npos;
+    }
+    return false;
+}
+
+io::TreeSnapshot ObjectStore::snapshot(const Manifest::Contents& manifest)
+{
+    io::TreeSnapshot tree;
+    tree.nodes.reserve(manifest.entries.size());
+    tree.sources.reserve(manifest.entries.size());
+    for (const Manifest::Entry& entry : manifest.entries) {
+        std::string source;
+        if (entry.folder) {
+            tree.stats.dirs++;
+        }
+        else {
+            source = objectPath(entry.sha256);
+            if (!holds(entry.sha256, entry.size)) {
+                Logging::error("Object store: the object of {} ({}) is missing or damaged.", entry.relPath, source);
+                tree.stats.unreadable++;
+                continue;
+            }
+            tree.stats.files++;
+            tree.stats.bytes += entry.size;
+        }
+        tree.nodes.push_back(io::TreeSnapshot::Node{(u32)tree.paths.size(), (u32)entry.relPath.size(), entry.folder, entry.size});
+        tree.paths += entry.relPath;
+        tree.sources.push_back(std::move(source));
+    }
+    return tree;
+}
+
+size_t ObjectStore::collectGarbage(void)
+{
+    if (!io::directoryExists(root())) {
+        return 0;
+    }
+
+    // Everything any stored manifest names. A stored manifest that cannot be
+    // read might name any object, so nothing is deleted then. Neither is it when
+    // a folder that could hold one fails to list, or a manifest's header is
+    // damaged and it cannot be told whether the backup is stored.
+    std::unordered_set<std::string> referenced;
+    for (const std::string& base : backupRoots()) {
+        if (!io::directoryExists(base)) {
+            continue;
+        }
+        Directory titles(base);
+        if (!titles.good()) {
+            Logging::error("Object store: cannot list {}; not collecting garbage.", base);
+            return 0;
+        }
+        for (size_t t = 0, tsz = titles.size(); t < tsz; t++) {
+            if (!titles.folder(t)) {
+                continue;
+            }
+            const std::string titleDir = base + titles.entry(t) + "/";
+            Directory backups(titleDir);
+            if (!backups.good()) {
+                Logging::error("Object store: cannot list {}; not collecting garbage.", titleDir);
+                return 0;
+            }
+            for (size_t b = 0, bsz = backups.size(); b < bsz; b++) {
+                const std::string name = backups.entry(b);
+                if (backups.folder(b) || !endsWith(name, ".manifest")) {
+                    continue;
+                }
+                const std::string backupPath = titleDir + name.substr(0, name.size() - std::string(".manifest").size());
+                Manifest::Layout layout;
+                if (!Manifest::readLayout(backupPath, layout)) {
+                    Logging::error("Object store: the manifest of {} is damaged; not collecting garbage.", backupPath);
+                    return 0;
+                }
+                if (layout != Manifest::Layout::Stored) {
+                    continue;
+                }
+                Manifest::Contents contents;
+                if (!Manifest::read(backupPath, contents)) {
+                    Logging::error("Object store: cannot read the manifest of {}; not collecting garbage.", backupPath);
+                    return 0;
+                }
+                for (const Manifest::Entry& entry : contents.entries) {
+                    if (!entry.folder) {
+                        referenced.insert(hex(entry.sha256));
+                    }
+                }
+            }
+        }
+    }
+
+    size_t removed = 0;
+    Directory prefixes(root());
+    for (size_t p = 0, psz = prefixes.good() ? prefixes.size() : 0; p < psz; p++) {
+        if (!prefixes.folder(p)) {
+            continue;
+        }
+        const std::string dir = root() + prefixes.entry(p) + "/";
+        Directory objects(dir);
+        for (size_t o = 0, osz = objects.good() ? objects.size() : 0; o < osz; o++) {
+            const std::string name = objects.entry(o);
+            // A ".tmp" name is never referenced, so interrupted writes go too.
+            if (objects.folder(o) || referenced.count(name) != 0) {
+                continue;
+            }
+            if (std::remove((dir + name).c_str()) == 0) {
+                removed++;
+            }
+            else {
+                Logging::warning("Object store: failed to delete {} with errno {}.", dir + name, errno);
+            }
+        }
+    }
+    Logging::info("Object store: {} objects referenced, {} removed.", referenced.size(), removed);
+    return removed;
+}
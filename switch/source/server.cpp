@@ -31,8 +31,10 @@
 #include "transferstatus.hpp"
 #include <switch.h>
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <atomic>
+#include <cctype>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -41,6 +43,7 @@
 #include <map>
 #include <mutex>
 #include <netinet/in.h>
+#include <optional>
 #include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -83,8 +86,8 @@ namespace {
     constexpr int HEADER_TIMEOUT_MS = 5000;
 
     std::map<std::string, Server::HttpHandler> handlers;
-    // Streaming upload handlers, keyed by path: {temp body file path, handler}.
-    std::map<std::string, std::pair<std::string, Server::UploadHandler>> uploadHandlers;
+    // Streaming upload handlers, keyed by path.
+    std::map<std::string, Server::UploadHandler> uploadHandlers;
     // handlers/uploadHandlers are mutated from the main thread (register/unregister)
     // while the worker thread looks them up, so guard both.
     std::mutex handlersMutex;
@@ -164,7 +167,7 @@ namespace {
         return "";
     }
 
-    size_t parseContentLength(const std::string& headers)
+    u64 parseContentLength(const std::string& headers)
     {
         // headerValue is case-insensitive, so every spelling a client may send is
         // covered without listing them here.
@@ -172,57 +175,77 @@ namespace {
         if (value.empty()) {
             return 0;
         }
-        return (size_t)strtoul(value.c_str(), nullptr, 10);
+        return strtoull(value.c_str(), nullptr, 10);
     }
 
-    // Streams the body of an upload request to `tmpPath`, tracking progress and
-    // honouring a receive cancel. `leftover` is the body bytes already read while
-    // parsing the header. Returns true when the full body was written.
-    bool streamBodyToFile(s32 clientSocket, const std::string& tmpPath, size_t contentLength, const char* leftover, size_t leftoverLen)
+    // A sender that compresses on the fly cannot know the body length upfront
+    // and sends it "Transfer-Encoding: chunked" instead of with a Content-Length.
+    bool isChunked(const std::string& headers)
     {
-        FILE* out = fopen(tmpPath.c_str(), "wb");
-        if (out == nullptr) {
-            Logging::error("Failed to open upload temp file {} with errno {}.", tmpPath, errno);
-            return false;
-        }
-
-        TransferStatus::beginNetwork(i18n::t("transfer.downloading"), contentLength);
+        std::string value = TransferProto::headerValue(headers, "Transfer-Encoding");
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return value.find("chunked") != std::string::npos;
+    }
 
-        size_t written = 0;
-        if (leftoverLen > 0) {
-            size_t toWrite = leftoverLen > contentLength ? contentLength : leftoverLen;
-            fwrite(leftover, 1, toWrite, out);
-            written += toWrite;
-            TransferStatus::setBytesDone(written);
+    // Upload body still on the socket, handed to an upload handler as a
+    // ByteReader: first the bytes that arrived along with the header block, then
+    // recv() up to Content-Length (or until the connection closes, under a
+    // chunked body that marks its own end). Progress and receive-cancel are
+    // tracked here, so the handler only has to consume it.
+    struct SocketBodyReader : TransferProto::ByteReader {
+        s32 sock;
+        const char* leftover;
+        size_t leftoverLen;
+        u64 remaining;
+        u64 received = 0;
+        int idleMs   = 0;
+        // Cancelled, stalled, or dropped before Content-Length bytes arrived.
+        bool failed = false;
+        // Off for a chunked body: it has no total to measure against, so the
+        // handler reports progress in payload bytes instead.
+        bool trackProgress = true;
+
+        SocketBodyReader(s32 s, const char* left, size_t leftLen, u64 contentLength)
+            : sock(s), leftover(left), leftoverLen(leftLen), remaining(contentLength)
+        {
         }
 
-        constexpr size_t RECV_CHUNK = 64 * 1024;
-        std::vector<char> buffer(RECV_CHUNK);
-        int idleMs = 0;
-        bool ok    = true;
-        while (written < contentLength) {
-            ssize_t received = pollRecv(clientSocket, buffer.data(), buffer.size(), idleMs, true);
-            if (received <= 0) {
-                ok = false; // clean close, idle timeout, or cancel: incomplete body
-                break;
+        size_t read(void* dst, size_t n) override
+        {
+            if (remaining == 0 || failed) {
+                return 0;
             }
-            size_t toWrite = (size_t)received;
-            if (written + toWrite > contentLength) {
-                toWrite = contentLength - written;
+            if (n > remaining) {
+                n = (size_t)remaining;
             }
-            fwrite(buffer.data(), 1, toWrite, out);
-            written += toWrite;
-            TransferStatus::setBytesDone(written);
+            size_t got = 0;
+            if (leftoverLen > 0) {
+                got = n < leftoverLen ? n : leftoverLen;
+                memcpy(dst, leftover, got);
+                leftover += got;
+                leftoverLen -= got;
+            }
+            else {
+                ssize_t rc = pollRecv(sock, static_cast<char*>(dst), n, idleMs, true);
+                if (rc <= 0) {
+                    failed = true; // clean close, idle timeout, or cancel: incomplete body
+                    return 0;
+                }
+                got = (size_t)rc;
+            }
+            remaining -= got;
+            received += got;
+            if (trackProgress) {
+                TransferStatus::setBytesDone(received);
+            }
+            return got;
         }
-
-        fclose(out);
-        return ok && written == contentLength;
-    }
+    };
 
     void handleHttpRequest(s32 clientSocket)
     {
         // Read only up to and including the header terminator; the body is either
-        // streamed to disk (upload paths) or read into RAM afterwards (others).
+        // handed to an upload handler off the socket or read into RAM afterwards.
         std::string data;
         data.reserve(4096);
         constexpr size_t RECV_CHUNK = 64 * 1024;
@@ -248,39 +271,49 @@ namespace {
             return; // never got a complete header block
         }
 
-        std::string headers  = data.substr(0, headerEnd);
-        std::string path     = extractPath(headers);
-        size_t contentLength = parseContentLength(headers);
-        size_t bodyStart     = headerEnd + 4;
+        std::string headers = data.substr(0, headerEnd);
+        std::string path    = extractPath(headers);
+        u64 contentLength   = parseContentLength(headers);
+        size_t bodyStart    = headerEnd + 4;
 
         // Streaming upload path.
-        std::string tmpPath;
         Server::UploadHandler uploadHandler;
         bool isUpload = false;
         {
             std::lock_guard<std::mutex> lock(handlersMutex);
             auto it = uploadHandlers.find(path);
             if (it != uploadHandlers.end()) {
-                tmpPath       = it->second.first;
-                uploadHandler = it->second.second;
+                uploadHandler = it->second;
                 isUpload      = true;
             }
         }
         if (isUpload) {
-            const char* leftover = data.data() + bodyStart;
-            size_t leftoverLen   = data.size() - bodyStart;
-            bool complete        = streamBodyToFile(clientSocket, tmpPath, contentLength, leftover, leftoverLen);
-            if (!complete) {
-                // Cancelled, stalled, or dropped mid-upload: drop the request and
-                // clear the transfer UI; the handler never runs on a partial body.
-                std::remove(tmpPath.c_str());
+            bool chunked   = isChunked(headers);
+            u64 wireLength = chunked ? UINT64_MAX : contentLength;
+            TransferStatus::beginNetwork(i18n::t("transfer.downloading"), chunked ? 0 : contentLength);
+            size_t leftoverLen = (size_t)std::min<u64>(data.size() - bodyStart, wireLength);
+            SocketBodyReader socketBody(clientSocket, data.data() + bodyStart, leftoverLen, wireLength);
+            socketBody.trackProgress = !chunked;
+            std::optional<TransferProto::ChunkedReader> chunkedBody;
+            if (chunked) {
+                chunkedBody.emplace(socketBody);
+            }
+            TransferProto::ByteReader& body = chunked ? static_cast<TransferProto::ByteReader&>(*chunkedBody) : socketBody;
+            Server::UploadRequest req{headers, chunked ? UINT64_MAX : contentLength, body};
+            Server::HttpResponse response = uploadHandler(req);
+
+            // The sender writes its whole body before it reads the reply, so
+            // whatever the handler did not consume (a rejected PIN, say) is
+            // drained before answering.
+            while (body.read(buffer.data(), buffer.size()) > 0) {
+            }
+            if (socketBody.failed || (chunkedBody && !chunkedBody->finished())) {
+                // Cancelled, stalled, or dropped mid-upload: nobody is left to
+                // read a response, so just clear the transfer UI.
                 TransferStatus::end();
                 Logging::info("Upload to {} abandoned before the full body arrived.", path);
                 return;
             }
-            Server::UploadRequest req{headers, tmpPath, (uint64_t)contentLength};
-            Server::HttpResponse response = uploadHandler(req);
-            std::remove(tmpPath.c_str());
             sendResponse(clientSocket, response);
             return;
         }
@@ -389,11 +422,11 @@ void Server::unregisterHandler(const std::string& path)
     Logging::info("Unregistered HTTP handler for path {}", path);
 }
 
-void Server::registerUploadHandler(const std::string& path, const std::string& tmpPath, Server::UploadHandler handler)
+void Server::registerUploadHandler(const std::string& path, Server::UploadHandler handler)
 {
     {
         std::lock_guard<std::mutex> lock(handlersMutex);
-        uploadHandlers[path] = {tmpPath, handler};
+        uploadHandlers[path] = handler;
     }
     Logging::info("Registered upload handler for path {}", path);
 }
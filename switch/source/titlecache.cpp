@@ -0,0 +1,131 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+#include "titlecache.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    // Field layout of the fixed part of one cache entry. The single source of
+    // truth for the format; encode() and decode() are mirror images over these
+    // offsets.
+    constexpr size_t OFF_SAVE_ID   = 0;   // u64
+    constexpr size_t OFF_ID        = 8;   // u64
+    constexpr size_t OFF_UID       = 16;  // AccountUid
+    constexpr size_t OFF_TYPE      = 32;  // u8
+    constexpr size_t OFF_SPACE     = 33;  // u8
+    constexpr size_t OFF_USABLE    = 34;  // u8 bool
+    constexpr size_t OFF_ICON_SIZE = 36;  // u32
+    constexpr size_t OFF_NAME      = 40;  // NAME_LEN
+    constexpr size_t OFF_AUTHOR    = 552; // AUTHOR_LEN
+
+    constexpr size_t NAME_LEN   = 0x200; // NacpLanguageEntry::name
+    constexpr size_t AUTHOR_LEN = 0x100; // NacpLanguageEntry::author
+    // An icon never outgrows the control data it is read from.
+    constexpr size_t MAX_ICON_BYTES = sizeof(NsApplicationControlData::icon);
+
+    static_assert(OFF_AUTHOR + AUTHOR_LEN == TitleCache::ENTRY_SIZE, "ENTRY_SIZE out of step with the field layout");
+
+    // Copies a UTF-8 string into a fixed field of `fieldLen` bytes, always leaving
+    // room for a terminating NUL and backing off to the previous codepoint boundary
+    // when the clamp lands mid-sequence. The entry is memset to 0 up front, so the
+    // unwritten tail is already the NUL padding.
+    void copyClamped(u8* dst, size_t offset, const std::string& src, size_t fieldLen)
+    {
+        size_t n = std::min(src.length(), fieldLen - 1);
+        // back off out of the middle of a multibyte sequence
+        while (n > 0 && (static_cast<u8>(src[n]) & 0xC0) == 0x80) {
+            n--;
+        }
+        std::memcpy(dst + offset, src.data(), n);
+    }
+
+    std::string readClamped(const u8* src, size_t offset, size_t fieldLen)
+    {
+        const char* field = reinterpret_cast<const char*>(src + offset);
+        // a stale/corrupt cache could carry an unterminated field
+        return std::string(field, strnlen(field, fieldLen - 1));
+    }
+}
+
+TitleCache::Entry TitleCache::keyOf(const FsSaveDataInfo& info)
+{
+    Entry entry;
+    entry.saveId  = info.save_data_id;
+    entry.id      = (info.save_data_type == FsSaveDataType_System) ? info.system_save_data_id : info.application_id;
+    entry.uid     = info.uid;
+    entry.type    = info.save_data_type;
+    entry.spaceId = info.save_data_space_id;
+    return entry;
+}
+
+bool TitleCache::matches(const Entry& entry, const FsSaveDataInfo& info)
+{
+    const Entry key = keyOf(info);
+    return entry.saveId == key.saveId && entry.id == key.id && entry.type == key.type && entry.spaceId == key.spaceId &&
+           std::memcmp(&entry.uid, &key.uid, sizeof(AccountUid)) == 0;
+}
+
+void TitleCache::encode(u8* dst, const Entry& entry)
+{
+    std::memset(dst, 0, ENTRY_SIZE);
+
+    u8 usable    = entry.usable ? 1 : 0;
+    u32 iconSize = (u32)entry.icon.size();
+
+    std::memcpy(dst + OFF_SAVE_ID, &entry.saveId, sizeof(u64));
+    std::memcpy(dst + OFF_ID, &entry.id, sizeof(u64));
+    std::memcpy(dst + OFF_UID, &entry.uid, sizeof(AccountUid));
+    std::memcpy(dst + OFF_TYPE, &entry.type, sizeof(u8));
+    std::memcpy(dst + OFF_SPACE, &entry.spaceId, sizeof(u8));
+    std::memcpy(dst + OFF_USABLE, &usable, sizeof(u8));
+    std::memcpy(dst + OFF_ICON_SIZE, &iconSize, sizeof(u32));
+    copyClamped(dst, OFF_NAME, entry.name, NAME_LEN);
+    copyClamped(dst, OFF_AUTHOR, entry.author, AUTHOR_LEN);
+}
+
+bool TitleCache::decode(const u8* src, Entry& entry)
+{
+    u8 usable;
+    u32 iconSize;
+
+    std::memcpy(&entry.saveId, src + OFF_SAVE_ID, sizeof(u64));
+    std::memcpy(&entry.id, src + OFF_ID, sizeof(u64));
+    std::memcpy(&entry.uid, src + OFF_UID, sizeof(AccountUid));
+    std::memcpy(&entry.type, src + OFF_TYPE, sizeof(u8));
+    std::memcpy(&entry.spaceId, src + OFF_SPACE, sizeof(u8));
+    std::memcpy(&usable, src + OFF_USABLE, sizeof(u8));
+    std::memcpy(&iconSize, src + OFF_ICON_SIZE, sizeof(u32));
+    if (usable > 1 || iconSize > MAX_ICON_BYTES) {
+        return false;
+    }
+
+    entry.usable = usable == 1;
+    entry.name   = readClamped(src, OFF_NAME, NAME_LEN);
+    entry.author = readClamped(src, OFF_AUTHOR, AUTHOR_LEN);
+    entry.icon.resize(iconSize);
+    return true;
+}
@@ -27,14 +27,71 @@
 #include "titlecatalog.hpp"
 #include "configuration.hpp"
 #include "logging.hpp"
+#include "paths.hpp"
 #include "savekind.hpp"
 #include "sortmode.hpp"
 #include "titleprobe.hpp"
 #include <algorithm>
+#include <cerrno>
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <unordered_set>
 
+namespace {
+    // A header, then per entry its fixed part (TitleCache::ENTRY_SIZE) and its icon.
+    constexpr const char* CACHE_FILE  = "/titles.cache";
+    constexpr u32 CACHE_MAGIC         = 0x43544B43; // "CKTC"
+    constexpr size_t OFF_MAGIC        = 0;          // u32
+    constexpr size_t OFF_VERSION      = 4;          // u32
+    constexpr size_t OFF_LANGUAGE     = 8;          // u64
+    constexpr size_t OFF_COUNT        = 16;         // u32
+    constexpr size_t CACHE_HEADER_LEN = 20;
+
+    // Save-data info entries fetched per fsSaveDataInfoReaderRead call.
+    constexpr s64 SAVE_INFO_BATCH = 64;
+
+    std::string cachePath(void)
+    {
+        return std::string(Paths::checkpointRoot()) + CACHE_FILE;
+    }
+
+    // Names and authors are read in the system language (nacpGetLanguageEntry),
+    // so a cache is only good for the language it was written under.
+    u64 systemLanguage(void)
+    {
+        u64 code = 0;
+        if (R_SUCCEEDED(setInitialize())) {
+            setGetSystemLanguage(&code);
+            setExit();
+        }
+        return code;
+    }
+
+    // Every save in `space`, read SAVE_INFO_BATCH entries per round-trip instead
+    // of one.
+    std::vector<FsSaveDataInfo> readSaveDataInfo(FsSaveDataSpaceId space)
+    {
+        std::vector<FsSaveDataInfo> infos;
+        FsSaveDataInfoReader reader;
+        if (R_FAILED(fsOpenSaveDataInfoReader(&reader, space))) {
+            return infos;
+        }
+        for (;;) {
+            const size_t have = infos.size();
+            s64 read          = 0;
+            infos.resize(have + SAVE_INFO_BATCH);
+            Result res = fsSaveDataInfoReaderRead(&reader, infos.data() + have, SAVE_INFO_BATCH, &read);
+            infos.resize(have + (R_SUCCEEDED(res) ? (size_t)read : 0));
+            if (R_FAILED(res) || read == 0) {
+                break;
+            }
+        }
+        fsSaveDataInfoReaderClose(&reader);
+        return infos;
+    }
+}
+
 TitleCatalog::TitleCatalog(void) : mSortMode(Configuration::getInstance().sortMode()) {}
 
 void TitleCatalog::loadTitles(void)
@@ -48,74 +105,110 @@ void TitleCatalog::loadTitles(void)
     }
     memset(nsacd, 0, sizeof(NsApplicationControlData));
 
-    FsSaveDataInfoReader reader;
-    FsSaveDataInfo info;
-    s64 total_entries = 0;
+    // Each save is restored from the cache when it holds an entry for exactly
+    // that save, and probed otherwise. `found` collects the entries for every
+    // save this scan saw, to be written back.
+    TitleCache::Entries cached = importTitleListCache();
+    TitleCache::Entries found;
+    const size_t cachedCount = cached.size();
+    size_t restored          = 0;
+    size_t shared            = 0;
+    size_t probed            = 0;
+
+    // A title's control data is the same for every save of it (one per user,
+    // plus its BCAT and device saves), so it is read at most once per scan:
+    // by title id, the first entry in `found` that holds it.
+    std::unordered_map<u64, const TitleCache::Entry*> controlData;
+    auto remember = [&](const TitleCache::Entry& entry) {
+        if (entry.usable && entry.type != FsSaveDataType_System) {
+            controlData.emplace(entry.id, &entry);
+        }
+    };
+
+    auto resolve = [&](Title& title, const FsSaveDataInfo& save) {
+        auto hit = cached.find(save.save_data_id);
+        if (hit != cached.end() && TitleCache::matches(hit->second, save)) {
+            bool ok = TitleProbe::restore(title, save, hit->second, mIcons);
+            remember(found.emplace(hit->first, std::move(hit->second)).first->second);
+            cached.erase(hit);
+            restored++;
+            return ok;
+        }
+        TitleCache::Entry record = TitleCache::keyOf(save);
+        auto known               = record.type != FsSaveDataType_System ? controlData.find(record.id) : controlData.end();
+        bool ok;
+        if (known != controlData.end()) {
+            record.name   = known->second->name;
+            record.author = known->second->author;
+            record.icon   = known->second->icon;
+            ok            = TitleProbe::restore(title, save, record, mIcons);
+            shared++;
+        }
+        else {
+            ok = TitleProbe::probe(title, save, mIcons, nsacd, &record);
+            probed++;
+        }
+        // A failed mount is stable enough to remember; missing control data is
+        // not (the game may be reinstalled), so that save is probed again.
+        if (ok || !record.usable) {
+            remember(found.emplace(save.save_data_id, std::move(record)).first->second);
+        }
+        return ok;
+    };
 
     // BCAT/Device/System singletons are appended to every user's list once the scan finishes.
     std::vector<Title> bcatTitles;
     std::vector<Title> deviceTitles;
     std::vector<Title> systemTitles;
 
-    Result res = fsOpenSaveDataInfoReader(&reader, FsSaveDataSpaceId_User);
-    if (R_SUCCEEDED(res)) {
-        while (1) {
-            res = fsSaveDataInfoReaderRead(&reader, &info, 1, &total_entries);
-            if (R_FAILED(res) || total_entries == 0) {
-                break;
-            }
-
-            Title title;
-            if (!TitleProbe::probe(title, info, mIcons, nsacd)) {
-                continue;
-            }
+    for (const FsSaveDataInfo& info : readSaveDataInfo(FsSaveDataSpaceId_User)) {
+        Title title;
+        if (!resolve(title, info)) {
+            continue;
+        }
 
-            switch (info.save_data_type) {
-                case FsSaveDataType_Account: {
-                    auto it = mTitles.find(info.uid);
-                    if (it != mTitles.end()) {
-                        it->second.push_back(title);
-                    }
-                    else {
-                        mTitles.emplace(info.uid, std::vector<Title>{title});
-                    }
-                    break;
+        switch (info.save_data_type) {
+            case FsSaveDataType_Account: {
+                auto it = mTitles.find(info.uid);
+                if (it != mTitles.end()) {
+                    it->second.push_back(title);
                 }
-                case FsSaveDataType_Bcat:
-                    bcatTitles.push_back(title);
-                    break;
-                case FsSaveDataType_Device:
-                    deviceTitles.push_back(title);
-                    break;
-                default:
-                    break;
+                else {
+                    mTitles.emplace(info.uid, std::vector<Title>{title});
+                }
+                break;
             }
+            case FsSaveDataType_Bcat:
+                bcatTitles.push_back(title);
+                break;
+            case FsSaveDataType_Device:
+                deviceTitles.push_back(title);
+                break;
+            default:
+                break;
         }
-        fsSaveDataInfoReaderClose(&reader);
     }
 
     // enumerate system saves from the System space
-    res = fsOpenSaveDataInfoReader(&reader, FsSaveDataSpaceId_System);
-    if (R_SUCCEEDED(res)) {
-        while (1) {
-            res = fsSaveDataInfoReaderRead(&reader, &info, 1, &total_entries);
-            if (R_FAILED(res) || total_entries == 0) {
-                break;
-            }
-            if (info.save_data_type != FsSaveDataType_System) {
-                continue;
-            }
+    for (const FsSaveDataInfo& info : readSaveDataInfo(FsSaveDataSpaceId_System)) {
+        if (info.save_data_type != FsSaveDataType_System) {
+            continue;
+        }
 
-            Title title;
-            if (TitleProbe::probe(title, info, mIcons, nsacd)) {
-                systemTitles.push_back(title);
-            }
+        Title title;
+        if (resolve(title, info)) {
+            systemTitles.push_back(title);
         }
-        fsSaveDataInfoReaderClose(&reader);
     }
 
     free(nsacd);
 
+    Logging::info("[titlecache] {} saves restored from the cache, {} shared another save's control data, {} probed.", restored, shared, probed);
+    // Rewritten when the scan added an entry or a cached save has gone.
+    if (found.size() != restored || restored != cachedCount) {
+        exportTitleListCache(found);
+    }
+
     // append the shared BCAT / device / system saves to every user's list
     for (auto& pair : mTitles) {
         for (const auto& bcatTitle : bcatTitles) {
@@ -132,6 +225,96 @@ void TitleCatalog::loadTitles(void)
     sortTitles();
 }
 
+TitleCache::Entries TitleCatalog::importTitleListCache(void)
+{
+    TitleCache::Entries entries;
+    const std::string path = cachePath();
+    FILE* f                = fopen(path.c_str(), "rb");
+    if (f == NULL) {
+        return entries;
+    }
+
+    u8 header[CACHE_HEADER_LEN];
+    u32 magic = 0, version = 0, count = 0;
+    u64 language = 0;
+    if (fread(header, 1, CACHE_HEADER_LEN, f) == CACHE_HEADER_LEN) {
+        std::memcpy(&magic, header + OFF_MAGIC, sizeof(u32));
+        std::memcpy(&version, header + OFF_VERSION, sizeof(u32));
+        std::memcpy(&language, header + OFF_LANGUAGE, sizeof(u64));
+        std::memcpy(&count, header + OFF_COUNT, sizeof(u32));
+    }
+    if (magic != CACHE_MAGIC || version != TitleCache::FORMAT_VERSION || language != systemLanguage()) {
+        fclose(f);
+        Logging::info("[titlecache] Ignoring {}: written by another version or under another language.", path);
+        return entries;
+    }
+
+    // A damaged count must not size the map: no more entries can follow than
+    // fixed parts fit in the rest of the file.
+    long end = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        end = ftell(f);
+    }
+    if (end < (long)CACHE_HEADER_LEN || fseek(f, CACHE_HEADER_LEN, SEEK_SET) != 0) {
+        fclose(f);
+        Logging::warning("[titlecache] Failed to read {}.", path);
+        return entries;
+    }
+    entries.reserve(std::min<size_t>(count, (size_t)(end - CACHE_HEADER_LEN) / TitleCache::ENTRY_SIZE));
+    u8 fixed[TitleCache::ENTRY_SIZE];
+    for (u32 i = 0; i < count; i++) {
+        TitleCache::Entry entry;
+        if (fread(fixed, 1, TitleCache::ENTRY_SIZE, f) != TitleCache::ENTRY_SIZE || !TitleCache::decode(fixed, entry) ||
+            fread(entry.icon.data(), 1, entry.icon.size(), f) != entry.icon.size()) {
+            // A torn or corrupt tail: keep what decoded before it, probe the rest.
+            Logging::warning("[titlecache] {} is cut short after {} of {} entries.", path, i, count);
+            break;
+        }
+        const u64 saveId = entry.saveId;
+        entries.emplace(saveId, std::move(entry));
+    }
+    fclose(f);
+    return entries;
+}
+
+void TitleCatalog::exportTitleListCache(const TitleCache::Entries& entries)
+{
+    u8 header[CACHE_HEADER_LEN];
+    const u32 version  = TitleCache::FORMAT_VERSION;
+    const u64 language = systemLanguage();
+    const u32 count    = (u32)entries.size();
+    std::memcpy(header + OFF_MAGIC, &CACHE_MAGIC, sizeof(u32));
+    std::memcpy(header + OFF_VERSION, &version, sizeof(u32));
+    std::memcpy(header + OFF_LANGUAGE, &language, sizeof(u64));
+    std::memcpy(header + OFF_COUNT, &count, sizeof(u32));
+
+    // Written aside, so a crash mid-write leaves the previous cache rather than
+    // a torn one. The old cache goes only once the new one is complete: the SD
+    // card refuses to rename onto an existing file.
+    const std::string path = cachePath();
+    const std::string temp = path + ".tmp";
+    FILE* f                = fopen(temp.c_str(), "wb");
+    if (f == NULL) {
+        Logging::warning("[titlecache] Failed to create {} with errno {}.", temp, errno);
+        return;
+    }
+    bool ok = fwrite(header, 1, CACHE_HEADER_LEN, f) == CACHE_HEADER_LEN;
+    u8 fixed[TitleCache::ENTRY_SIZE];
+    for (const auto& [saveId, entry] : entries) {
+        TitleCache::encode(fixed, entry);
+        ok = ok && fwrite(fixed, 1, TitleCache::ENTRY_SIZE, f) == TitleCache::ENTRY_SIZE &&
+             fwrite(entry.icon.data(), 1, entry.icon.size(), f) == entry.icon.size();
+    }
+    ok = fclose(f) == 0 && ok;
+    if (ok) {
+        std::remove(path.c_str());
+    }
+    if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+        Logging::warning("[titlecache] Failed to write {} with errno {}.", path, errno);
+        std::remove(temp.c_str());
+    }
+}
+
 // One pass over the raw list, bucketing each index by its SaveKind row. Replaces
 // the O(n) `saveDataType() == type` scan the filtered queries used to repeat
 // once per visible grid cell, every frame.
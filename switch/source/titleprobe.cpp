@@ -27,12 +27,46 @@
 #include "titleprobe.hpp"
 #include "savedatasource.hpp"
 
-bool TitleProbe::probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons, NsApplicationControlData* nsacd)
+namespace {
+    // Everything a probe and a cache hit share once the name and author are
+    // known: the backup directory, the Title itself and its play statistics.
+    void finish(Title& dst, const FsSaveDataInfo& info, u64 tid, const std::string& name, const std::string& author)
+    {
+        const u8 type  = info.save_data_type;
+        AccountUid uid = {0};
+        if (type == FsSaveDataType_Account) {
+            uid = info.uid;
+        }
+
+        SaveDataSource source(type);
+        const std::string userName = source.isUserAccount() ? Account::username(uid) : source.fixedUserName();
+        const std::string safeName =
+            StringUtils::containsInvalidChar(name) ? StringUtils::format("0x%016llX", tid) : StringUtils::removeForbiddenCharacters(name);
+        const std::string path = source.baseDir() + StringUtils::format("0x%016llX", tid) + " " + safeName;
+
+        if (!io::directoryExists(path)) {
+            io::createDirectory(path);
+        }
+
+        const u8 spaceId = (type == FsSaveDataType_System) ? info.save_data_space_id : (u8)FsSaveDataSpaceId_User;
+        dst.init(type, tid, uid, spaceId, name, author, userName, path);
+        dst.saveId(info.save_data_id);
+
+        if (type == FsSaveDataType_Account) {
+            PdmPlayStatistics stats;
+            if (R_SUCCEEDED(pdmqryQueryPlayStatisticsByApplicationIdAndUserAccountId(tid, uid, false, &stats))) {
+                dst.playTimeNanoseconds(stats.playtime);
+                dst.lastPlayedTimestamp(stats.last_timestamp_user);
+            }
+        }
+    }
+}
+
+bool TitleProbe::probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons, NsApplicationControlData* nsacd, TitleCache::Entry* record)
 {
     const u8 type = info.save_data_type;
     // System saves are keyed by their system_save_data_id; everything else by application_id.
     const u64 tid = (type == FsSaveDataType_System) ? info.system_save_data_id : info.application_id;
-    const u64 sid = info.save_data_id;
 
     if (Configuration::getInstance().filter(tid)) {
         return false;
@@ -40,12 +74,14 @@ bool TitleProbe::probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons,
 
     std::string name;
     std::string author;
-    AccountUid uid = {0};
 
     if (type == FsSaveDataType_System) {
         // verify the save can be mounted before adding it
         FsFileSystem testFs;
         if (R_FAILED(FileSystem::mountSystemSave(&testFs, tid, info.save_data_space_id))) {
+            if (record != nullptr) {
+                record->usable = false;
+            }
             return false;
         }
         fsFsClose(&testFs);
@@ -53,9 +89,6 @@ bool TitleProbe::probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons,
         icons.loadPlaceholderIcon(tid);
     }
     else {
-        if (type == FsSaveDataType_Account) {
-            uid = info.uid;
-        }
         size_t outsize         = 0;
         NacpLanguageEntry* nle = NULL;
         Result res = nsGetApplicationControlData(NsApplicationControlSource_Storage, tid, nsacd, sizeof(NsApplicationControlData), &outsize);
@@ -69,29 +102,32 @@ bool TitleProbe::probe(Title& dst, const FsSaveDataInfo& info, IconStore& icons,
         name   = std::string(nle->name);
         author = std::string(nle->author);
         icons.loadIcon(tid, nsacd, outsize - sizeof(nsacd->nacp));
+        if (record != nullptr) {
+            record->icon.assign(nsacd->icon, nsacd->icon + (outsize - sizeof(nsacd->nacp)));
+        }
     }
 
-    SaveDataSource source(type);
-    const std::string userName = source.isUserAccount() ? Account::username(uid) : source.fixedUserName();
-    const std::string safeName =
-        StringUtils::containsInvalidChar(name) ? StringUtils::format("0x%016llX", tid) : StringUtils::removeForbiddenCharacters(name);
-    const std::string path = source.baseDir() + StringUtils::format("0x%016llX", tid) + " " + safeName;
-
-    if (!io::directoryExists(path)) {
-        io::createDirectory(path);
+    if (record != nullptr) {
+        record->name   = name;
+        record->author = author;
     }
+    finish(dst, info, tid, name, author);
+    return true;
+}
 
-    const u8 spaceId = (type == FsSaveDataType_System) ? info.save_data_space_id : (u8)FsSaveDataSpaceId_User;
-    dst.init(type, tid, uid, spaceId, name, author, userName, path);
-    dst.saveId(sid);
+bool TitleProbe::restore(Title& dst, const FsSaveDataInfo& info, const TitleCache::Entry& entry, IconStore& icons)
+{
+    if (Configuration::getInstance().filter(entry.id) || !entry.usable) {
+        return false;
+    }
 
-    if (type == FsSaveDataType_Account) {
-        PdmPlayStatistics stats;
-        if (R_SUCCEEDED(pdmqryQueryPlayStatisticsByApplicationIdAndUserAccountId(tid, uid, false, &stats))) {
-            dst.playTimeNanoseconds(stats.playtime);
-            dst.lastPlayedTimestamp(stats.last_timestamp_user);
-        }
+    if (entry.type == FsSaveDataType_System) {
+        icons.loadPlaceholderIcon(entry.id);
+    }
+    else if (!entry.icon.empty()) {
+        icons.storeIcon(entry.id, entry.icon.data(), entry.icon.size());
     }
 
+    finish(dst, info, entry.id, entry.name, entry.author);
     return true;
 }
@@ -28,9 +28,12 @@
 #include "common.hpp"
 #include "configuration.hpp"
 #include "directory.hpp"
+#include "i18n.hpp"
 #include "io.hpp"
 #include "json.hpp"
 #include "logging.hpp"
+#include "manifest.hpp"
+#include "objectstore.hpp"
 #include "server.hpp"
 #include "titlecatalog.hpp"
 #include "transferprotocol.hpp"
@@ -48,9 +51,12 @@
 #include <mutex>
 #include <netinet/in.h>
 #include <poll.h>
+#include <set>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
 // The wire protocol (CRC, zip framing, path safety, HTTP header/auth helpers) is
@@ -62,9 +68,15 @@ namespace {
     constexpr int TRANSFER_PORT        = 8000;
     const char* CHECKPOINT_ROOT        = "sdmc:/switch/Checkpoint/";
     const char* SAVES_ROOT             = "sdmc:/switch/Checkpoint/saves/";
-    const char* TEMP_UPLOAD            = "sdmc:/switch/Checkpoint/transfer_upload.tmp";
     const std::string TEMP_SEND_PREFIX = "transfer_send_";
     const std::string TEMP_SEND_SUFFIX = ".zip";
+    // Uploads are received into this folder and moved into place only once the
+    // whole body has arrived and checked out, so a dropped or cancelled transfer
+    // never leaves a half-written backup behind, nor costs the one it replaces.
+    const char* RECV_STAGING = "sdmc:/switch/Checkpoint/transfer_staging";
+    // Body spool of the receiver before it extracted straight off the socket;
+    // still swept on boot.
+    const char* TEMP_UPLOAD_LEGACY = "sdmc:/switch/Checkpoint/transfer_upload.tmp";
 
     std::string g_token;
     std::string g_receiverIp;
@@ -72,7 +84,13 @@ namespace {
     bool g_receiverRunning = false;
     std::atomic<bool> g_pendingRefresh{false};
     std::atomic<bool> g_receiverCompleted{false};
-    std::atomic<u64> g_completedTitleId{0};
+    // Set when a received backup replaced a stored one, whose objects the UI
+    // sweeps once it closes the receiver.
+    std::atomic<bool> g_releasedObjects{false};
+    // Titles that received a backup, for the UI to refresh once it closes the
+    // receiver.
+    std::mutex g_completedMutex;
+    std::vector<u64> g_completedTitleIds;
     // The PIN is the sole credential gating writes into the SD tree. Bound brute
     // force: after this many bad-token uploads the receiver shuts itself down.
     // Reset when the receiver is (re)armed in startReceiver.
@@ -86,6 +104,15 @@ namespace {
     // Title the Receive row was opened from; the destination of last resort when
     // the upload's meta names no installed title. 0 = none.
     u64 g_receiverSelectedTitle = 0;
+    // Files of an interrupted zip upload left in RECV_STAGING, which a
+    // continuation with the same upload id picks up instead of starting over
+    // (see TransferProto::ManifestEntry). Guarded by g_receiverMutex; an empty
+    // uploadId means there is nothing to resume.
+    struct PendingResume {
+        std::string uploadId;
+        std::string backupRoot;
+        std::vector<ManifestEntry> files;
+    } g_pendingResume;
 
     void setReceiverNotice(const std::string& notice)
     {
@@ -99,19 +126,7 @@ namespace {
         g_receiverCompletedName = name;
     }
 
-    u64 fileSize(const std::string& path)
-    {
-        struct stat st;
-        if (stat(path.c_str(), &st) != 0) {
-            return 0;
-        }
-        return (u64)st.st_size;
-    }
-
-    // Returns false if any regular file exceeds the store-zip entry limit; such a
-    // file cannot be framed (no zip64) and the whole send must refuse rather than
-    // truncate the size to u32.
-    bool collectFiles(const std::string& root, const std::string& sub, std::vector<SendFile>& out, std::vector<std::string>* outDirs = nullptr)
+    void collectFiles(const std::string& root, const std::string& sub, std::vector<SendFile>& out, std::vector<std::string>* outDirs = nullptr)
     {
         std::string current = root;
         if (!current.empty() && current.back() != '/') {
@@ -120,9 +135,8 @@ namespace {
         current += sub;
         Directory items(current);
         if (!items.good()) {
-            return true;
+            return;
         }
-        bool ok = true;
         for (size_t i = 0, sz = items.size(); i < sz; i++) {
             std::string name = items.entry(i);
             if (name == "." || name == "..") {
@@ -133,24 +147,56 @@ namespace {
                 if (outDirs != nullptr) {
                     outDirs->push_back(nextSub);
                 }
-                if (!collectFiles(root, nextSub, out, outDirs)) {
-                    ok = false;
-                }
+                collectFiles(root, nextSub, out, outDirs);
             }
             else {
                 SendFile entry;
                 entry.absPath = current + name;
                 entry.relPath = sub + name;
-                u64 sz64      = fileSize(entry.absPath);
-                if (sz64 > TransferProto::kZipMaxSize) {
-                    ok = false;
-                    continue;
-                }
-                entry.size = (u32)sz64;
+                entry.size    = items.fileSize(i);
                 out.push_back(entry);
             }
         }
-        return ok;
+    }
+
+    // Where a file of a packed backup lies, by the path collectBackup gave it.
+    struct PackedMember {
+        std::string pack;
+        io::FileSpan span;
+    };
+    using PackedMembers = std::unordered_map<std::string, PackedMember>;
+
+    // The files and folders of a backup as collectFiles lists them. The folder
+    // of a stored or packed backup is empty: its listing comes from the
+    // manifest, and each file is sent straight from its object in the store, or
+    // from its span of the pack, which `packed` records.
+    void collectBackup(const std::string& backupPath, std::vector<SendFile>& out, std::vector<std::string>& outDirs, PackedMembers& packed)
+    {
+        Manifest::Contents manifest;
+        if (Manifest::layout(backupPath) == Manifest::Layout::Folder || !Manifest::read(backupPath, manifest)) {
+            collectFiles(backupPath, "", out, &outDirs);
+            return;
+        }
+        const std::string pack = Manifest::packPathFor(backupPath);
+        u64 offset             = 0;
+        for (const Manifest::Entry& entry : manifest.entries) {
+            if (entry.folder) {
+                outDirs.push_back(entry.relPath + "/");
+                continue;
+            }
+            SendFile file;
+            file.relPath = entry.relPath;
+            file.size    = entry.size;
+            if (manifest.layout == Manifest::Layout::Stored) {
+                file.absPath = ObjectStore::objectPath(entry.sha256);
+            }
+            else {
+                file.absPath = backupPath + "/" + entry.relPath;
+                packed.emplace(file.absPath, PackedMember{pack, io::FileSpan{offset, entry.size}});
+                offset += entry.size;
+            }
+            out.push_back(file);
+        }
     }
 
     void ensureDirectoryPath(const std::string& base, const std::string& relPath)
@@ -174,54 +220,14 @@ namespace {
         }
     }
 
-    // Reads a bounded head window off the front of the streamed body so
-    // TransferProto::parseMultipart can locate the parts without scanning the
-    // (large) payload.
-    bool readBodyHead(const std::string& bodyPath, u64 bodyLen, std::string& outHead, std::string& outError)
-    {
-        FILE* f = fopen(bodyPath.c_str(), "rb");
-        if (f == nullptr) {
-            outError = "Failed to open upload body.";
-            return false;
-        }
-        const size_t headWindow = 64 * 1024;
-        size_t headLen          = (size_t)std::min<u64>(headWindow, bodyLen);
-        outHead.resize(headLen);
-        if (headLen > 0 && fread(&outHead[0], 1, headLen, f) != headLen) {
-            fclose(f);
-            outError = "Failed to read upload body.";
-            return false;
-        }
-        fclose(f);
-        return true;
-    }
-
-    // ByteReader over the streamed body, positioned at the file part's start.
-    // TransferProto::extractZip owns the length accounting.
-    struct BodyReader : TransferProto::ByteReader {
-        FILE* input = nullptr;
-        BodyReader(const std::string& path, u64 startOffset)
-        {
-            input = fopen(path.c_str(), "rb");
-            if (input != nullptr && fseek(input, (long)startOffset, SEEK_SET) != 0) {
-                fclose(input);
-                input = nullptr;
-            }
-        }
-        bool good() const { return input != nullptr; }
-        ~BodyReader() override
-        {
-            if (input != nullptr) {
-                fclose(input);
-            }
-        }
-        size_t read(void* dst, size_t n) override { return input != nullptr ? fread(dst, 1, n, input) : 0; }
-    };
-
-    // ExtractSink writing under a destination root via FILE*.
+    // ExtractSink writing under a destination root via FILE*. Remembers the
+    // verified files and the one being written, so an interrupted upload can
+    // be kept for resuming without a half-written file in it.
     struct FileExtractSink : TransferProto::ExtractSink {
         std::string destRoot;
         FILE* output = nullptr;
+        std::string current;
+        std::vector<ManifestEntry> verified;
         explicit FileExtractSink(std::string root) : destRoot(std::move(root)) {}
         bool makeDir(const std::string& relPath) override
         {
@@ -231,10 +237,11 @@ namespace {
             }
             return true;
         }
-        bool beginFile(const std::string& relPath, uint32_t) override
+        bool beginFile(const std::string& relPath, uint64_t) override
         {
             ensureDirectoryPath(destRoot, relPath);
-            output = fopen((destRoot + relPath).c_str(), "wb");
+            current = relPath;
+            output  = fopen((destRoot + relPath).c_str(), "wb");
             return output != nullptr;
         }
         bool writeFile(const void* data, size_t n) override
@@ -249,17 +256,44 @@ namespace {
                 output = nullptr;
             }
         }
+        void fileVerified(const ManifestEntry& entry) override
+        {
+            verified.push_back(entry);
+            current.clear();
+        }
     };
 
-    // FileReader opening backup files via FILE* for the send.
+    // FileReader opening backup files via FILE* for the send. A path listed in
+    // `packed` is read from its span of the pack instead.
     struct StdFileReader : TransferProto::FileReader {
-        FILE* input = nullptr;
+        FILE* input                 = nullptr;
+        const PackedMembers* packed = nullptr;
+        u64 remaining               = 0;
         bool open(const std::string& absPath) override
         {
-            input = fopen(absPath.c_str(), "rb");
+            auto member = packed != nullptr ? packed->find(absPath) : PackedMembers::const_iterator{};
+            if (packed == nullptr || member == packed->end()) {
+                input     = fopen(absPath.c_str(), "rb");
+                remaining = UINT64_MAX;
+                return input != nullptr;
+            }
+            input = fopen(member->second.pack.c_str(), "rb");
+            if (input != nullptr && fseek(input, (long)member->second.span.offset, SEEK_SET) != 0) {
+                fclose(input);
+                input = nullptr;
+            }
+            remaining = member->second.span.length;
             return input != nullptr;
         }
-        size_t read(void* dst, size_t n) override { return input != nullptr ? fread(dst, 1, n, input) : 0; }
+        size_t read(void* dst, size_t n) override
+        {
+            if (input == nullptr) {
+                return 0;
+            }
+            const size_t count = fread(dst, 1, std::min<u64>(n, remaining), input);
+            remaining -= count;
+            return count;
+        }
         void close() override
         {
             if (input != nullptr) {
@@ -277,97 +311,149 @@ namespace {
         nlohmann::json info;
         info["device"]         = "Switch";
         info["version"]        = StringUtils::format("%d.%d.%d", VERSION_MAJOR, VERSION_MINOR, VERSION_MICRO);
-        info["maxUploadBytes"] = 0; // 0 = unlimited: the body is streamed to SD, not buffered in RAM
+        info["maxUploadBytes"] = 0; // 0 = unlimited: the body is extracted as it arrives, not buffered in RAM
         info["freeSpaceBytes"] = 0;
+        // Zip entry methods extractZip reads; a sender only deflates for a
+        // receiver that lists "deflate" here.
+        info["zipMethods"] = {"store", "deflate"};
+        // An interrupted zip upload can be continued (GET /transfer/resume).
+        info["resume"] = true;
+        // Many backups can travel in one zip upload (meta "backups").
+        info["batch"] = true;
         return {200, "application/json", info.dump()};
     }
 
-    // Streaming upload handler: the server has already written the raw multipart
-    // body to `req.bodyPath`. We parse the meta out of the head, resolve the
-    // destination title, then extract the ZIP (or copy the raw file) straight
-    // from the body temp file's file-part byte range.
-    Server::HttpResponse handleUpload(const Server::UploadRequest& req)
+    // Writes the raw (non-zip) file part to `outPath` as it arrives.
+    bool storeFilePart(TransferProto::ByteReader& part, const std::string& outPath, const ProgressFn& onBytes, std::string& outError)
     {
-        auto cleanup = []() { TransferStatus::end(); };
+        FILE* dst = fopen(outPath.c_str(), "wb");
+        if (dst == nullptr) {
+            Logging::error("Failed to open {} to store the received file.", outPath);
+            outError = "Failed to store file";
+            return false;
+        }
+        static const size_t kBuf = 0x40000;
+        std::unique_ptr<u8[]> buf(new u8[kBuf]);
+        u64 written = 0;
+        bool ok     = true;
+        while (true) {
+            if (TransferStatus::cancelRequested()) {
+                outError = "Transfer cancelled.";
+                ok       = false;
+                break;
+            }
+            size_t rd = part.read(buf.get(), kBuf);
+            if (rd == 0) {
+                break;
+            }
+            if (fwrite(buf.get(), 1, rd, dst) != rd) {
+                outError = "Failed to store file";
+                ok       = false;
+                break;
+            }
+            written += rd;
+            if (onBytes) {
+                onBytes(rd);
+            }
+        }
+        fclose(dst);
+        if (ok) {
+            Logging::info("Received {} bytes into {}.", written, outPath);
+        }
+        return ok;
+    }
 
-        std::string token = headerValue(req.headers, "X-CP-Token");
+    // Checks the request's X-CP-Token against the receiver PIN. Every miss
+    // counts toward MAX_AUTH_ATTEMPTS, after which the receiver stops itself.
+    bool authorized(const std::string& headers)
+    {
+        std::string token = headerValue(headers, "X-CP-Token");
         std::string expectedToken;
         {
             std::lock_guard<std::mutex> lock(g_receiverMutex);
             expectedToken = g_token;
         }
-        if (!constantTimeEquals(token, expectedToken)) {
-            cleanup();
-            int attempts = g_failedAuthAttempts.fetch_add(1) + 1;
-            Logging::warning("Rejected upload with invalid token ({}/{} attempts).", attempts, MAX_AUTH_ATTEMPTS);
-            if (attempts >= MAX_AUTH_ATTEMPTS) {
-                setReceiverNotice("Too many invalid PIN attempts; receiver stopped.");
-                Logging::warning("Too many invalid PIN attempts; stopping receiver.");
-                Transfer::stopReceiver();
-            }
-            return {403, "application/json", "{\"ok\":false,\"error\":\"Invalid token\"}"};
-        }
-
-        std::string contentType = headerValue(req.headers, "Content-Type");
-        size_t bpos             = contentType.find("boundary=");
-        if (bpos == std::string::npos) {
-            cleanup();
-            return {400, "application/json", "{\"ok\":false,\"error\":\"Missing boundary\"}"};
+        if (constantTimeEquals(token, expectedToken)) {
+            return true;
         }
-        std::string boundary = contentType.substr(bpos + 9);
-        if (!boundary.empty() && boundary.front() == '"' && boundary.back() == '"') {
-            boundary = boundary.substr(1, boundary.size() - 2);
+        int attempts = g_failedAuthAttempts.fetch_add(1) + 1;
+        Logging::warning("Rejected request with invalid token ({}/{} attempts).", attempts, MAX_AUTH_ATTEMPTS);
+        if (attempts >= MAX_AUTH_ATTEMPTS) {
+            setReceiverNotice("Too many invalid PIN attempts; receiver stopped.");
+            Logging::warning("Too many invalid PIN attempts; stopping receiver.");
+            Transfer::stopReceiver();
         }
+        return false;
+    }
 
-        std::string metaJson;
-        u64 fileOffset = 0;
-        u64 fileLen    = 0;
-        std::string error;
-        std::string head;
-        if (!readBodyHead(req.bodyPath, req.bodyLength, head, error) ||
-            !parseMultipart(head, req.bodyLength, boundary, metaJson, fileOffset, fileLen, error)) {
-            cleanup();
-            return {400, "application/json", "{\"ok\":false,\"error\":\"Bad upload\"}"};
+    // GET /transfer/resume: what is left of the interrupted upload named by the
+    // X-CP-Upload-Id header, for its sender to continue from.
+    Server::HttpResponse handleResume(const std::string&, const std::string& request)
+    {
+        std::string headers = request.substr(0, request.find("\r\n\r\n"));
+        if (!authorized(headers)) {
+            return {403, "application/json", "{\"ok\":false,\"error\":\"Invalid token\"}"};
         }
-
-        auto meta = nlohmann::json::parse(metaJson, nullptr, false);
-        if (meta.is_discarded()) {
-            cleanup();
-            return {400, "application/json", "{\"ok\":false,\"error\":\"Invalid meta\"}"};
+        std::string uploadId = headerValue(headers, "X-CP-Upload-Id");
+        nlohmann::json files = nlohmann::json::array();
+        u64 bytes            = 0;
+        {
+            std::lock_guard<std::mutex> lock(g_receiverMutex);
+            if (!uploadId.empty() && uploadId == g_pendingResume.uploadId) {
+                for (const auto& entry : g_pendingResume.files) {
+                    files.push_back({{"path", entry.relPath}, {"size", entry.size}, {"crc", entry.crc}});
+                    bytes += entry.size;
+                }
+            }
         }
+        nlohmann::json resp;
+        resp["ok"]    = true;
+        resp["bytes"] = bytes;
+        resp["files"] = files;
+        return {200, "application/json", resp.dump()};
+    }
 
+    // Where a received backup goes: the folder of the installed title the meta
+    // (or a batch entry of it) names, falling back to the title the Receive row
+    // was opened from and then to a folder named after the sender's title.
+    struct Destination {
+        std::string backupName;
+        std::string backupRoot; // with a trailing slash
+        u64 resolvedId     = 0;
+        bool foundTitle    = false;
+        bool mappedByGuess = false;
+    };
+
+    Destination resolveDestination(const nlohmann::json& meta)
+    {
         std::string titleId    = meta.value("titleId", "");
         std::string titleName  = meta.value("titleName", "Unknown");
         std::string backupName = meta.value("backupName", "");
-        bool isZip             = meta.value("isZip", false);
-        setReceiverNotice("");
         if (backupName.empty()) {
             backupName = "Received_" + DateTime::dateTimeStr();
         }
 
         std::string destRoot;
-        bool foundTitle    = false;
-        bool mappedByGuess = false;
-        u64 tid            = 0;
-        u64 resolvedId     = 0;
+        Destination out;
+        u64 tid = 0;
         if (!titleId.empty()) {
             tid = strtoull(titleId.c_str(), nullptr, 16);
         }
         if (tid != 0) {
             Title t;
             if (TitleCatalog::get().getTitleById(t, tid)) {
-                destRoot   = t.path();
-                resolvedId = t.id();
-                foundTitle = true;
+                destRoot       = t.path();
+                out.resolvedId = t.id();
+                out.foundTitle = true;
             }
         }
-        if (!foundTitle && !titleName.empty()) {
+        if (!out.foundTitle && !titleName.empty()) {
             Title t;
             if (TitleCatalog::get().getTitleByName(t, titleName)) {
-                destRoot      = t.path();
-                resolvedId    = t.id();
-                foundTitle    = true;
-                mappedByGuess = true;
+                destRoot          = t.path();
+                out.resolvedId    = t.id();
+                out.foundTitle    = true;
+                out.mappedByGuess = true;
                 // A sender with no title id at all is the normal case, not a mismatch.
                 setReceiverNotice(tid != 0 ? "Warning: title ID mismatch. Backup mapped by title name." : "Note: backup mapped by title name.");
                 Logging::warning("Title ID {} not found, mapped by title name '{}'.", titleId, titleName);
@@ -376,7 +462,7 @@ namespace {
         // Last resort: the title the user had open when they started the receiver.
         // Its backup list is where the Receive row lives, so it is the destination
         // they pointed at, and it beats stranding the backup in an "Unknown" folder.
-        if (!foundTitle) {
+        if (!out.foundTitle) {
             u64 selectedId = 0;
             {
                 std::lock_guard<std::mutex> lock(g_receiverMutex);
@@ -384,17 +470,17 @@ namespace {
             }
             Title t;
             if (selectedId != 0 && TitleCatalog::get().getTitleById(t, selectedId)) {
-                destRoot      = t.path();
-                resolvedId    = t.id();
-                foundTitle    = true;
-                mappedByGuess = true;
+                destRoot          = t.path();
+                out.resolvedId    = t.id();
+                out.foundTitle    = true;
+                out.mappedByGuess = true;
                 setReceiverNotice("Note: sender did not identify the title.\nStored under " + t.name() + ".");
                 Logging::warning("Sender identified no installed title (id '{}', name '{}'); stored under the selected title {:016X}.", titleId,
                     titleName, selectedId);
             }
         }
 
-        if (!foundTitle) {
+        if (!out.foundTitle) {
             std::string safeName = titleName.empty() ? "Unknown" : titleName;
             std::string folder   = safeName;
             if (!titleId.empty()) {
@@ -408,101 +494,302 @@ namespace {
             Logging::warning("Received backup for unknown title {} (stored under {}).", titleId, destRoot);
         }
 
-        std::string backupRoot = destRoot + "/" + StringUtils::removeForbiddenCharacters(backupName) + "/";
-        if (io::directoryExists(backupRoot)) {
-            io::deleteFolderRecursively(backupRoot);
+        out.backupName = backupName;
+        out.backupRoot = destRoot + "/" + StringUtils::removeForbiddenCharacters(backupName) + "/";
+        return out;
+    }
+
+    // Streaming upload handler: the multipart body is parsed straight off the
+    // socket. The meta part names the destination title; the file part is then
+    // extracted (or, for a single raw file, copied) into RECV_STAGING as it
+    // arrives and only swapped into the backup folder once the body closed
+    // cleanly, so every received byte touches the SD card exactly once.
+    Server::HttpResponse handleUpload(Server::UploadRequest& req)
+    {
+        auto cleanup = []() { TransferStatus::end(); };
+
+        if (!authorized(req.headers)) {
+            cleanup();
+            return {403, "application/json", "{\"ok\":false,\"error\":\"Invalid token\"}"};
         }
-        io::createDirectory(backupRoot);
 
-        if (isZip) {
-            TransferStatus::beginNetwork("Extracting package", fileLen);
-            std::string extractError;
-            BodyReader reader(req.bodyPath, fileOffset);
-            FileExtractSink sink(backupRoot);
-            bool extracted = reader.good() && extractZip(
-                                                  reader, fileLen, sink, []() { return TransferStatus::cancelRequested(); },
-                                                  [](size_t n) { TransferStatus::addBytesDone(n); }, extractError);
-            if (!reader.good() && extractError.empty()) {
-                extractError = "Failed to open received package.";
-            }
-            if (!extracted) {
-                // A failed (or cancelled) extract leaves a half-populated backup
-                // folder behind; remove it so the receiver never keeps a backup
-                // it can't trust.
-                io::deleteFolderRecursively(backupRoot);
+        std::string contentType = headerValue(req.headers, "Content-Type");
+        size_t bpos             = contentType.find("boundary=");
+        if (bpos == std::string::npos) {
+            cleanup();
+            return {400, "application/json", "{\"ok\":false,\"error\":\"Missing boundary\"}"};
+        }
+        std::string boundary = contentType.substr(bpos + 9);
+        if (!boundary.empty() && boundary.front() == '"' && boundary.back() == '"') {
+            boundary = boundary.substr(1, boundary.size() - 2);
+        }
+
+        MultipartReader parts(req.body, boundary);
+        std::string metaJson;
+        std::string error;
+        if (!beginUpload(parts, metaJson, error)) {
+            cleanup();
+            Logging::error("Rejected upload: {}", error);
+            return {400, "application/json", "{\"ok\":false,\"error\":\"Bad upload\"}"};
+        }
+
+        auto meta = nlohmann::json::parse(metaJson, nullptr, false);
+        if (meta.is_discarded()) {
+            cleanup();
+            return {400, "application/json", "{\"ok\":false,\"error\":\"Invalid meta\"}"};
+        }
+
+        bool isZip = meta.value("isZip", false);
+        setReceiverNotice("");
+
+        // A batch names one destination per backup it carries, each resolved
+        // on its own; staging/<index> then holds that backup's files.
+        bool batch = meta.contains("backups");
+        std::vector<Destination> targets;
+        if (batch) {
+            if (!isZip || !meta["backups"].is_array() || meta["backups"].empty()) {
                 cleanup();
-                std::string message = extractError.empty() ? "Failed to extract package." : extractError;
-                nlohmann::json err;
-                err["ok"]    = false;
-                err["error"] = message;
-                return {500, "application/json", err.dump()};
+                return {400, "application/json", "{\"ok\":false,\"error\":\"Invalid batch\"}"};
+            }
+            for (const auto& entry : meta["backups"]) {
+                if (!entry.is_object()) {
+                    cleanup();
+                    return {400, "application/json", "{\"ok\":false,\"error\":\"Invalid batch\"}"};
+                }
+                targets.push_back(resolveDestination(entry));
+            }
+            // Two entries for one backup would commit into the same folder, the
+            // later silently replacing the earlier.
+            std::set<std::string> roots;
+            for (const auto& target : targets) {
+                if (!roots.insert(target.backupRoot).second) {
+                    cleanup();
+                    Logging::error("Rejected a batch that names {} twice.", target.backupRoot);
+                    return {400, "application/json", "{\"ok\":false,\"error\":\"Duplicate backup in batch\"}"};
+                }
+            }
+        }
+        else {
+            targets.push_back(resolveDestination(meta));
+        }
+        const std::string& backupName = targets.front().backupName;
+        const std::string& backupRoot = targets.front().backupRoot;
+        std::string stagingRoot       = std::string(RECV_STAGING) + "/";
+        std::string uploadId          = batch ? "" : meta.value("uploadId", "");
+
+        // A continuation of the interrupted upload keeps the staged files its
+        // sender confirmed unchanged and drops the rest; anything else starts
+        // from an empty staging folder. The pending state is consumed either way.
+        PendingResume pending;
+        {
+            std::lock_guard<std::mutex> lock(g_receiverMutex);
+            std::swap(pending, g_pendingResume);
+        }
+        std::vector<ManifestEntry> resumed;
+        bool resuming = isZip && !uploadId.empty() && uploadId == pending.uploadId && backupRoot == pending.backupRoot &&
+                        meta.contains("resume") && meta["resume"].is_array();
+        // The sender left every file its resume list names out of this upload.
+        // When they are not all still staged (the receiver restarted, another
+        // upload took the pending state, or this one goes elsewhere) the backup
+        // would be committed without them, so the upload is turned down before
+        // staging or the existing backup is touched, and the sender starts over.
+        const bool wantsResume = meta.contains("resume") && meta["resume"].is_array() && !meta["resume"].empty();
+
+        auto refuseResume = [&](const char* why) -> Server::HttpResponse {
+            {
+                std::lock_guard<std::mutex> lock(g_receiverMutex);
+                if (g_pendingResume.uploadId.empty()) {
+                    g_pendingResume = std::move(pending);
+                }
+            }
+            cleanup();
+            Logging::warning("Refused to resume upload {}: {}", uploadId, why);
+            return {409, "application/json", "{\"ok\":false,\"error\":\"Cannot resume upload\"}"};
+        };
+        if (wantsResume && !resuming) {
+            return refuseResume("its staged files are gone.");
+        }
+        if (resuming) {
+            auto key = [](const std::string& path, u64 size, u32 crc) {
+                return StringUtils::format("%s|%llu|%08X", path.c_str(), (unsigned long long)size, crc);
+            };
+            std::set<std::string> staged;
+            for (const auto& entry : pending.files) {
+                staged.insert(key(entry.relPath, entry.size, entry.crc));
+            }
+            std::set<std::string> confirmed;
+            for (const auto& entry : meta["resume"]) {
+                if (!entry.is_object() || !entry.contains("path") || !entry["path"].is_string()) {
+                    return refuseResume("its resume list is malformed.");
+                }
+                std::string confirmedKey = key(entry["path"].get<std::string>(), entry.value("size", (u64)0), entry.value("crc", (u32)0));
+                if (staged.count(confirmedKey) == 0) {
+                    return refuseResume("a file it left out is not staged.");
+                }
+                confirmed.insert(confirmedKey);
+            }
+            for (const auto& entry : pending.files) {
+                if (confirmed.count(key(entry.relPath, entry.size, entry.crc)) != 0) {
+                    resumed.push_back(entry);
+                }
+                else {
+                    std::remove((stagingRoot + entry.relPath).c_str());
+                }
+            }
+            Logging::info("Resuming upload {} with {} of its files already received.", uploadId, resumed.size());
+        }
+        else {
+            if (io::directoryExists(RECV_STAGING)) {
+                io::deleteFolderRecursively(RECV_STAGING);
+            }
+            io::createDirectory(RECV_STAGING);
+            for (size_t i = 0; batch && i < targets.size(); i++) {
+                io::createDirectory(stagingRoot + std::to_string(i));
+            }
+        }
+
+        // A chunked body has no length for the server to measure progress
+        // against; the payload size the meta announces stands in for it.
+        ProgressFn onBytes;
+        if (req.bodyLength == UINT64_MAX) {
+            TransferStatus::setBytes(0, meta.value("fileBytesTotal", (u64)0));
+            onBytes = [](size_t n) { TransferStatus::addBytesDone(n); };
+        }
+
+        std::string receiveError;
+        bool received = false;
+        if (isZip) {
+            FileExtractSink sink(stagingRoot);
+            received = extractZip(parts, UINT64_MAX, sink, []() { return TransferStatus::cancelRequested(); }, onBytes, receiveError);
+            received = received && endUpload(parts, receiveError);
+            // A zip upload that broke off (not one the user cancelled) leaves
+            // its verified files staged for the sender to resume from.
+            if (!received && !uploadId.empty() && !TransferStatus::cancelRequested()) {
+                if (!sink.current.empty()) {
+                    std::remove((stagingRoot + sink.current).c_str());
+                }
+                resumed.insert(resumed.end(), sink.verified.begin(), sink.verified.end());
+                std::lock_guard<std::mutex> lock(g_receiverMutex);
+                g_pendingResume = PendingResume{uploadId, backupRoot, std::move(resumed)};
             }
-            TransferStatus::setBytesDone(fileLen);
         }
         else {
             std::string safeFileName = sanitizeFileName(meta.value("fileName", ""));
             if (safeFileName.empty()) {
                 safeFileName = "received.bin";
             }
-            std::string outPath = backupRoot + safeFileName;
+            received = storeFilePart(parts, stagingRoot + safeFileName, onBytes, receiveError);
+            received = received && endUpload(parts, receiveError);
+        }
 
-            FILE* src = fopen(req.bodyPath.c_str(), "rb");
-            FILE* dst = fopen(outPath.c_str(), "wb");
-            if (src == nullptr || dst == nullptr) {
-                if (src) {
-                    fclose(src);
+        // Only a complete, verified backup replaces one of the same name. The
+        // one it replaces is moved aside and deleted only once the new one is in
+        // place, so a move that fails leaves it as it was. `stored` counts the
+        // targets committed before the first failure.
+        size_t stored     = 0;
+        bool commitFailed = false;
+        for (; received && stored < targets.size(); stored++) {
+            const std::string& root = targets[stored].backupRoot;
+            std::string stagedPath  = batch ? stagingRoot + std::to_string(stored) : std::string(RECV_STAGING);
+            std::string finalPath   = root.substr(0, root.size() - 1);
+            std::string asidePath   = finalPath + ".replaced";
+            const bool replacing    = io::directoryExists(root);
+            if (replacing) {
+                if (io::directoryExists(asidePath)) {
+                    io::deleteFolderRecursively(asidePath);
                 }
-                if (dst) {
-                    fclose(dst);
-                }
-                Logging::error("Failed to open {} to store the received file.", outPath);
-                io::deleteFolderRecursively(backupRoot);
-                cleanup();
-                return {500, "application/json", "{\"ok\":false,\"error\":\"Failed to store file\"}"};
-            }
-            fseek(src, (long)fileOffset, SEEK_SET);
-            static const size_t kBuf = 0x40000;
-            std::unique_ptr<u8[]> buf(new u8[kBuf]);
-            u64 remaining = fileLen;
-            bool copyOk   = true;
-            while (remaining > 0) {
-                if (TransferStatus::cancelRequested()) {
-                    copyOk = false;
+                if (rename(finalPath.c_str(), asidePath.c_str()) != 0) {
+                    Logging::error("Failed to move {} aside with errno {}.", finalPath, errno);
+                    commitFailed = true;
                     break;
                 }
-                size_t chunk = remaining > kBuf ? kBuf : (size_t)remaining;
-                size_t rd    = fread(buf.get(), 1, chunk, src);
-                if (rd == 0) {
-                    copyOk = false;
-                    break;
+            }
+            if (rename(stagedPath.c_str(), finalPath.c_str()) != 0) {
+                Logging::error("Failed to move the received backup into {} with errno {}.", finalPath, errno);
+                if (replacing && rename(asidePath.c_str(), finalPath.c_str()) != 0) {
+                    Logging::error("Failed to move {} back; the previous backup is kept there.", asidePath);
                 }
-                fwrite(buf.get(), 1, rd, dst);
-                remaining -= rd;
-            }
-            fclose(src);
-            fclose(dst);
-            if (!copyOk) {
-                Logging::error("Failed to store the received file {} ({} of {} bytes missing).", outPath, remaining, (u64)fileLen);
-                io::deleteFolderRecursively(backupRoot);
-                cleanup();
-                return {500, "application/json", "{\"ok\":false,\"error\":\"Failed to store file\"}"};
+                commitFailed = true;
+                break;
+            }
+            if (replacing) {
+                io::deleteFolderRecursively(asidePath);
+            }
+            // What arrives carries no manifest, and the replaced backup's would
+            // describe the wrong files.
+            if (replacing && Manifest::layout(root) == Manifest::Layout::Stored) {
+                g_releasedObjects.store(true);
             }
-            Logging::info("Received {} bytes into {}.", (u64)fileLen, outPath);
+            Manifest::discard(root);
+        }
+        if (commitFailed) {
+            received     = false;
+            receiveError = stored == 0 ? "Failed to store the received backup."
+                                       : "Stored " + std::to_string(stored) + " of " + std::to_string(targets.size()) +
+                                             " backups; failed to store " + targets[stored].backupName + ".";
+        }
+        if (received && batch) {
+            io::deleteFolderRecursively(RECV_STAGING);
+        }
+        if (!received) {
+            bool keep = false;
+            {
+                std::lock_guard<std::mutex> lock(g_receiverMutex);
+                keep = !g_pendingResume.uploadId.empty();
+            }
+            if (!keep) {
+                io::deleteFolderRecursively(RECV_STAGING);
+            }
+            cleanup();
+            std::string message = receiveError.empty() ? "Failed to extract package." : receiveError;
+            Logging::error("Failed to receive backup {}: {}", backupName, message);
+            nlohmann::json err;
+            err["ok"]    = false;
+            err["error"] = message;
+            // A batch that failed part way through its commit keeps the backups
+            // already moved into place; say which, and show them.
+            if (stored > 0) {
+                err["savedPaths"] = nlohmann::json::array();
+                std::lock_guard<std::mutex> lock(g_completedMutex);
+                for (size_t i = 0; i < stored; i++) {
+                    err["savedPaths"].push_back(targets[i].backupRoot);
+                    if (targets[i].resolvedId != 0) {
+                        g_completedTitleIds.push_back(targets[i].resolvedId);
+                    }
+                }
+                g_pendingRefresh.store(true);
+            }
+            return {500, "application/json", err.dump()};
         }
 
         cleanup();
 
-        if (!mappedByGuess && foundTitle) {
+        bool clean = true;
+        {
+            std::lock_guard<std::mutex> lock(g_completedMutex);
+            for (const auto& target : targets) {
+                clean = clean && target.foundTitle && !target.mappedByGuess;
+                if (target.resolvedId != 0) {
+                    g_completedTitleIds.push_back(target.resolvedId);
+                }
+            }
+        }
+        if (clean) {
             setReceiverNotice("");
         }
-        setReceiverCompletedName(backupName);
-        g_completedTitleId.store(resolvedId);
+        setReceiverCompletedName(batch ? i18n::t("transfer.received_batch", {std::to_string(targets.size())}) : backupName);
         g_receiverCompleted.store(true);
         g_pendingRefresh.store(true);
 
         nlohmann::json resp;
         resp["ok"]        = true;
         resp["savedPath"] = backupRoot;
+        if (batch) {
+            resp["savedPaths"] = nlohmann::json::array();
+            for (const auto& target : targets) {
+                resp["savedPaths"].push_back(target.backupRoot);
+            }
+        }
         return {200, "application/json", resp.dump()};
     }
 
@@ -513,6 +800,11 @@ namespace {
     // so we keep the socket non-blocking and bound every wait with poll().
     constexpr int NET_TIMEOUT_MS = 15000;
 
+    // A dropped upload is resumed this many times, each after a pause that
+    // gives the Wi-Fi a moment to come back.
+    constexpr int RESUME_ATTEMPTS = 3;
+    constexpr int RESUME_DELAY_MS = 2000;
+
     // Waits up to timeoutMs for `events` on sock. Returns 1 if ready, 0 on
     // timeout, -1 on error.
     int pollSocket(int sock, short events, int timeoutMs)
@@ -548,13 +840,377 @@ namespace {
         explicit SocketByteSink(int s) : sock(s) {}
         bool sendAll(const void* data, size_t len) override { return ::sendAll(sock, data, len); }
     };
+
+    // Opens a TCP connection to ip:port. The socket stays non-blocking for its
+    // whole lifetime; every send/recv on it is poll-gated so a half-open peer
+    // can't block forever. Returns -1 with `outStage` set on failure.
+    int connectTo(const std::string& ip, u16 port, Transfer::SendStage& outStage)
+    {
+        int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+        if (sock < 0) {
+            outStage = Transfer::SendStage::Socket;
+            return -1;
+        }
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port   = htons(port);
+        if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
+            close(sock);
+            outStage = Transfer::SendStage::Resolve;
+            return -1;
+        }
+        if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            // Bounded wait for the connection to complete, then confirm via SO_ERROR.
+            int soErr        = 0;
+            socklen_t optLen = sizeof(soErr);
+            if (errno != EINPROGRESS || pollSocket(sock, POLLOUT, NET_TIMEOUT_MS) <= 0 ||
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &soErr, &optLen) != 0 || soErr != 0) {
+                close(sock);
+                outStage = Transfer::SendStage::Connect;
+                return -1;
+            }
+        }
+        return sock;
+    }
+
+    // Reads the receiver's reply until it closes the connection (every request
+    // here is "Connection: close") or goes silent.
+    std::string readResponse(int sock)
+    {
+        std::string response;
+        char responseBuf[512];
+        while (true) {
+            if (pollSocket(sock, POLLIN, NET_TIMEOUT_MS) <= 0) {
+                break; // timeout or error: stop waiting on a silent peer
+            }
+            int rc = recv(sock, responseBuf, sizeof(responseBuf), 0);
+            if (rc <= 0) {
+                break;
+            }
+            response.append(responseBuf, (size_t)rc);
+        }
+        return response;
+    }
+
+    // Body of a "Connection: close" reply, parsed as JSON; discarded unless the
+    // status is 200.
+    nlohmann::json responseJson(const std::string& response)
+    {
+        size_t bodyPos = response.find("\r\n\r\n");
+        if (response.rfind("HTTP/1.1 200", 0) != 0 || bodyPos == std::string::npos) {
+            return nlohmann::json(nlohmann::json::value_t::discarded);
+        }
+        return nlohmann::json::parse(response.substr(bodyPos + 4), nullptr, false);
+    }
+
+    // What the receiver's GET /transfer/info offers beyond the plain store-only
+    // upload every version understands. A receiver that predates a feature
+    // omits its key, and one that does not answer at all fails the upload on
+    // its own; either way the plain upload is what it gets.
+    struct ReceiverInfo {
+        bool deflate = false; // "zipMethods" lists "deflate"
+        bool delta   = false; // POST /transfer/manifest is served
+        bool resume  = false; // GET /transfer/resume is served
+        bool batch   = false; // an upload may carry many backups
+    };
+
+    ReceiverInfo fetchReceiverInfo(const std::string& ip, u16 port)
+    {
+        ReceiverInfo out;
+        Transfer::SendStage stage;
+        int sock = connectTo(ip, port, stage);
+        if (sock < 0) {
+            return out;
+        }
+        std::string request  = StringUtils::format("GET /transfer/info HTTP/1.1\r\nHost: %s:%d\r\nConnection: close\r\n\r\n", ip.c_str(), port);
+        std::string response = sendAll(sock, request.data(), request.size()) ? readResponse(sock) : "";
+        close(sock);
+
+        auto info = responseJson(response);
+        if (info.is_discarded() || !info.is_object()) {
+            return out;
+        }
+        if (info.contains("zipMethods") && info["zipMethods"].is_array()) {
+            for (const auto& method : info["zipMethods"]) {
+                if (method.is_string() && method.get<std::string>() == "deflate") {
+                    out.deflate = true;
+                }
+            }
+        }
+        out.delta  = info.contains("delta") && info["delta"].is_boolean() && info["delta"].get<bool>();
+        out.resume = info.contains("resume") && info["resume"].is_boolean() && info["resume"].get<bool>();
+        out.batch  = info.contains("batch") && info["batch"].is_boolean() && info["batch"].get<bool>();
+        return out;
+    }
+
+    // Posts a delta-transfer manifest (see TransferProto::ManifestEntry) and
+    // returns the paths the receiver already holds. Any failure yields an empty
+    // set, which only costs sending those files after all.
+    std::set<std::string> receiverHeldFiles(const std::string& ip, u16 port, const std::string& token, const nlohmann::json& manifest)
+    {
+        std::set<std::string> held;
+        Transfer::SendStage stage;
+        int sock = connectTo(ip, port, stage);
+        if (sock < 0) {
+            return held;
+        }
+        std::string body   = manifest.dump();
+        std::string header = StringUtils::format("POST /transfer/manifest HTTP/1.1\r\nHost: %s:%d\r\nConnection: close\r\n", ip.c_str(), port);
+        header += StringUtils::format("X-CP-Token: %s\r\n", token.c_str());
+        header += StringUtils::format("Content-Type: application/json\r\nContent-Length: %zu\r\n\r\n", body.size());
+        bool sent            = sendAll(sock, header.data(), header.size()) && sendAll(sock, body.data(), body.size());
+        std::string response = sent ? readResponse(sock) : "";
+        close(sock);
+
+        auto reply = responseJson(response);
+        if (reply.is_discarded() || !reply.is_object() || !reply.contains("have") || !reply["have"].is_array()) {
+            return held;
+        }
+        for (const auto& path : reply["have"]) {
+            if (path.is_string()) {
+                held.insert(path.get<std::string>());
+            }
+        }
+        return held;
+    }
+
+    // Asks the receiver which files of the interrupted upload `uploadId` it
+    // kept. Any failure yields none, and the retry resends the whole backup.
+    std::vector<ManifestEntry> receiverKeptFiles(const std::string& ip, u16 port, const std::string& token, const std::string& uploadId)
+    {
+        std::vector<ManifestEntry> kept;
+        Transfer::SendStage stage;
+        int sock = connectTo(ip, port, stage);
+        if (sock < 0) {
+            return kept;
+        }
+        std::string request = StringUtils::format("GET /transfer/resume HTTP/1.1\r\nHost: %s:%d\r\nConnection: close\r\n", ip.c_str(), port);
+        request += StringUtils::format("X-CP-Token: %s\r\nX-CP-Upload-Id: %s\r\n\r\n", token.c_str(), uploadId.c_str());
+        std::string response = sendAll(sock, request.data(), request.size()) ? readResponse(sock) : "";
+        close(sock);
+
+        auto reply = responseJson(response);
+        if (reply.is_discarded() || !reply.is_object() || !reply.contains("files") || !reply["files"].is_array()) {
+            return kept;
+        }
+        for (const auto& entry : reply["files"]) {
+            if (entry.is_object() && entry.contains("path") && entry["path"].is_string()) {
+                kept.push_back(ManifestEntry{entry["path"].get<std::string>(), entry.value("size", (u64)0), entry.value("crc", (u32)0)});
+            }
+        }
+        return kept;
+    }
+
+    // Payload of one POST /transfer/upload: a zip of the files, streamed as
+    // sendZipStream writes it, or the backup's single file as is.
+    struct UploadPayload {
+        bool isZip   = false;
+        bool deflate = false;
+        std::vector<SendFile> files;
+        std::vector<std::string> dirs;
+        // The spans of the packed backups among `files`, when there are any.
+        const PackedMembers* packed = nullptr;
+        std::string path;
+        std::string name;
+        u64 size = 0;
+    };
+
+    // Fills in the payload's path, name and size from its files.
+    void sizePayload(UploadPayload& payload)
+    {
+        if (!payload.isZip) {
+            const SendFile& entry = payload.files.front();
+            payload.path          = entry.absPath;
+            payload.name          = entry.relPath;
+            payload.size          = entry.size;
+            return;
+        }
+        // The store-only zip's exact size is known upfront. Saves are mostly
+        // padding and zeroed slots, though, so they deflate severalfold, and
+        // over Wi-Fi the bytes on the air, not the SD card, set the pace. The
+        // deflated zip has no size until it has been written, so it goes out as
+        // a chunked body, which only a receiver that advertises deflate can
+        // read. Progress then counts the backup's own bytes, which is also what
+        // the meta announces.
+        payload.name = "backup.zip";
+        if (payload.deflate) {
+            payload.size = 0;
+            for (const auto& entry : payload.files) {
+                payload.size += entry.size;
+            }
+        }
+        else {
+            payload.size = zipStreamSize(payload.files, payload.dirs);
+        }
+    }
+
+    // Sends one upload and reads the receiver's verdict. outDropped reports a
+    // connection that broke off without any reply, the case a resume retries;
+    // outResumeRefused a receiver that no longer holds what a resume relies on
+    // (409), the case that calls for the whole upload again.
+    Transfer::SendOutcome postUpload(const std::string& ip, u16 port, const std::string& token, const nlohmann::json& meta,
+        const UploadPayload& payload, bool& outDropped, bool* outResumeRefused = nullptr)
+    {
+        outDropped = false;
+        if (outResumeRefused != nullptr) {
+            *outResumeRefused = false;
+        }
+
+        std::string metaStr  = meta.dump();
+        std::string boundary = StringUtils::format("----checkpoint-boundary-%llu", (unsigned long long)time(nullptr));
+
+        std::string partMeta = "--" + boundary +
+                               "\r\n"
+                               "Content-Disposition: form-data; name=\"meta\"\r\n"
+                               "Content-Type: application/json\r\n\r\n" +
+                               metaStr + "\r\n";
+
+        std::string fileName = payload.name;
+        size_t slashPos      = fileName.find_last_of('/');
+        if (slashPos != std::string::npos) {
+            fileName = fileName.substr(slashPos + 1);
+        }
+        if (fileName.empty()) {
+            fileName = "backup.bin";
+        }
+        std::string partFileHeader = "--" + boundary +
+                                     "\r\n"
+                                     "Content-Disposition: form-data; name=\"file\"; filename=\"" +
+                                     fileName +
+                                     "\"\r\n"
+                                     "Content-Type: application/octet-stream\r\n\r\n";
+
+        std::string partEnd = "\r\n--" + boundary + "--\r\n";
+
+        u64 contentLength = (u64)partMeta.size() + partFileHeader.size() + payload.size + partEnd.size();
+
+        Transfer::SendStage connectStage = Transfer::SendStage::Connect;
+        int sock                         = connectTo(ip, port, connectStage);
+        if (sock < 0) {
+            return Transfer::SendOutcome{false, connectStage, ""};
+        }
+
+        struct SockGuard {
+            int fd;
+            ~SockGuard() { close(fd); }
+        } sockGuard{sock};
+
+        std::string header = StringUtils::format("POST /transfer/upload HTTP/1.1\r\nHost: %s:%d\r\nConnection: close\r\n", ip.c_str(), port);
+        header += StringUtils::format("X-CP-Token: %s\r\n", token.c_str());
+        header += StringUtils::format("Content-Type: multipart/form-data; boundary=%s\r\n", boundary.c_str());
+        header += payload.deflate ? std::string("Transfer-Encoding: chunked\r\n\r\n")
+                                  : StringUtils::format("Content-Length: %llu\r\n\r\n", (unsigned long long)contentLength);
+
+        SocketByteSink socketSink(sock);
+        ChunkedSink chunkedSink(socketSink);
+        ByteSink& body = payload.deflate ? static_cast<ByteSink&>(chunkedSink) : socketSink;
+
+        bool ok = sendAll(sock, header.data(), header.size()) && body.sendAll(partMeta.data(), partMeta.size()) &&
+                  body.sendAll(partFileHeader.data(), partFileHeader.size());
+
+        if (ok && payload.isZip) {
+            // The SD card and the socket each sustain about the same rate, so
+            // reading the next chunks on a thread of their own while this one
+            // sends nearly doubles the store-only throughput.
+            bool cancelled = false;
+            StdFileReader reader;
+            reader.packed = payload.packed;
+            ReadAheadReader ahead(reader, payload.files);
+            std::thread producer([&ahead]() { ahead.produce(); });
+            bool sent = sendZipStream(body, payload.files, payload.dirs, ahead, payload.deflate ? ZipMethod::Deflate : ZipMethod::Store,
+                []() { return TransferStatus::cancelRequested(); }, [](size_t n) { TransferStatus::addBytesDone(n); }, cancelled);
+            ahead.stop();
+            producer.join();
+            if (!sent) {
+                if (cancelled) {
+                    // The scope guard closes the socket, dropping the connection,
+                    // which the receiver treats as an aborted request.
+                    return Transfer::SendOutcome{false, Transfer::SendStage::Cancelled, ""};
+                }
+                ok = false;
+            }
+        }
+        else if (ok) {
+            StdFileReader input;
+            input.packed = payload.packed;
+            if (!input.open(payload.path)) {
+                ok = false;
+            }
+            else {
+                static const size_t kBuf = 0x40000;
+                std::unique_ptr<u8[]> buf(new u8[kBuf]);
+                while (true) {
+                    if (TransferStatus::cancelRequested()) {
+                        input.close();
+                        // The scope guard closes the socket, dropping the connection,
+                        // which the receiver treats as an aborted request.
+                        return Transfer::SendOutcome{false, Transfer::SendStage::Cancelled, ""};
+                    }
+                    size_t rd = input.read(buf.get(), kBuf);
+                    if (rd == 0) {
+                        break;
+                    }
+                    if (!body.sendAll(buf.get(), rd)) {
+                        ok = false;
+                        break;
+                    }
+                    TransferStatus::addBytesDone(rd);
+                }
+                input.close();
+            }
+        }
+
+        if (ok) {
+            ok = body.sendAll(partEnd.data(), partEnd.size()) && (!payload.deflate || chunkedSink.finish());
+        }
+
+        std::string response = readResponse(sock);
+        outDropped           = response.empty() && !TransferStatus::cancelRequested();
+        if (outResumeRefused != nullptr) {
+            *outResumeRefused = response.rfind("HTTP/1.1 409", 0) == 0 || response.rfind("HTTP/1.0 409", 0) == 0;
+        }
+
+        if (!ok) {
+            return Transfer::SendOutcome{
+                false, TransferStatus::cancelRequested() ? Transfer::SendStage::Cancelled : Transfer::SendStage::Send, ""};
+        }
+
+        bool httpOk = response.rfind("HTTP/1.1 200", 0) == 0 || response.rfind("HTTP/1.0 200", 0) == 0;
+        if (!httpOk) {
+            std::string detail;
+            if (!response.empty()) {
+                size_t bodyPos = response.find("\r\n\r\n");
+                if (bodyPos != std::string::npos && bodyPos + 4 < response.size()) {
+                    std::string body = response.substr(bodyPos + 4);
+                    auto j           = nlohmann::json::parse(body, nullptr, false);
+                    if (!j.is_discarded() && j.contains("error") && j["error"].is_string()) {
+                        detail = j["error"].get<std::string>();
+                    }
+                }
+                if (detail.empty()) {
+                    size_t lineEnd = response.find("\r\n");
+                    detail         = lineEnd == std::string::npos ? response : response.substr(0, lineEnd);
+                }
+            }
+            return Transfer::SendOutcome{false, Transfer::SendStage::Response, detail};
+        }
+
+        return Transfer::SendOutcome{true, Transfer::SendStage::Response, ""};
+    }
 }
 
 void Transfer::sweepTempFiles(void)
 {
-    if (io::fileExists(TEMP_UPLOAD)) {
-        std::remove(TEMP_UPLOAD);
-        Logging::info("Removed leftover {} from a previous run.", TEMP_UPLOAD);
+    if (io::fileExists(TEMP_UPLOAD_LEGACY)) {
+        std::remove(TEMP_UPLOAD_LEGACY);
+        Logging::info("Removed leftover {} from a previous run.", TEMP_UPLOAD_LEGACY);
+    }
+    if (io::directoryExists(RECV_STAGING)) {
+        io::deleteFolderRecursively(RECV_STAGING);
+        Logging::info("Removed leftover {} from an interrupted receive.", RECV_STAGING);
     }
 
     Directory dir(CHECKPOINT_ROOT);
@@ -603,7 +1259,10 @@ bool Transfer::startReceiver(std::string& outError, u64 selectedTitleId)
     setReceiverNotice("");
     setReceiverCompletedName("");
     g_receiverCompleted.store(false);
-    g_completedTitleId.store(0);
+    {
+        std::lock_guard<std::mutex> lock(g_completedMutex);
+        g_completedTitleIds.clear();
+    }
     size_t pos = ip.find("://");
     if (pos != std::string::npos) {
         ip = ip.substr(pos + 3);
@@ -621,10 +1280,12 @@ bool Transfer::startReceiver(std::string& outError, u64 selectedTitleId)
         g_receiverIp            = ip;
         g_receiverPort          = TRANSFER_PORT;
         g_receiverSelectedTitle = selectedTitleId;
+        g_pendingResume         = PendingResume();
     }
 
     Server::registerHandler("/transfer/info", handleInfo);
-    Server::registerUploadHandler("/transfer/upload", TEMP_UPLOAD, handleUpload);
+    Server::registerHandler("/transfer/resume", handleResume);
+    Server::registerUploadHandler("/transfer/upload", handleUpload);
 
     {
         std::lock_guard<std::mutex> lock(g_receiverMutex);
@@ -643,6 +1304,7 @@ void Transfer::stopReceiver(void)
         }
     }
     Server::unregisterHandler("/transfer/info");
+    Server::unregisterHandler("/transfer/resume");
     Server::unregisterHandler("/transfer/upload");
     {
         std::lock_guard<std::mutex> lock(g_receiverMutex);
@@ -662,9 +1324,17 @@ bool Transfer::consumePendingRefresh(void)
     return g_pendingRefresh.exchange(false);
 }
 
-u64 Transfer::consumeCompletedTitleId(void)
+bool Transfer::consumeReleasedObjects(void)
 {
-    return g_completedTitleId.exchange(0);
+    return g_releasedObjects.exchange(false);
+}
+
+std::vector<u64> Transfer::consumeCompletedTitleIds(void)
+{
+    std::lock_guard<std::mutex> lock(g_completedMutex);
+    std::vector<u64> ids;
+    std::swap(ids, g_completedTitleIds);
+    return ids;
 }
 
 std::string Transfer::receiverToken(void)
@@ -724,212 +1394,259 @@ Transfer::SendOutcome Transfer::sendBackup(Title& title, const std::string& back
 
     std::vector<SendFile> files;
     std::vector<std::string> dirs;
-    if (!collectFiles(backupPath, "", files, &dirs)) {
-        return SendOutcome{false, SendStage::PayloadTooLarge, ""};
-    }
+    PackedMembers packed;
+    collectBackup(backupPath, files, dirs, packed);
     if (files.empty() && dirs.empty()) {
         return SendOutcome{false, SendStage::EmptyBackup, ""};
     }
 
     // Multi-file backups are zipped on the fly by sendZipStream — no staged
     // temp zip; the exact zip size is known upfront because entries are
-    // store-only.
+    // store-only, and bounds the deflated zip too. Zip64 records frame any
+    // file or archive past 4 GiB, so no backup is too large to send.
     bool isZip = files.size() != 1 || !dirs.empty();
-    std::string payloadPath;
-    std::string payloadName;
-    u32 payloadSize = 0;
-
+    ReceiverInfo receiver;
     if (isZip) {
-        std::optional<u64> zipSize = zipStreamSize(files, dirs);
-        if (!zipSize) {
-            return SendOutcome{false, SendStage::PayloadTooLarge, ""};
-        }
-        payloadName = "backup.zip";
-        payloadSize = (u32)*zipSize; // checked <= kZipMaxSize above
+        receiver = fetchReceiverInfo(ip, port);
     }
-    else {
-        const SendFile& entry = files.front();
-        payloadPath           = entry.absPath;
-        payloadName           = entry.relPath;
-        payloadSize           = entry.size;
-    }
-
-    TransferStatus::beginNetwork("Sending backup", payloadSize);
 
     nlohmann::json meta;
-    meta["titleId"]        = StringUtils::format("%016llX", title.id());
-    meta["titleName"]      = title.displayName();
-    meta["dataType"]       = dataType;
-    meta["backupName"]     = backupName;
-    meta["isZip"]          = isZip;
-    meta["fileBytesTotal"] = payloadSize;
-    meta["fileName"]       = payloadName;
-    meta["timestamp"]      = DateTime::logDateTime();
-
-    std::string metaStr  = meta.dump();
-    std::string boundary = StringUtils::format("----checkpoint-boundary-%llu", (unsigned long long)time(nullptr));
+    meta["titleId"]    = StringUtils::format("%016llX", title.id());
+    meta["titleName"]  = title.displayName();
+    meta["dataType"]   = dataType;
+    meta["backupName"] = backupName;
+
+    // Delta transfer: a receiver that already holds a backup of this name (the
+    // previous night's sync, say) keeps the files that did not change, so only
+    // the rest go over the network. Hashing reads the backup once more from the
+    // SD card, which costs far less than sending it.
+    bool compared = false;
+    if (receiver.delta && !files.empty()) {
+        u64 fileBytes = 0;
+        for (const auto& entry : files) {
+            fileBytes += entry.size;
+        }
+        TransferStatus::beginNetwork("Comparing backup", fileBytes);
+        compared = true;
 
-    std::string partMeta = "--" + boundary +
-                           "\r\n"
-                           "Content-Disposition: form-data; name=\"meta\"\r\n"
-                           "Content-Type: application/json\r\n\r\n" +
-                           metaStr + "\r\n";
+        StdFileReader reader;
+        reader.packed           = &packed;
+        nlohmann::json manifest = nlohmann::json::array();
+        for (const auto& entry : files) {
+            u32 crc  = 0;
+            u64 size = 0;
+            if (!fileCrc(reader, entry.absPath, []() { return TransferStatus::cancelRequested(); },
+                    [](size_t n) { TransferStatus::addBytesDone(n); }, crc, size)) {
+                if (TransferStatus::cancelRequested()) {
+                    return SendOutcome{false, SendStage::Cancelled, ""};
+                }
+                continue; // left to the zip, which reports the unreadable file
+            }
+            if (size == entry.size) {
+                manifest.push_back({{"path", entry.relPath}, {"size", size}, {"crc", crc}});
+            }
+        }
 
-    std::string fileName = payloadName;
-    size_t slashPos      = fileName.find_last_of('/');
-    if (slashPos != std::string::npos) {
-        fileName = fileName.substr(slashPos + 1);
-    }
-    if (fileName.empty()) {
-        fileName = "backup.bin";
+        nlohmann::json request     = meta;
+        request["files"]           = manifest;
+        std::set<std::string> held = receiverHeldFiles(ip, port, token, request);
+        nlohmann::json reuse       = nlohmann::json::array();
+        for (const auto& entry : manifest) {
+            if (held.count(entry["path"].get<std::string>()) != 0) {
+                reuse.push_back(entry);
+            }
+        }
+        if (!reuse.empty()) {
+            files.erase(std::remove_if(files.begin(), files.end(), [&](const SendFile& entry) { return held.count(entry.relPath) != 0; }),
+                files.end());
+            meta["reuse"] = reuse;
+            Logging::info("Receiver already holds {} of the backup's files; sending the other {}.", reuse.size(), files.size());
+        }
     }
-    std::string partFileHeader = "--" + boundary +
-                                 "\r\n"
-                                 "Content-Disposition: form-data; name=\"file\"; filename=\"" +
-                                 fileName +
-                                 "\"\r\n"
-                                 "Content-Type: application/octet-stream\r\n\r\n";
 
-    std::string partEnd = "\r\n--" + boundary + "--\r\n";
-
-    u64 contentLength64 = (u64)partMeta.size() + partFileHeader.size() + payloadSize + partEnd.size();
-    if (contentLength64 > TransferProto::kZipMaxSize) {
-        return SendOutcome{false, SendStage::PayloadTooLarge, ""};
+    UploadPayload payload;
+    payload.isZip   = isZip;
+    payload.deflate = receiver.deflate;
+    payload.files   = std::move(files);
+    payload.dirs    = std::move(dirs);
+    payload.packed  = &packed;
+    sizePayload(payload);
+
+    if (compared) {
+        TransferStatus::setMode("Sending backup");
+        TransferStatus::setBytes(0, payload.size);
     }
-    u32 contentLength = (u32)contentLength64;
-
-    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (sock < 0) {
-        return SendOutcome{false, SendStage::Socket, ""};
+    else {
+        TransferStatus::beginNetwork("Sending backup", payload.size);
     }
 
-    struct SockGuard {
-        int fd;
-        ~SockGuard() { close(fd); }
-    } sockGuard{sock};
+    // Names this upload to the receiver, so that after a dropped connection
+    // the retry can ask what it kept (see TransferProto::ManifestEntry).
+    std::string uploadId = StringUtils::format("%016llX%08X", title.id(), (u32)time(nullptr));
 
-    // Non-blocking for the socket's whole lifetime; every send/recv is poll-gated
-    // below so a half-open peer can't block forever.
-    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
-
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port   = htons(port);
-    if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1) {
-        return SendOutcome{false, SendStage::Resolve, ""};
-    }
-    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
-        if (errno != EINPROGRESS) {
-            return SendOutcome{false, SendStage::Connect, ""};
-        }
-        // Bounded wait for the connection to complete, then confirm via SO_ERROR.
-        if (pollSocket(sock, POLLOUT, NET_TIMEOUT_MS) <= 0) {
-            return SendOutcome{false, SendStage::Connect, ""};
-        }
-        int soErr        = 0;
-        socklen_t optLen = sizeof(soErr);
-        if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &soErr, &optLen) != 0 || soErr != 0) {
-            return SendOutcome{false, SendStage::Connect, ""};
-        }
+    meta["isZip"]          = isZip;
+    meta["fileBytesTotal"] = payload.size;
+    meta["fileName"]       = payload.name;
+    meta["timestamp"]      = DateTime::logDateTime();
+    if (isZip && receiver.resume) {
+        meta["uploadId"] = uploadId;
     }
 
-    std::string header = StringUtils::format("POST /transfer/upload HTTP/1.1\r\nHost: %s:%d\r\nConnection: close\r\n", ip.c_str(), port);
-    header += StringUtils::format("X-CP-Token: %s\r\n", token.c_str());
-    header += StringUtils::format("Content-Type: multipart/form-data; boundary=%s\r\n", boundary.c_str());
-    header += StringUtils::format("Content-Length: %u\r\n\r\n", contentLength);
-
-    bool ok = sendAll(sock, header.data(), header.size()) && sendAll(sock, partMeta.data(), partMeta.size()) &&
-              sendAll(sock, partFileHeader.data(), partFileHeader.size());
-
-    if (ok && isZip) {
-        bool cancelled = false;
-        SocketByteSink sink(sock);
-        StdFileReader reader;
-        if (!sendZipStream(
-                sink, files, dirs, reader, []() { return TransferStatus::cancelRequested(); }, [](size_t n) { TransferStatus::addBytesDone(n); },
-                cancelled)) {
-            if (cancelled) {
-                // The scope guard closes the socket, dropping the connection,
-                // which the receiver treats as an aborted request.
+    bool dropped        = false;
+    SendOutcome outcome = postUpload(ip, port, token, meta, payload, dropped);
+
+    // A zip upload that broke off mid-stream (Wi-Fi dropping out, the console
+    // sleeping) continues from the files the receiver verified rather than
+    // from the first byte. Each kept file is checked against the local copy,
+    // so nothing that changed since is trusted.
+    const std::vector<SendFile> backupFiles = payload.files;
+    std::set<std::string> confirmed;
+    for (int attempt = 1; dropped && meta.contains("uploadId") && attempt <= RESUME_ATTEMPTS; attempt++) {
+        TransferStatus::setMode("Reconnecting");
+        for (int waited = 0; waited < RESUME_DELAY_MS; waited += 100) {
+            if (TransferStatus::cancelRequested()) {
                 return SendOutcome{false, SendStage::Cancelled, ""};
             }
-            ok = false;
+            svcSleepThread(100'000'000ULL);
         }
-    }
-    else if (ok) {
-        FILE* input = fopen(payloadPath.c_str(), "rb");
-        if (input == nullptr) {
-            ok = false;
+
+        std::vector<ManifestEntry> kept = receiverKeptFiles(ip, port, token, uploadId);
+        u64 keptBytes                   = 0;
+        for (const auto& entry : kept) {
+            keptBytes += entry.size;
         }
-        else {
-            static const size_t kBuf = 0x40000;
-            std::unique_ptr<u8[]> buf(new u8[kBuf]);
-            while (true) {
-                if (TransferStatus::cancelRequested()) {
-                    fclose(input);
-                    // The scope guard closes the socket, dropping the connection,
-                    // which the receiver treats as an aborted request.
-                    return SendOutcome{false, SendStage::Cancelled, ""};
-                }
-                size_t rd = fread(buf.get(), 1, kBuf, input);
-                if (rd == 0) {
-                    break;
+        TransferStatus::setMode("Checking received files");
+        TransferStatus::setBytes(0, keptBytes);
+
+        StdFileReader reader;
+        reader.packed = &packed;
+        std::set<std::string> verified;
+        nlohmann::json resume = nlohmann::json::array();
+        for (const auto& entry : kept) {
+            std::string key = StringUtils::format("%s|%llu|%08X", entry.relPath.c_str(), (unsigned long long)entry.size, entry.crc);
+            auto local      = std::find_if(backupFiles.begin(), backupFiles.end(), [&](const SendFile& f) { return f.relPath == entry.relPath; });
+            if (local == backupFiles.end() || local->size != entry.size) {
+                continue;
+            }
+            if (confirmed.count(key) == 0) {
+                u32 crc  = 0;
+                u64 size = 0;
+                if (!fileCrc(reader, local->absPath, []() { return TransferStatus::cancelRequested(); },
+                        [](size_t n) { TransferStatus::addBytesDone(n); }, crc, size)) {
+                    if (TransferStatus::cancelRequested()) {
+                        return SendOutcome{false, SendStage::Cancelled, ""};
+                    }
+                    continue;
                 }
-                if (!sendAll(sock, buf.get(), rd)) {
-                    ok = false;
-                    break;
+                if (size != entry.size || crc != entry.crc) {
+                    continue;
                 }
-                TransferStatus::addBytesDone(rd);
+                confirmed.insert(key);
             }
-            fclose(input);
+            verified.insert(entry.relPath);
+            resume.push_back({{"path", entry.relPath}, {"size", entry.size}, {"crc", entry.crc}});
         }
-    }
 
-    if (ok) {
-        ok = sendAll(sock, partEnd.data(), partEnd.size());
+        payload.files.clear();
+        for (const auto& entry : backupFiles) {
+            if (verified.count(entry.relPath) == 0) {
+                payload.files.push_back(entry);
+            }
+        }
+        sizePayload(payload);
+        meta.erase("resume");
+        if (!resume.empty()) {
+            meta["resume"] = resume;
+        }
+        meta["fileBytesTotal"] = payload.size;
+        Logging::info("Upload dropped; resuming (attempt {}/{}) with {} files already on the receiver.", attempt, RESUME_ATTEMPTS, resume.size());
+
+        TransferStatus::setMode("Resuming backup");
+        TransferStatus::setBytes(0, payload.size);
+        bool refused = false;
+        outcome      = postUpload(ip, port, token, meta, payload, dropped, &refused);
+        if (refused) {
+            // The receiver lost what it had staged: send the whole backup again.
+            Logging::info("Receiver cannot resume upload {}; sending the whole backup again.", uploadId);
+            payload.files = backupFiles;
+            sizePayload(payload);
+            meta.erase("resume");
+            meta["fileBytesTotal"] = payload.size;
+            TransferStatus::setMode("Sending backup");
+            TransferStatus::setBytes(0, payload.size);
+            outcome = postUpload(ip, port, token, meta, payload, dropped);
+        }
     }
+    return outcome;
+}
 
-    std::string response;
-    {
-        char responseBuf[512];
-        while (true) {
-            if (pollSocket(sock, POLLIN, NET_TIMEOUT_MS) <= 0) {
-                break; // timeout or error: stop waiting on a silent peer
+Transfer::SendOutcome Transfer::sendBackups(std::vector<BatchItem>& items, const std::string& ip, u16 port, const std::string& token)
+{
+    ReceiverInfo receiver = fetchReceiverInfo(ip, port);
+    if (!receiver.batch) {
+        // A receiver that predates batches takes the backups one upload at a
+        // time; the first one that fails ends the run.
+        SendOutcome outcome{false, SendStage::EmptyBackup, ""};
+        for (auto& item : items) {
+            SendOutcome one = sendBackup(item.title, item.backupPath, item.backupName, item.dataType, ip, port, token);
+            if (!one.ok && one.stage != SendStage::EmptyBackup) {
+                return one;
             }
-            int rc = recv(sock, responseBuf, sizeof(responseBuf), 0);
-            if (rc <= 0) {
-                break;
+            if (one.ok) {
+                outcome = one;
             }
-            response.append(responseBuf, (size_t)rc);
         }
+        return outcome;
     }
 
-    if (!ok) {
-        return SendOutcome{false, TransferStatus::cancelRequested() ? SendStage::Cancelled : SendStage::Send, ""};
-    }
+    struct StatusGuard {
+        ~StatusGuard() { TransferStatus::end(); }
+    } statusGuard;
 
-    bool httpOk = response.rfind("HTTP/1.1 200", 0) == 0 || response.rfind("HTTP/1.0 200", 0) == 0;
-    if (!httpOk) {
-        std::string detail;
-        if (!response.empty()) {
-            size_t bodyPos = response.find("\r\n\r\n");
-            if (bodyPos != std::string::npos && bodyPos + 4 < response.size()) {
-                std::string body = response.substr(bodyPos + 4);
-                auto j           = nlohmann::json::parse(body, nullptr, false);
-                if (!j.is_discarded() && j.contains("error") && j["error"].is_string()) {
-                    detail = j["error"].get<std::string>();
-                }
-            }
-            if (detail.empty()) {
-                size_t lineEnd = response.find("\r\n");
-                detail         = lineEnd == std::string::npos ? response : response.substr(0, lineEnd);
-            }
+    // One zip with each backup under its index in meta["backups"] (see
+    // TransferProto's batch notes).
+    UploadPayload payload;
+    PackedMembers packed;
+    payload.isZip          = true;
+    payload.deflate        = receiver.deflate;
+    payload.packed         = &packed;
+    nlohmann::json backups = nlohmann::json::array();
+    for (auto& item : items) {
+        std::vector<SendFile> files;
+        std::vector<std::string> dirs;
+        collectBackup(item.backupPath, files, dirs, packed);
+        if (files.empty() && dirs.empty()) {
+            Logging::warning("Left the empty backup {} out of the batch.", item.backupPath);
+            continue;
+        }
+        std::string prefix = std::to_string(backups.size()) + "/";
+        payload.dirs.push_back(prefix);
+        for (const auto& dir : dirs) {
+            payload.dirs.push_back(prefix + dir);
         }
-        return SendOutcome{false, SendStage::Response, detail};
+        for (auto& entry : files) {
+            entry.relPath = prefix + entry.relPath;
+            payload.files.push_back(std::move(entry));
+        }
+        backups.push_back({{"titleId", StringUtils::format("%016llX", item.title.id())}, {"titleName", item.title.displayName()},
+            {"dataType", item.dataType}, {"backupName", item.backupName}});
+    }
+    if (backups.empty()) {
+        return SendOutcome{false, SendStage::EmptyBackup, ""};
     }
+    sizePayload(payload);
+    TransferStatus::beginNetwork("Sending backups", payload.size);
+
+    nlohmann::json meta;
+    meta["backups"]        = backups;
+    meta["isZip"]          = true;
+    meta["fileBytesTotal"] = payload.size;
+    meta["fileName"]       = payload.name;
+    meta["timestamp"]      = DateTime::logDateTime();
+    Logging::info("Sending {} backups ({} files) in one upload.", backups.size(), payload.files.size());
 
-    return SendOutcome{true, SendStage::Response, ""};
+    bool dropped = false;
+    return postUpload(ip, port, token, meta, payload, dropped);
 }
 
 std::optional<Transfer::TransferTarget> Transfer::parseTarget(const std::string& ipPort)
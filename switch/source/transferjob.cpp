@@ -25,6 +25,8 @@
  */
 
 #include "transferjob.hpp"
+#include "manifest.hpp"
+#include "objectstore.hpp"
 #include "progress.hpp"
 #include "transferstatus.hpp"
 
@@ -33,14 +35,15 @@ namespace {
     constexpr int WORKER_PRIO     = 0x2C; // same as the network thread; the copy is IO-bound and yields on fs calls
 }
 
-void TransferJob::enqueueBackup(Title title, std::string dstPath, std::string successMsg)
+void TransferJob::enqueueBackup(Title title, std::string dstPath, std::string successMsg, bool skipIfUnchanged)
 {
     std::lock_guard<std::mutex> lock(mMutex);
     WorkItem item;
-    item.kind       = Kind::Backup;
-    item.title      = std::move(title);
-    item.path       = std::move(dstPath);
-    item.successMsg = std::move(successMsg);
+    item.kind            = Kind::Backup;
+    item.title           = std::move(title);
+    item.path            = std::move(dstPath);
+    item.successMsg      = std::move(successMsg);
+    item.skipIfUnchanged = skipIfUnchanged;
     mQueue.push_back(std::move(item));
 }
 
@@ -72,31 +75,52 @@ void TransferJob::enqueueSend(Title title, std::string backupPath, std::string b
     mQueue.push_back(std::move(item));
 }
 
+void TransferJob::enqueueSend(std::vector<Transfer::BatchItem> items, std::string ip, u16 port, std::string token, std::string successMsg)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    WorkItem item;
+    item.kind       = Kind::Send;
+    item.successMsg = std::move(successMsg);
+    item.ip         = std::move(ip);
+    item.port       = port;
+    item.token      = std::move(token);
+    item.batch      = std::move(items);
+    mQueue.push_back(std::move(item));
+}
+
+void TransferJob::enqueueCollectGarbage(void)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    WorkItem item;
+    item.kind = Kind::CollectGarbage;
+    mQueue.push_back(std::move(item));
+}
+
 void TransferJob::start(void)
 {
     if (mState.load() == State::Running) {
         return;
     }
 
-    size_t total;
-    bool anyLocal = false;
+    size_t queued;
+    size_t total = 0;
     {
         std::lock_guard<std::mutex> lock(mMutex);
-        total = mQueue.size();
+        queued = mQueue.size();
         for (const auto& item : mQueue) {
-            if (item.kind != Kind::Send) {
-                anyLocal = true;
-                break;
+            if (item.kind == Kind::Backup || item.kind == Kind::Restore) {
+                total++;
             }
         }
     }
-    if (total == 0) {
+    if (queued == 0) {
         return;
     }
 
     // Sends drive TransferStatus themselves (beginNetwork inside sendBackup); only
-    // local copies use the batch counter and the local-copy modal.
-    if (anyLocal) {
+    // local copies use the batch counter and the local-copy modal. A sweep of the
+    // object store shows neither.
+    if (total > 0) {
         TransferStatus::beginLocalBatch(total);
     }
     mCancelRequested.store(false);
@@ -127,7 +151,9 @@ void TransferJob::run(void)
 {
     size_t done = 0;
     std::vector<u64> refreshIds;
+    std::vector<JobResult::WrittenBackup> written;
     JobResult last;
+    bool collect = false;
 
     for (;;) {
         WorkItem item;
@@ -140,13 +166,24 @@ void TransferJob::run(void)
             mQueue.pop_front();
         }
 
+        if (item.kind == Kind::CollectGarbage) {
+            collect = true;
+            continue;
+        }
+
         if (item.kind == Kind::Send) {
-            Transfer::SendOutcome out = Transfer::sendBackup(item.title, item.path, item.backupName, item.dataType, item.ip, item.port, item.token);
-            last                      = JobResult{};
-            last.isRestore            = false;
-            last.ok                   = out.ok;
-            last.successMsg           = item.successMsg;
-            last.send                 = out;
+            Transfer::SendOutcome out;
+            if (item.batch.empty()) {
+                out = Transfer::sendBackup(item.title, item.path, item.backupName, item.dataType, item.ip, item.port, item.token);
+            }
+            else {
+                out = Transfer::sendBackups(item.batch, item.ip, item.port, item.token);
+            }
+            last            = JobResult{};
+            last.isRestore  = false;
+            last.ok         = out.ok;
+            last.successMsg = item.successMsg;
+            last.send       = out;
             done++;
             continue;
         }
@@ -157,11 +194,15 @@ void TransferJob::run(void)
         // Only a backup item's sink is given the cancel flag, so cancelled() is
         // structurally always false while restoring a save.
         UiProgressSink sink(isRestore ? nullptr : &mCancelRequested);
-        io::IoOutcome out = isRestore ? io::restore(item.title, item.path, sink) : io::backup(item.title, item.path, sink);
-        if (out.ok && !isRestore) {
+        // A backup written over a stored one leaves that one's objects behind.
+        collect = collect || (!isRestore && Manifest::layout(item.path) == Manifest::Layout::Stored);
+        io::IoOutcome out =
+            isRestore ? io::restore(item.title, item.path, sink) : io::backup(item.title, item.path, sink, item.skipIfUnchanged);
+        if (out.ok && !isRestore && out.unchangedFrom.empty()) {
             refreshIds.push_back(item.title.id());
+            written.push_back(JobResult::WrittenBackup{item.title.id(), item.path, out.bytes});
         }
-        last = JobResult{isRestore, out.ok, out.res, out.stage, item.successMsg, {}, out.cancelled, std::nullopt};
+        last = JobResult{isRestore, out.ok, out.res, out.stage, item.successMsg, {}, {}, out.cancelled, std::move(out.unchangedFrom), std::nullopt};
         done++;
 
         if (out.cancelled) {
@@ -173,7 +214,18 @@ void TransferJob::run(void)
         }
     }
 
+    // Once every item is done, so no backup is still writing objects.
+    if (collect) {
+        ObjectStore::collectGarbage();
+    }
+
     last.refreshIds = std::move(refreshIds);
+    last.written    = std::move(written);
+    // In a batch, one save found unchanged does not describe the whole run.
+    if (done > 1) {
+        last.unchangedFrom.clear();
+    }
+    last.quiet = done == 0;
     {
         std::lock_guard<std::mutex> lock(mMutex);
         mResult = std::move(last);
@@ -0,0 +1,122 @@
+package main
+
+import (
+	"encoding/json"
+	"fmt"
+	"hash/crc32"
+	"io"
+	"net/http"
+	"os"
+	"path/filepath"
+	"strings"
+)
+
+// Delta transfer (see TransferProto::ManifestEntry in
+// common/transferprotocol.hpp): before a zip upload the console posts a
+// manifest of the backup's files to /transfer/manifest, the receiver answers
+// with the ones it already holds byte-identical in the backup folder the
+// upload will replace, and the upload then carries only the rest, naming the
+// held ones in Meta.Reuse for the receiver to copy over.
+
+// maxManifestBytes bounds the manifest body; a save tree of 100k files still
+// fits several times over.
+const maxManifestBytes = 64 << 20
+
+func (rv *receiver) handleManifest(w http.ResponseWriter, r *http.Request) {
+	if r.Method != http.MethodPost {
+		drainBody(r)
+		writeJSON(w, http.StatusBadRequest, ManifestResponse{OK: false, Error: "Bad manifest"})
+		return
+	}
+	if !rv.authorized(w, r) {
+		return
+	}
+	var req ManifestRequest
+	if err := json.NewDecoder(io.LimitReader(r.Body, maxManifestBytes)).Decode(&req); err != nil {
+		drainBody(r)
+		writeJSON(w, http.StatusBadRequest, ManifestResponse{OK: false, Error: fmt.Sprintf("invalid manifest: %v", err)})
+		return
+	}
+
+	// Held under the upload lock so the folder cannot be replaced mid-scan.
+	rv.mu.Lock()
+	defer rv.mu.Unlock()
+
+	have := []string{}
+	if req.BackupName != "" {
+		root := rv.backupRoot(&req.Meta)
+		for _, e := range req.Files {
+			if holdsFile(root, e) {
+				have = append(have, e.Path)
+			}
+		}
+		if rv.opts.verbose {
+			fmt.Fprintf(os.Stderr, "manifest: %d of %d files already in %s\n", len(have), len(req.Files), root)
+		}
+	}
+	writeJSON(w, http.StatusOK, ManifestResponse{OK: true, Have: have})
+}
+
+// holdsFile reports whether root holds e.Path as a regular file with e's size
+// and CRC-32.
+func holdsFile(root string, e ManifestEntry) bool {
+	if !isSafeZipRelativePath(e.Path) || strings.HasSuffix(e.Path, "/") {
+		return false
+	}
+	f, err := os.Open(filepath.Join(root, filepath.FromSlash(e.Path)))
+	if err != nil {
+		return false
+	}
+	defer f.Close()
+	st, err := f.Stat()
+	if err != nil || !st.Mode().IsRegular() || st.Size() != e.Size {
+		return false
+	}
+	h := crc32.NewIEEE()
+	n, err := io.Copy(h, f)
+	return err == nil && n == e.Size && h.Sum32() == e.CRC
+}
+
+// cloneReused copies the files a delta upload reuses from the backup being
+// replaced (oldRoot) into the new one (newRoot). Each copy is checked against
+// its manifest entry, so a file that changed after the manifest exchange
+// fails the upload instead of landing stale.
+func cloneReused(oldRoot, newRoot string, reuse []ManifestEntry) error {
+	for _, e := range reuse {
+		if !isSafeZipRelativePath(e.Path) || strings.HasSuffix(e.Path, "/") {
+			return fmt.Errorf("invalid reused path: %q", e.Path)
+		}
+		rel := filepath.FromSlash(e.Path)
+		if err := copyVerified(filepath.Join(oldRoot, rel), filepath.Join(newRoot, rel), e); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func copyVerified(src, dst string, e ManifestEntry) error {
+	in, err := os.Open(src)
+	if err != nil {
+		return fmt.Errorf("reused file %q is gone: %v", e.Path, err)
+	}
+	defer in.Close()
+	if err := os.MkdirAll(filepath.Dir(dst), 0o755); err != nil {
+		return err
+	}
+	out, err := os.Create(dst)
+	if err != nil {
+		return err
+	}
+	h := crc32.NewIEEE()
+	n, err := io.Copy(io.MultiWriter(out, h), in)
+	if cerr := out.Close(); err == nil {
+		err = cerr
+	}
+	if err != nil {
+		return fmt.Errorf("copy reused file %q: %v", e.Path, err)
+	}
+	if n != e.Size || h.Sum32() != e.CRC {
+		return fmt.Errorf("reused file %q changed on the receiver", e.Path)
+	}
+	return nil
+}
@@ -1,6 +1,9 @@
 package main
 
 import (
+	"bytes"
+	"encoding/json"
+	"hash/crc32"
 	"net/http"
 	"net/http/httptest"
 	"net/url"
@@ -107,6 +110,55 @@ func TestSendReceiveZipRoundTrip(t *testing.T) {
 	}
 }
 
+// TestSendReceiveDeflateZipRoundTrip sends the deflated zip cmdSend packs
+// for a receiver that advertises deflate.
+func TestSendReceiveDeflateZipRoundTrip(t *testing.T) {
+	files := map[string]string{
+		"main.sav":     strings.Repeat("\x00", 64*1024) + "tail",
+		"sub/extra.%1": "nested & weird",
+	}
+	src := buildTree(t, files)
+
+	target, outDir := startReceiver(t, receiveOpts{})
+
+	tmp, err := os.CreateTemp(t.TempDir(), "send_*.zip")
+	if err != nil {
+		t.Fatal(err)
+	}
+	size, err := writeDeflateZip(tmp, src)
+	if err != nil {
+		t.Fatal(err)
+	}
+	tmp.Close()
+	if size >= 64*1024 {
+		t.Errorf("deflated zip is %d bytes, want it well under the 64 KiB of zeros it holds", size)
+	}
+
+	meta := Meta{
+		TitleID:        "0004000000055D00",
+		TitleName:      "Test Game",
+		DataType:       "save",
+		BackupName:     "deflated",
+		IsZip:          true,
+		FileBytesTotal: size,
+		FileName:       "backup.zip",
+		Timestamp:      timestamp(),
+	}
+	savedPath, err := doSend(testClient(), target, "1234", meta, tmp.Name(), nil)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if want := filepath.Join(outDir, "saves", "0004000000055D00 Test Game", "deflated"); savedPath != want {
+		t.Errorf("savedPath = %q, want %q", savedPath, want)
+	}
+	got := mustReadTree(t, savedPath)
+	for rel, want := range files {
+		if got[rel] != want {
+			t.Errorf("%s: content mismatch", rel)
+		}
+	}
+}
+
 func TestSendReceiveRawFile(t *testing.T) {
 	src := buildTree(t, map[string]string{"save.bin": "raw single file"})
 	target, outDir := startReceiver(t, receiveOpts{})
@@ -181,4 +233,135 @@ func TestReceiveInfoEndpoint(t *testing.T) {
 	if ri.MaxUploadBytes != 0 {
 		t.Errorf("maxUploadBytes = %d, want 0 (unlimited)", ri.MaxUploadBytes)
 	}
+	if !ri.acceptsDeflate() {
+		t.Errorf("zipMethods = %v, want deflate advertised", ri.ZipMethods)
+	}
+	if !ri.Delta {
+		t.Error("delta not advertised")
+	}
+	if !ri.Batch {
+		t.Error("batch not advertised")
+	}
+}
+
+// TestBatchUploadFansOutBackups sends two titles' backups in one zip, each
+// under its index, and checks that both land in their own title folders.
+func TestBatchUploadFansOutBackups(t *testing.T) {
+	src := buildTree(t, map[string]string{
+		"0/main.sav":     "first title",
+		"1/sub/data.bin": "second title",
+	})
+	target, outDir := startReceiver(t, receiveOpts{})
+
+	tmp, err := os.CreateTemp(t.TempDir(), "send_*.zip")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := WriteStoreZip(tmp, src, nil); err != nil {
+		t.Fatal(err)
+	}
+	tmp.Close()
+	st, _ := os.Stat(tmp.Name())
+
+	meta := Meta{
+		IsZip:          true,
+		FileBytesTotal: st.Size(),
+		FileName:       "backup.zip",
+		Timestamp:      timestamp(),
+		Backups: []Meta{
+			{TitleID: "0100000000010000", TitleName: "First", DataType: "save", BackupName: "a"},
+			{TitleID: "0100000000020000", TitleName: "Second", DataType: "save", BackupName: "b"},
+		},
+	}
+	if _, err := doSend(testClient(), target, "1234", meta, tmp.Name(), nil); err != nil {
+		t.Fatal(err)
+	}
+
+	first := mustReadTree(t, filepath.Join(outDir, "saves", "0100000000010000 First", "a"))
+	if len(first) != 1 || first["main.sav"] != "first title" {
+		t.Errorf("first backup = %v", first)
+	}
+	second := mustReadTree(t, filepath.Join(outDir, "saves", "0100000000020000 Second", "b"))
+	if len(second) != 1 || second["sub/data.bin"] != "second title" {
+		t.Errorf("second backup = %v", second)
+	}
+	if leftovers, _ := filepath.Glob(filepath.Join(outDir, "chlink_recv_*")); len(leftovers) != 0 {
+		t.Errorf("spool files left behind: %v", leftovers)
+	}
+}
+
+func postManifest(t *testing.T, target string, req ManifestRequest) ManifestResponse {
+	t.Helper()
+	body, _ := json.Marshal(req)
+	hreq, _ := http.NewRequest(http.MethodPost, "http://"+target+"/transfer/manifest", bytes.NewReader(body))
+	hreq.Header.Set("X-CP-Token", "1234")
+	resp, err := testClient().Do(hreq)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer resp.Body.Close()
+	if resp.ContentLength < 0 {
+		t.Error("manifest reply is chunked; the consoles need a Content-Length")
+	}
+	var mr ManifestResponse
+	if err := json.NewDecoder(resp.Body).Decode(&mr); err != nil {
+		t.Fatal(err)
+	}
+	return mr
+}
+
+func manifestEntry(rel, content string) ManifestEntry {
+	return ManifestEntry{Path: rel, Size: int64(len(content)), CRC: crc32.ChecksumIEEE([]byte(content))}
+}
+
+// TestDeltaUploadReusesHeldFiles runs the console's delta exchange: the
+// manifest answer names only byte-identical files, and an upload that leaves
+// those out of its zip still lands the complete backup.
+func TestDeltaUploadReusesHeldFiles(t *testing.T) {
+	target, outDir := startReceiver(t, receiveOpts{flat: true})
+	meta := Meta{TitleName: "G", DataType: "save", BackupName: "nightly", IsZip: true, FileName: "backup.zip", Timestamp: timestamp()}
+
+	old := map[string]string{"same.sav": "unchanged", "sub/edit.sav": "old", "dropped.sav": "x"}
+	if _, err := doSend(testClient(), target, "1234", meta, writeZipToFile(t, buildTree(t, old)), nil); err != nil {
+		t.Fatal(err)
+	}
+
+	mr := postManifest(t, target, ManifestRequest{Meta: meta, Files: []ManifestEntry{
+		manifestEntry("same.sav", "unchanged"),
+		manifestEntry("sub/edit.sav", "new"),
+		manifestEntry("added.sav", "added"),
+		{Path: "../same.sav", Size: 9, CRC: crc32.ChecksumIEEE([]byte("unchanged"))},
+	}})
+	if !mr.OK || len(mr.Have) != 1 || mr.Have[0] != "same.sav" {
+		t.Fatalf("manifest reply = %+v, want only same.sav held", mr)
+	}
+
+	// A reused file that no longer matches fails the upload and keeps the old backup.
+	bad := meta
+	bad.Reuse = []ManifestEntry{manifestEntry("same.sav", "changed since")}
+	if _, err := doSend(testClient(), target, "1234", bad, writeZipToFile(t, buildTree(t, map[string]string{"added.sav": "added"})), nil); err == nil {
+		t.Error("upload reusing a mismatched file succeeded")
+	}
+	if got := mustReadTree(t, filepath.Join(outDir, "nightly")); len(got) != len(old) {
+		t.Errorf("failed upload touched the old backup: %v", got)
+	}
+
+	meta.Reuse = []ManifestEntry{manifestEntry("same.sav", "unchanged")}
+	changed := map[string]string{"sub/edit.sav": "new", "added.sav": "added"}
+	if _, err := doSend(testClient(), target, "1234", meta, writeZipToFile(t, buildTree(t, changed)), nil); err != nil {
+		t.Fatal(err)
+	}
+	got := mustReadTree(t, filepath.Join(outDir, "nightly"))
+	want := map[string]string{"same.sav": "unchanged", "sub/edit.sav": "new", "added.sav": "added"}
+	if len(got) != len(want) {
+		t.Errorf("backup holds %v, want %v", got, want)
+	}
+	for rel, content := range want {
+		if got[rel] != content {
+			t.Errorf("%s = %q, want %q", rel, got[rel], content)
+		}
+	}
+	if leftovers, _ := filepath.Glob(filepath.Join(outDir, "chlink_recv_*")); len(leftovers) != 0 {
+		t.Errorf("staging left behind: %v", leftovers)
+	}
 }
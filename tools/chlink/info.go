@@ -5,6 +5,7 @@ import (
 	"flag"
 	"fmt"
 	"os"
+	"strings"
 )
 
 func cmdInfo(args []string) error {
@@ -36,5 +37,12 @@ func cmdInfo(args []string) error {
 		fmt.Printf("maxUploadBytes:  %d (%s)\n", ri.MaxUploadBytes, humanBytes(ri.MaxUploadBytes))
 	}
 	fmt.Printf("freeSpaceBytes:  %d\n", ri.FreeSpaceBytes)
+	if len(ri.ZipMethods) == 0 {
+		fmt.Printf("zipMethods:      store (not advertised)\n")
+	} else {
+		fmt.Printf("zipMethods:      %s\n", strings.Join(ri.ZipMethods, ", "))
+	}
+	fmt.Printf("delta:           %v\n", ri.Delta)
+	fmt.Printf("batch:           %v\n", ri.Batch)
 	return nil
 }
@@ -11,6 +11,36 @@ type Meta struct {
 	FileBytesTotal int64  `json:"fileBytesTotal"`
 	FileName       string `json:"fileName"`
 	Timestamp      string `json:"timestamp"`
+	// Reuse lists the files of a delta upload that the zip leaves out because
+	// the receiver said it already holds them (see ManifestRequest).
+	Reuse []ManifestEntry `json:"reuse,omitempty"`
+	// Backups makes the upload a batch: one zip carrying each listed backup
+	// under its index ("0/", "1/", ...). Only the title, data type and backup
+	// name of each entry are read.
+	Backups []Meta `json:"backups,omitempty"`
+}
+
+// ManifestEntry is one file of a delta-transfer manifest: its path inside the
+// backup, size and CRC-32 (see TransferProto::ManifestEntry).
+type ManifestEntry struct {
+	Path string `json:"path"`
+	Size int64  `json:"size"`
+	CRC  uint32 `json:"crc"`
+}
+
+// ManifestRequest mirrors the POST /transfer/manifest body: the meta fields
+// naming the target backup plus every file the sender would zip.
+type ManifestRequest struct {
+	Meta
+	Files []ManifestEntry `json:"files"`
+}
+
+// ManifestResponse mirrors the POST /transfer/manifest response body: the
+// paths the receiver already holds byte-identical in the target backup.
+type ManifestResponse struct {
+	OK    bool     `json:"ok"`
+	Have  []string `json:"have"`
+	Error string   `json:"error,omitempty"`
 }
 
 // InfoResponse mirrors GET /transfer/info.
@@ -19,11 +49,31 @@ type InfoResponse struct {
 	Version        string `json:"version"`
 	MaxUploadBytes int64  `json:"maxUploadBytes"`
 	FreeSpaceBytes int64  `json:"freeSpaceBytes"`
+	// ZipMethods lists the zip entry methods the receiver extracts ("store",
+	// "deflate"). Receivers that predate deflate omit it: send them store zips.
+	ZipMethods []string `json:"zipMethods,omitempty"`
+	// Delta reports that POST /transfer/manifest is served, so an upload may
+	// leave out the files the receiver already holds.
+	Delta bool `json:"delta,omitempty"`
+	// Batch reports that an upload may carry many backups (Meta.Backups).
+	Batch bool `json:"batch,omitempty"`
+}
+
+// acceptsDeflate reports whether the receiver advertised deflated zips.
+func (ri InfoResponse) acceptsDeflate() bool {
+	for _, m := range ri.ZipMethods {
+		if m == "deflate" {
+			return true
+		}
+	}
+	return false
 }
 
 // UploadResponse mirrors the POST /transfer/upload response body.
 type UploadResponse struct {
 	OK        bool   `json:"ok"`
 	SavedPath string `json:"savedPath,omitempty"`
-	Error     string `json:"error,omitempty"`
+	// SavedPaths lists where each backup of a batch landed, in meta order.
+	SavedPaths []string `json:"savedPaths,omitempty"`
+	Error      string   `json:"error,omitempty"`
 }
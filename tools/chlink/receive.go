@@ -34,7 +34,7 @@ type receiveOpts struct {
 // endpoints with the same validation: constant-time PIN compare, zip
 // path-traversal rejection, CRC verification (via archive/zip), and
 // same-name backup folder replacement. Upload bodies stream to a temp file
-// in outDir, never RAM.
+// in outDir, never RAM. It also serves /transfer/manifest for delta uploads.
 type receiver struct {
 	opts      receiveOpts
 	mu        sync.Mutex // serializes uploads, like the console's single-threaded server
@@ -139,15 +139,15 @@ func cmdReceive(args []string) error {
 	return err
 }
 
-// sweepTempFiles removes spool files left behind by a crash or Ctrl-C
-// mid-upload (parity with the console's boot sweep).
+// sweepTempFiles removes spool files and staging folders left behind by a
+// crash or Ctrl-C mid-upload (parity with the console's boot sweep).
 func sweepTempFiles(outDir string, verbose bool) {
 	matches, _ := filepath.Glob(filepath.Join(outDir, "chlink_recv_*"))
 	for _, m := range matches {
 		if verbose {
 			fmt.Fprintf(os.Stderr, "removing leftover %s\n", m)
 		}
-		os.Remove(m)
+		os.RemoveAll(m)
 	}
 }
 
@@ -155,6 +155,7 @@ func (rv *receiver) handler() http.Handler {
 	mux := http.NewServeMux()
 	mux.HandleFunc("/transfer/info", rv.handleInfo)
 	mux.HandleFunc("/transfer/upload", rv.handleUpload)
+	mux.HandleFunc("/transfer/manifest", rv.handleManifest)
 	return mux
 }
 
@@ -166,6 +167,12 @@ func (rv *receiver) handleInfo(w http.ResponseWriter, r *http.Request) {
 		// The CLI streams uploads to disk, so it has no fixed cap: 0 = unlimited.
 		MaxUploadBytes: 0,
 		FreeSpaceBytes: 0,
+		// archive/zip reads both.
+		ZipMethods: []string{"store", "deflate"},
+		// --no-extract keeps backups as zips, so there are no files to reuse.
+		Delta: !rv.opts.noExtract,
+		// A batch is split into its backups by extracting it.
+		Batch: !rv.opts.noExtract,
 	})
 }
 
@@ -175,45 +182,65 @@ func (rv *receiver) handleUpload(w http.ResponseWriter, r *http.Request) {
 		writeJSON(w, http.StatusBadRequest, UploadResponse{OK: false, Error: "Bad upload"})
 		return
 	}
-	token := r.Header.Get("X-CP-Token")
-	if subtle.ConstantTimeCompare([]byte(token), []byte(rv.opts.pin)) != 1 {
-		// Drain the body before answering, like the console server (which
-		// buffers the whole request): responding mid-upload makes senders see
-		// a connection reset instead of the 403.
-		drainBody(r)
-		writeJSON(w, http.StatusForbidden, UploadResponse{OK: false, Error: "Invalid token"})
+	if !rv.authorized(w, r) {
 		return
 	}
 
 	rv.mu.Lock()
 	defer rv.mu.Unlock()
 
-	savedPath, meta, err := rv.storeUpload(r)
+	savedPaths, meta, err := rv.storeUpload(r)
 	if err != nil {
 		drainBody(r)
 		rv.logEvent(map[string]any{"event": "upload_failed", "error": err.Error()})
 		writeJSON(w, http.StatusBadRequest, UploadResponse{OK: false, Error: err.Error()})
 		return
 	}
-	rv.logEvent(map[string]any{
-		"event": "received", "savedPath": savedPath,
-		"titleId": meta.TitleID, "titleName": meta.TitleName,
-		"dataType": meta.DataType, "backupName": meta.BackupName,
-	})
-	writeJSON(w, http.StatusOK, UploadResponse{OK: true, SavedPath: savedPath})
+	backups := []Meta{*meta}
+	if len(meta.Backups) > 0 {
+		backups = meta.Backups
+	}
+	for i, b := range backups {
+		rv.logEvent(map[string]any{
+			"event": "received", "savedPath": savedPaths[i],
+			"titleId": b.TitleID, "titleName": b.TitleName,
+			"dataType": b.DataType, "backupName": b.BackupName,
+		})
+	}
+	resp := UploadResponse{OK: true, SavedPath: savedPaths[0]}
+	if len(meta.Backups) > 0 {
+		resp.SavedPaths = savedPaths
+	}
+	writeJSON(w, http.StatusOK, resp)
 	if rv.onSuccess != nil {
 		rv.onSuccess()
 	}
 }
 
+// authorized checks the request's PIN token. On a mismatch it answers the 403
+// itself and the handler must return.
+func (rv *receiver) authorized(w http.ResponseWriter, r *http.Request) bool {
+	token := r.Header.Get("X-CP-Token")
+	if subtle.ConstantTimeCompare([]byte(token), []byte(rv.opts.pin)) == 1 {
+		return true
+	}
+	// Drain the body before answering, like the console server (which
+	// buffers the whole request): responding mid-upload makes senders see
+	// a connection reset instead of the 403.
+	drainBody(r)
+	writeJSON(w, http.StatusForbidden, UploadResponse{OK: false, Error: "Invalid token"})
+	return false
+}
+
 // storeUpload streams the multipart body, spools the file part to a temp
 // file, and lands the backup under the mirrored console layout:
 // <out>/<type>/<titleId titleName>/<backupName>/ (or <out>/<backupName>
-// with --flat).
-func (rv *receiver) storeUpload(r *http.Request) (string, *Meta, error) {
+// with --flat). It returns where each backup landed: one path, or one per
+// entry of a batch.
+func (rv *receiver) storeUpload(r *http.Request) ([]string, *Meta, error) {
 	mr, err := r.MultipartReader()
 	if err != nil {
-		return "", nil, fmt.Errorf("bad multipart body: %v", err)
+		return nil, nil, fmt.Errorf("bad multipart body: %v", err)
 	}
 
 	var meta *Meta
@@ -231,19 +258,19 @@ func (rv *receiver) storeUpload(r *http.Request) (string, *Meta, error) {
 			break
 		}
 		if err != nil {
-			return "", nil, fmt.Errorf("bad multipart body: %v", err)
+			return nil, nil, fmt.Errorf("bad multipart body: %v", err)
 		}
 		switch part.FormName() {
 		case "meta":
 			var m Meta
 			if err := json.NewDecoder(io.LimitReader(part, 1<<20)).Decode(&m); err != nil {
-				return "", nil, fmt.Errorf("invalid meta: %v", err)
+				return nil, nil, fmt.Errorf("invalid meta: %v", err)
 			}
 			meta = &m
 		case "file":
 			tmp, err := os.CreateTemp(rv.opts.outDir, "chlink_recv_*")
 			if err != nil {
-				return "", nil, err
+				return nil, nil, err
 			}
 			spool = tmp.Name()
 			spoolBytes, err = io.Copy(tmp, part)
@@ -251,52 +278,56 @@ func (rv *receiver) storeUpload(r *http.Request) (string, *Meta, error) {
 				err = cerr
 			}
 			if err != nil {
-				return "", nil, fmt.Errorf("storing upload failed: %v", err)
+				return nil, nil, fmt.Errorf("storing upload failed: %v", err)
 			}
 		}
 		part.Close()
 	}
 	if meta == nil || spool == "" {
-		return "", nil, fmt.Errorf("incomplete form data")
+		return nil, nil, fmt.Errorf("incomplete form data")
 	}
 
-	backupName := meta.BackupName
-	if backupName == "" {
-		backupName = "Received_" + fsTimestamp()
+	if len(meta.Backups) > 0 {
+		if !meta.IsZip || rv.opts.noExtract {
+			return nil, nil, fmt.Errorf("batch upload must be an extractable zip")
+		}
+		roots, err := rv.extractBatch(spool, meta.Backups)
+		if err != nil {
+			return nil, nil, err
+		}
+		return roots, meta, nil
 	}
 
-	var backupRoot string
-	if rv.opts.flat {
-		backupRoot = filepath.Join(rv.opts.outDir, sanitizeComponent(backupName))
-	} else {
-		dataType := meta.DataType
-		if dataType != "extdata" {
-			dataType = "save"
-		}
-		typeDir := map[string]string{"save": "saves", "extdata": "extdata"}[dataType]
-		titleName := meta.TitleName
-		if titleName == "" {
-			titleName = "Unknown"
+	if meta.BackupName == "" {
+		meta.BackupName = "Received_" + fsTimestamp()
+	}
+	backupRoot := rv.backupRoot(meta)
+
+	if rv.opts.verbose {
+		fmt.Fprintf(os.Stderr, "received %s (%s, isZip=%v) -> %s\n", meta.FileName, humanBytes(spoolBytes), meta.IsZip, backupRoot)
+	}
+
+	if meta.IsZip && !rv.opts.noExtract {
+		if err := rv.extractUpload(spool, backupRoot, meta.Reuse); err != nil {
+			return nil, nil, err
 		}
-		titleFolder := titleName
-		if meta.TitleID != "" {
-			titleFolder = meta.TitleID + " " + titleName
+		if rv.opts.keepZip {
+			dst := backupRoot + ".zip"
+			if err := os.Rename(spool, dst); err == nil {
+				spool = ""
+			}
 		}
-		backupRoot = filepath.Join(rv.opts.outDir, typeDir, sanitizeComponent(titleFolder), sanitizeComponent(backupName))
+		return []string{backupRoot}, meta, nil
 	}
 
 	// A pre-existing backup of the same name is replaced, like on console.
 	if _, err := os.Stat(backupRoot); err == nil {
 		if err := os.RemoveAll(backupRoot); err != nil {
-			return "", nil, fmt.Errorf("cannot replace existing backup: %v", err)
+			return nil, nil, fmt.Errorf("cannot replace existing backup: %v", err)
 		}
 	}
 	if err := os.MkdirAll(backupRoot, 0o755); err != nil {
-		return "", nil, err
-	}
-
-	if rv.opts.verbose {
-		fmt.Fprintf(os.Stderr, "received %s (%s, isZip=%v) -> %s\n", meta.FileName, humanBytes(spoolBytes), meta.IsZip, backupRoot)
+		return nil, nil, err
 	}
 
 	if !meta.IsZip {
@@ -307,34 +338,107 @@ func (rv *receiver) storeUpload(r *http.Request) (string, *Meta, error) {
 		dst := filepath.Join(backupRoot, fileName)
 		if err := os.Rename(spool, dst); err != nil {
 			os.RemoveAll(backupRoot)
-			return "", nil, err
+			return nil, nil, err
 		}
 		spool = ""
-		return backupRoot, meta, nil
+		return []string{backupRoot}, meta, nil
 	}
 
-	if rv.opts.noExtract {
-		dst := filepath.Join(backupRoot, sanitizeComponent(backupName)+".zip")
-		if err := os.Rename(spool, dst); err != nil {
-			os.RemoveAll(backupRoot)
-			return "", nil, err
-		}
-		spool = ""
-		return backupRoot, meta, nil
+	dst := filepath.Join(backupRoot, sanitizeComponent(meta.BackupName)+".zip")
+	if err := os.Rename(spool, dst); err != nil {
+		os.RemoveAll(backupRoot)
+		return nil, nil, err
 	}
+	spool = ""
+	return []string{backupRoot}, meta, nil
+}
 
-	if err := ExtractZip(spool, backupRoot, rv.opts.verbose); err != nil {
-		// Never keep a half-extracted backup.
-		os.RemoveAll(backupRoot)
-		return "", nil, fmt.Errorf("extract failed: %v", err)
+// backupRoot is where the backup meta names lands under the mirrored console
+// layout: <out>/<type>/<titleId titleName>/<backupName>/ (or
+// <out>/<backupName> with --flat). meta.BackupName must be set.
+func (rv *receiver) backupRoot(meta *Meta) string {
+	if rv.opts.flat {
+		return filepath.Join(rv.opts.outDir, sanitizeComponent(meta.BackupName))
+	}
+	dataType := meta.DataType
+	if dataType != "extdata" {
+		dataType = "save"
+	}
+	typeDir := map[string]string{"save": "saves", "extdata": "extdata"}[dataType]
+	titleName := meta.TitleName
+	if titleName == "" {
+		titleName = "Unknown"
+	}
+	titleFolder := titleName
+	if meta.TitleID != "" {
+		titleFolder = meta.TitleID + " " + titleName
+	}
+	return filepath.Join(rv.opts.outDir, typeDir, sanitizeComponent(titleFolder), sanitizeComponent(meta.BackupName))
+}
+
+// extractUpload extracts the spooled zip into a staging folder, copies in the
+// files a delta upload reuses from the backup it replaces, and only then
+// swaps the result into backupRoot, so a failed upload never costs the old
+// backup.
+func (rv *receiver) extractUpload(spool, backupRoot string, reuse []ManifestEntry) error {
+	staging, err := os.MkdirTemp(rv.opts.outDir, "chlink_recv_*")
+	if err != nil {
+		return err
+	}
+	defer os.RemoveAll(staging) // gone already once renamed into place
+
+	if err := ExtractZip(spool, staging, rv.opts.verbose); err != nil {
+		return fmt.Errorf("extract failed: %v", err)
+	}
+	if err := cloneReused(backupRoot, staging, reuse); err != nil {
+		return err
+	}
+
+	// A pre-existing backup of the same name is replaced, like on console.
+	if err := os.RemoveAll(backupRoot); err != nil {
+		return fmt.Errorf("cannot replace existing backup: %v", err)
+	}
+	if err := os.MkdirAll(filepath.Dir(backupRoot), 0o755); err != nil {
+		return err
+	}
+	return os.Rename(staging, backupRoot)
+}
+
+// extractBatch extracts a batch zip into a staging folder and moves each
+// backup's "<index>" subfolder into the place its own meta names. Nothing is
+// moved unless the whole zip extracted.
+func (rv *receiver) extractBatch(spool string, backups []Meta) ([]string, error) {
+	staging, err := os.MkdirTemp(rv.opts.outDir, "chlink_recv_*")
+	if err != nil {
+		return nil, err
 	}
-	if rv.opts.keepZip {
-		dst := backupRoot + ".zip"
-		if err := os.Rename(spool, dst); err == nil {
-			spool = ""
+	defer os.RemoveAll(staging)
+
+	if err := ExtractZip(spool, staging, rv.opts.verbose); err != nil {
+		return nil, fmt.Errorf("extract failed: %v", err)
+	}
+	roots := make([]string, len(backups))
+	for i := range backups {
+		if backups[i].BackupName == "" {
+			backups[i].BackupName = "Received_" + fsTimestamp()
+		}
+		roots[i] = rv.backupRoot(&backups[i])
+		src := filepath.Join(staging, strconv.Itoa(i))
+		if err := os.MkdirAll(src, 0o755); err != nil {
+			return nil, err
+		}
+		// A pre-existing backup of the same name is replaced, like on console.
+		if err := os.RemoveAll(roots[i]); err != nil {
+			return nil, fmt.Errorf("cannot replace existing backup: %v", err)
+		}
+		if err := os.MkdirAll(filepath.Dir(roots[i]), 0o755); err != nil {
+			return nil, err
+		}
+		if err := os.Rename(src, roots[i]); err != nil {
+			return nil, err
 		}
 	}
-	return backupRoot, meta, nil
+	return roots, nil
 }
 
 func (rv *receiver) logEvent(fields map[string]any) {
@@ -356,10 +460,18 @@ func drainBody(r *http.Request) {
 }
 
 func writeJSON(w http.ResponseWriter, status int, v any) {
+	body, err := json.Marshal(v)
+	if err != nil {
+		status, body = http.StatusInternalServerError, []byte(`{"ok":false,"error":"internal error"}`)
+	}
+	body = append(body, '\n')
 	w.Header().Set("Content-Type", "application/json")
 	w.Header().Set("Connection", "close")
+	// An explicit length keeps net/http from switching a large reply (a long
+	// manifest answer) to chunked encoding, which the consoles do not decode.
+	w.Header().Set("Content-Length", strconv.Itoa(len(body)))
 	w.WriteHeader(status)
-	json.NewEncoder(w).Encode(v)
+	w.Write(body)
 }
 
 func localIPv4s() []string {
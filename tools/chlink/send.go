@@ -33,6 +33,7 @@ func cmdSend(args []string) error {
 	backupName := fs.String("backup-name", "", "destination backup folder name")
 	yes := fs.Bool("yes", false, "skip the confirmation prompt")
 	force := fs.Bool("force", false, "send even when over the receiver's size cap")
+	store := fs.Bool("store", false, "package folders store-only even when the receiver accepts deflate")
 	fs.Usage = func() {
 		fmt.Fprintln(os.Stderr, "usage: chlink send <path> --to <ip[:port]> --pin <PIN> [flags]")
 		fs.PrintDefaults()
@@ -52,6 +53,12 @@ func cmdSend(args []string) error {
 		return err
 	}
 
+	// Query the receiver before packaging: its zip methods decide how a folder
+	// is packed, its cap whether the result may be sent at all.
+	client := newHTTPClient(c.timeout)
+	ri, infoErr := fetchInfo(client, target)
+	deflate := infoErr == nil && ri.acceptsDeflate() && !*store
+
 	// Resolve payload: folder → zip (or raw when it holds exactly one file
 	// and no subfolders, mirroring the console), file → raw, .zip → as-is.
 	meta := Meta{DataType: "save", Timestamp: timestamp()}
@@ -121,14 +128,26 @@ func cmdSend(args []string) error {
 				return err
 			}
 			tempZip = tmp.Name()
+			mode := "store"
+			if deflate {
+				mode = "deflate"
+			}
 			if !c.jsonOut {
-				fmt.Fprintf(os.Stderr, "packaging %s (%d files, %s)...\n", path, nFiles, humanBytes(totalBytes))
+				fmt.Fprintf(os.Stderr, "packaging %s (%d files, %s, %s)...\n", path, nFiles, humanBytes(totalBytes), mode)
 			}
 			var progress func(int64)
 			if !c.jsonOut {
 				progress = progressPrinter("packaging", totalBytes)
 			}
-			if _, err := WriteStoreZip(tmp, path, progress); err != nil {
+			// Saves are mostly padding and zeroed slots, so a receiver that
+			// extracts deflate gets a zip several times smaller. The zip is
+			// staged either way, so its size is still known upfront.
+			if deflate {
+				_, err = writeDeflateZip(tmp, path)
+			} else {
+				_, err = WriteStoreZip(tmp, path, progress)
+			}
+			if err != nil {
 				tmp.Close()
 				return fmt.Errorf("packaging failed: %w", err)
 			}
@@ -172,10 +191,9 @@ func cmdSend(args []string) error {
 	meta.FileBytesTotal = st.Size()
 	meta.FileName = payloadName
 
-	// Query the receiver's cap before shipping bytes at it.
-	client := newHTTPClient(c.timeout)
-	if ri, err := fetchInfo(client, target); err != nil {
-		fmt.Fprintf(os.Stderr, "warning: GET /transfer/info failed (%v), sending blind\n", err)
+	// Check the receiver's cap before shipping bytes at it.
+	if infoErr != nil {
+		fmt.Fprintf(os.Stderr, "warning: GET /transfer/info failed (%v), sending blind\n", infoErr)
 	} else {
 		cap := ri.MaxUploadBytes
 		capNote := ""
@@ -250,7 +268,7 @@ func cmdSend(args []string) error {
 
 // doSend performs the POST /transfer/upload request, hand-rolling the
 // multipart body exactly like the console sender so Content-Length is known
-// upfront (the console server requires it and cannot parse chunked bodies).
+// upfront (console receivers that predate deflate cannot parse chunked bodies).
 func doSend(client *http.Client, target, pin string, meta Meta, payloadPath string, progress func(int64)) (string, error) {
 	metaJSON, err := json.Marshal(meta)
 	if err != nil {
@@ -3,10 +3,10 @@ package main
 // Console-compatible store-mode ZIP writer.
 //
 // The console extractor (TransferProto::extractZip in common/transferprotocol.cpp)
-// requires: method 0 (store), no zip64, directory entries ending in '/', and real
-// sizes present in the local header. It now tolerates data descriptors (flag bit 3)
-// and skips over extra fields rather than rejecting them. This writer still emits
-// the strict minimum — no data descriptors, no extra fields, sizes/CRC backfilled
+// requires, for stored entries: directory entries ending in '/' and real sizes
+// present in the local header. It tolerates data descriptors (flag bit 3), reads
+// zip64 records and skips over other extra fields. This writer still emits the
+// strict minimum — no data descriptors, no extra fields, no zip64, sizes/CRC backfilled
 // into the local header after streaming — so its output stays valid for any
 // consumer, not only the current extractor. It is hand-rolled (mirroring the
 // console sender) because Go's archive/zip emits data descriptors on some
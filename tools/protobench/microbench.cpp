@@ -0,0 +1,345 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+// Host micro-benchmarks for common/transferprotocol: the primitives the send
+// and receive paths run per byte or per entry, over a tree of many tiny files
+// and one of a few huge ones, all in memory and unthrottled, so each number is
+// the protocol code's own cost. Every line reports MB/s, entries/s and the
+// heap allocations per entry, counted by replacing the global operator new;
+// on the consoles' allocators those cost far more than they do here.
+//
+//     microbench [--scale N] [--filter NAME]
+
+#include "transferprotocol.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace TransferProto;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    std::atomic<uint64_t> g_allocs{0};
+    // Where a measured loop leaves its result, so the compiler cannot drop it.
+    volatile uint32_t g_crcSink = 0;
+}
+
+void* operator new(size_t n)
+{
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n != 0 ? n : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+    // A synthetic backup: `count` files of `size` bytes each, spread over
+    // folders of 64 the way a save with many slots is.
+    struct Tree {
+        std::string name;
+        std::vector<SendFile> files;
+        std::vector<std::string> dirs;
+        uint64_t bytes = 0;
+    };
+
+    Tree makeTree(const std::string& name, size_t count, uint64_t size)
+    {
+        Tree tree;
+        tree.name = name;
+        for (size_t i = 0; i < count; i++) {
+            std::string dir = "save/slot" + std::to_string(i / 64) + "/";
+            if (i % 64 == 0) {
+                tree.dirs.push_back(dir);
+            }
+            tree.files.push_back(SendFile{"/bench/" + std::to_string(i), dir + "file" + std::to_string(i) + ".bin", size});
+            tree.bytes += size;
+        }
+        return tree;
+    }
+
+    // Save-like file data, half of each block zeroed so deflate has
+    // something to do; served from one pattern buffer, so reading is a memcpy.
+    const std::vector<uint8_t>& pattern(void)
+    {
+        static std::vector<uint8_t> data = []() {
+            std::vector<uint8_t> out(1 << 20);
+            for (size_t i = 0; i < out.size(); i++) {
+                out[i] = (i & 0x1000) ? 0 : (uint8_t)(i * 2654435761u >> 13);
+            }
+            return out;
+        }();
+        return data;
+    }
+
+    struct PatternReader : FileReader {
+        size_t pos = 0;
+        bool open(const std::string&) override
+        {
+            pos = 0;
+            return true;
+        }
+        size_t read(void* dst, size_t n) override
+        {
+            const std::vector<uint8_t>& src = pattern();
+            uint8_t* out                    = static_cast<uint8_t*>(dst);
+            for (size_t done = 0; done < n;) {
+                size_t at   = pos % src.size();
+                size_t take = std::min(n - done, src.size() - at);
+                memcpy(out + done, src.data() + at, take);
+                done += take;
+                pos += take;
+            }
+            return n;
+        }
+        void close() override {}
+    };
+
+    // The socket side of a send: counts what it is given, or keeps it, to
+    // feed the receive benchmarks the exact bytes a sender produced.
+    struct MemorySink : ByteSink {
+        std::string* keep = nullptr;
+        uint64_t sent     = 0;
+        bool sendAll(const void* data, size_t len) override
+        {
+            if (keep != nullptr) {
+                keep->append(static_cast<const char*>(data), len);
+            }
+            sent += len;
+            return true;
+        }
+    };
+
+    // The request body: hands out `chunk` bytes at a time, as the socket does.
+    struct MemoryReader : ByteReader {
+        const std::string& data;
+        size_t chunk;
+        size_t pos = 0;
+        MemoryReader(const std::string& bytes, size_t step) : data(bytes), chunk(step) {}
+        size_t read(void* dst, size_t n) override
+        {
+            size_t take = std::min({n, chunk, data.size() - pos});
+            memcpy(dst, data.data() + pos, take);
+            pos += take;
+            return take;
+        }
+    };
+
+    // The receiver's filesystem: takes every entry and keeps nothing.
+    struct NullExtractSink : ExtractSink {
+        uint64_t files = 0;
+        uint64_t bytes = 0;
+        bool makeDir(const std::string&) override { return true; }
+        bool beginFile(const std::string&, uint64_t) override
+        {
+            files++;
+            return true;
+        }
+        bool writeFile(const void*, size_t n) override
+        {
+            bytes += n;
+            return true;
+        }
+        void endFile() override {}
+    };
+
+    std::string g_filter;
+
+    // Times `body` over enough repetitions to run for about half a second and
+    // prints one line; `bytes` and `entries` are per repetition, 0 when the
+    // column does not apply.
+    template <typename Fn>
+    void measure(const std::string& name, const std::string& tree, uint64_t bytes, uint64_t entries, Fn body)
+    {
+        if (!g_filter.empty() && name.find(g_filter) == std::string::npos) {
+            return;
+        }
+        body(); // warm-up: first-touch page faults, static init
+        uint64_t reps    = 0;
+        uint64_t allocs0 = g_allocs.load();
+        auto start       = Clock::now();
+        double seconds   = 0;
+        do {
+            body();
+            reps++;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (seconds < 0.5);
+        uint64_t allocs = g_allocs.load() - allocs0;
+
+        std::string mbps = bytes != 0 ? std::to_string((int)(bytes * reps / 1e6 / seconds)) : "-";
+        std::string eps  = entries != 0 ? std::to_string((uint64_t)(entries * reps / seconds)) : "-";
+        double perEntry  = (double)allocs / (double)(reps * (entries != 0 ? entries : 1));
+        printf("  %-22s %-6s %10s MB/s %12s /s %10.2f allocs/entry\n", name.c_str(), tree.c_str(), mbps.c_str(), eps.c_str(), perEntry);
+    }
+
+    void benchTree(const Tree& tree)
+    {
+        // The zips a sender would put on the wire, kept for the receive side.
+        std::string storeZip;
+        std::string deflateZip;
+        {
+            PatternReader reader;
+            MemorySink sink;
+            bool cancelled = false;
+            storeZip.reserve(zipStreamSize(tree.files, tree.dirs));
+            sink.keep = &storeZip;
+            sendZipStream(sink, tree.files, tree.dirs, reader, ZipMethod::Store, nullptr, nullptr, cancelled);
+            sink.keep = &deflateZip;
+            sendZipStream(sink, tree.files, tree.dirs, reader, ZipMethod::Deflate, nullptr, nullptr, cancelled);
+        }
+        const uint64_t entries = tree.files.size() + tree.dirs.size();
+
+        measure("updateCrc", tree.name, tree.bytes, tree.files.size(), [&]() {
+            const std::vector<uint8_t>& src = pattern();
+            uint32_t crc                    = 0xFFFFFFFFu;
+            for (const auto& file : tree.files) {
+                for (uint64_t done = 0; done < file.size;) {
+                    size_t take = (size_t)std::min<uint64_t>(file.size - done, src.size());
+                    crc         = updateCrc(crc, src.data(), take);
+                    done += take;
+                }
+            }
+            g_crcSink = crc;
+        });
+
+        for (ZipMethod method : {ZipMethod::Store, ZipMethod::Deflate}) {
+            const bool deflated = method == ZipMethod::Deflate;
+            measure(deflated ? "sendZipStream deflate" : "sendZipStream store", tree.name, tree.bytes, entries, [&]() {
+                PatternReader reader;
+                MemorySink sink;
+                bool cancelled = false;
+                sendZipStream(sink, tree.files, tree.dirs, reader, method, nullptr, nullptr, cancelled);
+            });
+            const std::string& zip = deflated ? deflateZip : storeZip;
+            measure(deflated ? "extractZip deflate" : "extractZip store", tree.name, tree.bytes, entries, [&]() {
+                MemoryReader in(zip, 0x10000);
+                NullExtractSink sink;
+                std::string error;
+                if (!extractZip(in, UINT64_MAX, sink, nullptr, nullptr, error)) {
+                    fprintf(stderr, "extractZip failed: %s\n", error.c_str());
+                    exit(1);
+                }
+            });
+        }
+
+        // The upload body as the receiver sees it: the meta part, then the
+        // store zip as the file part, fed in socket-sized chunks.
+        std::string boundary = "----checkpoint-boundary-1234567890";
+        std::string body     = "--" + boundary + "\r\nContent-Disposition: form-data; name=\"meta\"\r\n\r\n{\"isZip\":true}\r\n";
+        body += "--" + boundary + "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"backup.zip\"\r\n\r\n";
+        body += storeZip;
+        body += "\r\n--" + boundary + "--\r\n";
+        measure("MultipartParser", tree.name, body.size(), 2, [&]() {
+            uint64_t got = 0;
+            MultipartParser::Callbacks callbacks;
+            callbacks.onPartBegin = [](const std::string&) { return true; };
+            callbacks.onPartData  = [&got](const uint8_t*, size_t len) {
+                got += len;
+                return true;
+            };
+            callbacks.onPartEnd = []() { return true; };
+            MultipartParser parser(boundary, callbacks);
+            for (size_t pos = 0; pos < body.size(); pos += 0x10000) {
+                size_t len = std::min<size_t>(0x10000, body.size() - pos);
+                parser.feed(reinterpret_cast<const uint8_t*>(body.data()) + pos, len);
+            }
+            if (!parser.done()) {
+                fprintf(stderr, "MultipartParser did not finish the body\n");
+                exit(1);
+            }
+        });
+
+        uint64_t pathBytes = 0;
+        for (const auto& file : tree.files) {
+            pathBytes += file.relPath.size();
+        }
+        measure("isSafeZipRelativePath", tree.name, pathBytes, tree.files.size(), [&]() {
+            size_t safe = 0;
+            for (const auto& file : tree.files) {
+                safe += isSafeZipRelativePath(file.relPath) ? 1 : 0;
+            }
+            if (safe != tree.files.size()) {
+                fprintf(stderr, "isSafeZipRelativePath rejected a generated path\n");
+                exit(1);
+            }
+        });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t scale = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue   = i + 1 < argc;
+        if (arg == "--scale" && hasValue) {
+            scale = std::max<uint64_t>(1, strtoull(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--filter" && hasValue) {
+            g_filter = argv[++i];
+        }
+        else {
+            fprintf(stderr, "usage: %s [--scale N] [--filter NAME]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // Many tiny files (a save with hundreds of slots or a DLC catalog) stress
+    // the per-entry work; a few huge ones, the per-byte work.
+    Tree tiny = makeTree("tiny", 4096 * scale, 512);
+    Tree huge = makeTree("huge", 4, (16ull << 20) * scale);
+    printf("tiny: %zu files of 512 B; huge: %zu files of %llu MiB\n", tiny.files.size(), huge.files.size(),
+        (unsigned long long)(huge.bytes / huge.files.size() >> 20));
+    printf("  %-22s %-6s %15s %15s %22s\n", "benchmark", "tree", "throughput", "entries", "heap");
+    benchTree(tiny);
+    benchTree(huge);
+
+    // Every request runs a handful of these over its header block.
+    std::string headers = "POST /transfer/upload HTTP/1.1\r\nHost: 192.168.0.10:8000\r\nConnection: close\r\nUser-Agent: chlink/4.0\r\n"
+                          "X-CP-Token: 1234\r\nX-CP-Upload-Id: 0100000000010000686F7A21\r\n"
+                          "Content-Type: multipart/form-data; boundary=----checkpoint-boundary-1234567890\r\nContent-Length: 123456789";
+    measure("headerValue", "-", headers.size(), 1, [&]() {
+        if (headerValue(headers, "content-length").empty()) {
+            exit(1);
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,195 @@
+/*
+ *   This file is part of Checkpoint
+ *   Copyright (C) 2017-2026 Bernardo Giordano, FlagBrew
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   Additional Terms 7.b and 7.c of GPLv3 apply to this file:
+ *       * Requiring preservation of specified reasonable legal notices or
+ *         author attributions in that material or in the Appropriate Legal
+ *         Notices displayed by works containing it.
+ *       * Prohibiting misrepresentation of the origin of that material,
+ *         or requiring that modified versions of such material be marked in
+ *         reasonable ways as different from the original version.
+ */
+
+// Host benchmark for the send path in common/transferprotocol: streams a
+// synthetic backup through sendZipStream with the file reads and the socket
+// each throttled to a fixed rate, once reading inline and once through
+// ReadAheadReader, and reports the throughput of both. The rates default to
+// what a Switch sustains on SD and Wi-Fi alike, where the two taking turns
+// costs the most. --call-us charges every send a fixed cost on top, as the
+// poll and syscall behind each one do on the consoles, which is what a save
+// of many small files pays for.
+//
+//     protobench [--mib N] [--files N] [--disk MB/s] [--net MB/s] [--call-us N] [--deflate]
+
+#include "transferprotocol.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace TransferProto;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+    // Holds every call for as long as `bytes` take at `mbps`, as a device
+    // sustaining that rate would.
+    void throttle(size_t bytes, double mbps)
+    {
+        if (mbps > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(bytes / (mbps * 1e6)));
+        }
+    }
+
+    // The backup's files, generated on read: save-like data, half of each
+    // block zeroed so deflate has something to do.
+    struct ThrottledReader : FileReader {
+        double mbps;
+        uint64_t pos = 0;
+        explicit ThrottledReader(double rate) : mbps(rate) {}
+        bool open(const std::string&) override
+        {
+            pos = 0;
+            return true;
+        }
+        size_t read(void* dst, size_t n) override
+        {
+            uint8_t* out = static_cast<uint8_t*>(dst);
+            for (size_t i = 0; i < n; i++, pos++) {
+                out[i] = (pos & 0x1000) ? 0 : (uint8_t)(pos * 2654435761u >> 13);
+            }
+            throttle(n, mbps);
+            return n;
+        }
+        void close() override {}
+    };
+
+    // The socket: takes everything at `mbps`, plus `callUs` per send, and
+    // keeps a CRC of it, so both runs can be checked for sending the same bytes.
+    struct ThrottledSink : ByteSink {
+        double mbps;
+        double callUs;
+        uint64_t sent  = 0;
+        uint64_t calls = 0;
+        uint32_t crc   = 0xFFFFFFFFu;
+        ThrottledSink(double rate, double perCall) : mbps(rate), callUs(perCall) {}
+        bool sendAll(const void* data, size_t len) override
+        {
+            crc = updateCrc(crc, static_cast<const uint8_t*>(data), len);
+            sent += len;
+            calls++;
+            throttle(len, mbps);
+            if (callUs > 0) {
+                std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(callUs));
+            }
+            return true;
+        }
+    };
+
+    struct Result {
+        double seconds;
+        uint64_t sent;
+        uint64_t calls;
+        uint32_t crc;
+        bool ok;
+    };
+
+    Result run(const std::vector<SendFile>& files, double disk, double net, double callUs, ZipMethod method, bool readAhead)
+    {
+        ThrottledReader reader(disk);
+        ThrottledSink sink(net, callUs);
+        bool cancelled = false;
+        bool ok        = false;
+        auto start     = Clock::now();
+        if (readAhead) {
+            ReadAheadReader ahead(reader, files);
+            std::thread producer([&ahead]() { ahead.produce(); });
+            ok = sendZipStream(sink, files, {}, ahead, method, nullptr, nullptr, cancelled);
+            ahead.stop();
+            producer.join();
+        }
+        else {
+            ok = sendZipStream(sink, files, {}, reader, method, nullptr, nullptr, cancelled);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return Result{seconds, sink.sent, sink.calls, sink.crc, ok};
+    }
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t mib  = 64;
+    size_t count  = 16;
+    double disk   = 40;
+    double net    = 40;
+    double callUs = 0;
+    bool deflate  = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue   = i + 1 < argc;
+        if (arg == "--mib" && hasValue) {
+            mib = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--files" && hasValue) {
+            count = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--disk" && hasValue) {
+            disk = atof(argv[++i]);
+        }
+        else if (arg == "--net" && hasValue) {
+            net = atof(argv[++i]);
+        }
+        else if (arg == "--call-us" && hasValue) {
+            callUs = atof(argv[++i]);
+        }
+        else if (arg == "--deflate") {
+            deflate = true;
+        }
+        else {
+            fprintf(stderr, "usage: %s [--mib N] [--files N] [--disk MB/s] [--net MB/s] [--call-us N] [--deflate]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (count == 0) {
+        count = 1;
+    }
+
+    std::vector<SendFile> files;
+    uint64_t total = mib << 20;
+    for (size_t i = 0; i < count; i++) {
+        uint64_t size = total / count + (i < total % count ? 1 : 0);
+        files.push_back(SendFile{"/bench/" + std::to_string(i), "save/" + std::to_string(i) + ".bin", size});
+    }
+
+    ZipMethod method = deflate ? ZipMethod::Deflate : ZipMethod::Store;
+    printf("%llu MiB in %zu files, disk %.0f MB/s, net %.0f MB/s, %.0f us per send, %s\n", (unsigned long long)mib, count, disk, net, callUs,
+        deflate ? "deflate" : "store");
+
+    Result plain = run(files, disk, net, callUs, method, false);
+    Result ahead = run(files, disk, net, callUs, method, true);
+    printf("  inline      %7.2f s  %7.1f MB/s  %8llu sends\n", plain.seconds, total / 1e6 / plain.seconds, (unsigned long long)plain.calls);
+    printf("  read-ahead  %7.2f s  %7.1f MB/s  %8llu sends  (x%.2f)\n", ahead.seconds, total / 1e6 / ahead.seconds, (unsigned long long)ahead.calls,
+        plain.seconds / ahead.seconds);
+
+    if (!plain.ok || !ahead.ok || plain.sent != ahead.sent || plain.crc != ahead.crc) {
+        fprintf(stderr, "mismatch: the two runs did not send the same zip\n");
+        return 1;
+    }
+    return 0;
+}